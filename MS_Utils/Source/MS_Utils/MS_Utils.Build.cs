@@ -8,6 +8,11 @@ public class MS_Utils : ModuleRules
 	public MS_Utils(ReadOnlyTargetRules Target) : base(Target)
 	{
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// MSUtilsKernels.ispc is compiled for every ISPC target UBT lists for the platform and dispatched at runtime.
+		// On Win64 and Linux x64 that is sse4, avx, avx2 and avx512skx-i32x8, so SSE4 machines get a kernel and AVX2
+		// and AVX-512 machines the wider ones. ModuleRules has no per-module target list, so change the set in
+		// ISPCHelper, not here. Builds without ISPC (bCompileISPC off) use the scalar paths in MSUtilsKernels.cpp.
 		
 		PublicIncludePaths.AddRange(
 			new string[] {
@@ -27,9 +32,13 @@ public class MS_Utils : ModuleRules
 			new string[]
 			{
                 "Core",
+                "CoreUObject",
+                "Engine",
+                "AudioExtensions",
                 "MetasoundGraphCore",
                 "MetasoundEngine",
-                "MetasoundFrontend"
+                "MetasoundFrontend",
+                "MS_UtilsGuard"
 
 				// ... add other public dependencies that you statically link with here ...
 			}
@@ -39,13 +48,10 @@ public class MS_Utils : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"CoreUObject",
-				"Engine",
 				"Slate",
 				"SlateCore",
                 "Serialization",
                 "SignalProcessing",
-                "AudioExtensions",
                 "MetasoundStandardNodes"
 				// ... add private dependencies that you statically link with here ...	
 			}
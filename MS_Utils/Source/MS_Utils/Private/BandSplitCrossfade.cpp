@@ -0,0 +1,426 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "MS_Utils.h"
+#include "MSUtilsQuality.h"
+#include "MSUtilsVertexNames.h"
+#include "RenderThreadGuard.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundAudioBuffer.h"
+#include "CoreMinimal.h"
+#include "Internationalization/Text.h"
+#include "MetasoundExecutableOperator.h"
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundStandardNodesCategories.h"
+#include "MetasoundStandardNodesNames.h"
+#include "MetasoundTime.h"
+#include "MetasoundVertex.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_BandSplitCrossfade"
+
+DECLARE_CYCLE_STAT(TEXT("EP Band Split Crossfade Execute"), STAT_MSUtils_BandSplitCrossfadeExecute, STATGROUP_MSUtils);
+
+#define REGISTER_BANDSPLITCROSSFADE_NODE(Number) \
+	using FBandSplitCrossfadeNode##Number = TBandSplitCrossfadeNode<Number>; \
+	METASOUND_REGISTER_NODE(FBandSplitCrossfadeNode##Number) \
+
+
+namespace Metasound
+{
+	namespace BandSplitXFVertexNames
+	{
+		METASOUND_PARAM(InputCrossfadeValue, "Crossfade Value", "Crossfade value to crossfade between inputs.")
+		METASOUND_PARAM(InputCrossover, "Crossover", "Frequency in Hz splitting the low and high bands.")
+		METASOUND_PARAM(InputLowTime, "Low Time", "Time the low band takes to move one input towards the crossfade value.")
+		METASOUND_PARAM(InputHighTime, "High Time", "Time the high band takes to move one input towards the crossfade value.")
+		METASOUND_PARAM(OutputAudio, "Out", "Output audio.")
+
+		constexpr int32 MaxNumInputs = 8;
+
+		const FVertexName& GetInputName(int32 InIndex)
+		{
+			static const TArray<FVertexName> InputNames = MSUtilsVertexNames::MakeNames(TEXT("In {0}"), MaxNumInputs);
+
+			check(InIndex < MaxNumInputs);
+			return InputNames[InIndex];
+		}
+
+		const FDataVertexMetadata& GetInputMetadata(int32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> InputMetadata = MSUtilsVertexNames::MakeMetadata(MaxNumInputs, [](int32 i) -> FDataVertexMetadata
+				{
+					return { METASOUND_LOCTEXT_FORMAT("BandSplitXFInputDesc", "Crossfade {0} input.", i), METASOUND_LOCTEXT_FORMAT("BandSplitXFInputDisplayName", "In {0}", i) };
+				});
+
+			check(InIndex < MaxNumInputs);
+			return InputMetadata[InIndex];
+		}
+	}
+
+	// 4th order Linkwitz-Riley crossover: two cascaded Butterworth sections per band. The bands sum to an allpass, so a
+	// fully faded-in input comes through flat whatever the band positions. Kept allocation free so idle inputs can
+	// simply be skipped and their state cleared.
+	class FLR4Crossover
+	{
+	public:
+		struct FCoefficients
+		{
+			float B0 = 1.f;
+			float B1 = 0.f;
+			float B2 = 0.f;
+			float A1 = 0.f;
+			float A2 = 0.f;
+		};
+
+		// Transposed direct form II
+		struct FSection
+		{
+			float Z1 = 0.f;
+			float Z2 = 0.f;
+
+			float Process(const FCoefficients& C, float X)
+			{
+				const float Y = C.B0 * X + Z1;
+				Z1 = C.B1 * X - C.A1 * Y + Z2;
+				Z2 = C.B2 * X - C.A2 * Y;
+				return Y;
+			}
+		};
+
+		static void GetCoefficients(float Frequency, float SampleRate, FCoefficients& OutLowPass, FCoefficients& OutHighPass)
+		{
+			const float W0 = 2.f * PI * FMath::Clamp(Frequency, 20.f, 0.45f * SampleRate) / SampleRate;
+			const float CosW0 = FMath::Cos(W0);
+			const float Alpha = FMath::Sin(W0) * UE_INV_SQRT_2; // sin(w0) / (2 Q) with Q = 1 / sqrt(2)
+			const float InvA0 = 1.f / (1.f + Alpha);
+
+			OutLowPass.B0 = 0.5f * (1.f - CosW0) * InvA0;
+			OutLowPass.B1 = (1.f - CosW0) * InvA0;
+			OutLowPass.B2 = OutLowPass.B0;
+			OutLowPass.A1 = -2.f * CosW0 * InvA0;
+			OutLowPass.A2 = (1.f - Alpha) * InvA0;
+
+			OutHighPass.B0 = 0.5f * (1.f + CosW0) * InvA0;
+			OutHighPass.B1 = -(1.f + CosW0) * InvA0;
+			OutHighPass.B2 = OutHighPass.B0;
+			OutHighPass.A1 = OutLowPass.A1;
+			OutHighPass.A2 = OutLowPass.A2;
+		}
+
+		FSection Low[2];
+		FSection High[2];
+	};
+
+	// EP Crossfade with separate positions for the low and high bands. Each band's position slews towards the crossfade
+	// value at its own rate and gets its own equal power gains, so lows can switch fast while highs fade slowly.
+	template<int32 NumInputs>
+	class TBandSplitXFOperator : public TExecutableOperator<TBandSplitXFOperator<NumInputs>>
+	{
+		static_assert(NumInputs <= BandSplitXFVertexNames::MaxNumInputs, "BandSplitXFVertexNames::MaxNumInputs must cover every registered input count");
+
+	public:
+		using FInputArray = TArray<FAudioBufferReadRef, TInlineAllocator<NumInputs>>;
+
+		enum EBand
+		{
+			LowBand,
+			HighBand,
+			NumBands
+		};
+
+		static const FVertexInterface& GetVertexInterface()
+		{
+			using namespace BandSplitXFVertexNames;
+
+			auto CreateDefaultInterface = []() -> FVertexInterface
+				{
+					FInputVertexInterface InputInterface;
+
+					InputInterface.Add(TInputDataVertex<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputCrossfadeValue), 0.0f));
+					InputInterface.Add(TInputDataVertex<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputCrossover), 300.0f));
+					InputInterface.Add(TInputDataVertex<FTime>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputLowTime), 0.05f));
+					InputInterface.Add(TInputDataVertex<FTime>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputHighTime), 1.0f));
+
+					for (int32 i = 0; i < NumInputs; ++i)
+					{
+						InputInterface.Add(TInputDataVertex<FAudioBuffer>(GetInputName(i), GetInputMetadata(i)));
+					}
+
+					FOutputVertexInterface OutputInterface;
+					OutputInterface.Add(TOutputDataVertex<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutputAudio)));
+
+					return FVertexInterface(InputInterface, OutputInterface);
+				};
+
+			static const FVertexInterface DefaultInterface = CreateDefaultInterface();
+			return DefaultInterface;
+		}
+
+		static const FNodeClassMetadata& GetNodeInfo()
+		{
+			auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+				{
+					FName DataTypeName = GetMetasoundDataTypeName<FAudioBuffer>();
+					FName OperatorName = *FString::Printf(TEXT("EP Band Split Crossfade (%d)"), NumInputs);
+					FText NodeDisplayName = METASOUND_LOCTEXT_FORMAT("BandSplitXFDisplayNamePattern", "EP Band Split Crossfade ({0})", NumInputs);
+					const FText NodeDescription = METASOUND_LOCTEXT("BandSplitXFDescription", "Crossfades inputs by equal power with separate low and high band crossfade times.");
+					FVertexInterface NodeInterface = GetVertexInterface();
+
+					FNodeClassMetadata Metadata
+					{
+						FNodeClassName { "EPBandSplitXF", OperatorName, DataTypeName },
+						1, // Major Version
+						0, // Minor Version
+						NodeDisplayName,
+						NodeDescription,
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Envelopes },
+						{ },
+						FNodeDisplayStyle()
+					};
+					return Metadata;
+				};
+
+			static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+			return Metadata;
+		}
+
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, TArray<TUniquePtr<IOperatorBuildError>>& OutErrors)
+		{
+			using namespace BandSplitXFVertexNames;
+
+			const FInputVertexInterface& InputInterface = InParams.Node.GetVertexInterface().GetInputInterface();
+			const FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+
+			FFloatReadRef CrossfadeValue = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InputCrossfadeValue), InParams.OperatorSettings);
+			FFloatReadRef Crossover = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InputCrossover), InParams.OperatorSettings);
+			FTimeReadRef LowTime = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FTime>(InputInterface, METASOUND_GET_PARAM_NAME(InputLowTime), InParams.OperatorSettings);
+			FTimeReadRef HighTime = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FTime>(InputInterface, METASOUND_GET_PARAM_NAME(InputHighTime), InParams.OperatorSettings);
+
+			FInputArray InputValues;
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InputValues.Add(InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, GetInputName(i), InParams.OperatorSettings));
+			}
+
+			return MakeUnique<TBandSplitXFOperator<NumInputs>>(InParams.OperatorSettings, CrossfadeValue, Crossover, LowTime, HighTime, MoveTemp(InputValues));
+		}
+
+		TBandSplitXFOperator(const FOperatorSettings& InSettings, const FFloatReadRef& InCrossfadeValue, const FFloatReadRef& InCrossover, const FTimeReadRef& InLowTime, const FTimeReadRef& InHighTime, FInputArray&& InInputValues)
+			: CrossfadeValue(InCrossfadeValue)
+			, Crossover(InCrossover)
+			, LowTime(InLowTime)
+			, HighTime(InHighTime)
+			, InputValues(MoveTemp(InInputValues))
+			, OutputValue(TDataWriteReferenceFactory<FAudioBuffer>::CreateAny(InSettings))
+			, SampleRate(InSettings.GetSampleRate())
+			, BlockSeconds(InSettings.GetNumFramesPerBlock() / InSettings.GetSampleRate())
+			, Quality(FMSUtilsQuality::Get())
+		{
+			InitPositions();
+		}
+
+		virtual ~TBandSplitXFOperator() = default;
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace BandSplitXFVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputCrossfadeValue), CrossfadeValue);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputCrossover), Crossover);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputLowTime), LowTime);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputHighTime), HighTime);
+
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InOutVertexData.BindReadVertex(GetInputName(i), InputValues[i]);
+			}
+		}
+
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace BandSplitXFVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutputAudio), OutputValue);
+		}
+
+		virtual FDataReferenceCollection GetInputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		virtual FDataReferenceCollection GetOutputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		void Reset(const IOperator::FResetParams& InParams)
+		{
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				Crossovers[i] = FLR4Crossover();
+				bCrossoverCleared[i] = true;
+			}
+			InitPositions();
+			OutputValue->Zero();
+		}
+
+		void Execute()
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MSUtils_BandSplitCrossfadeExecute);
+			MSUTILS_EXECUTE_SCOPE(TEXT("EP Band Split Crossfade"));
+
+			if (*Crossover != PrevCrossover)
+			{
+				PrevCrossover = *Crossover;
+				FLR4Crossover::GetCoefficients(PrevCrossover, SampleRate, LowPass, HighPass);
+			}
+
+			const float Target = FMath::Clamp(*CrossfadeValue, 0.0f, (float)(NumInputs - 1));
+			UpdateBand(LowBand, Target, (float)LowTime->GetSeconds());
+			UpdateBand(HighBand, Target, (float)HighTime->GetSeconds());
+
+			FAudioBuffer& Output = *OutputValue;
+			Output.Zero();
+			const int32 NumFrames = Output.Num();
+			const float InvNumFrames = 1.f / FMath::Max(NumFrames, 1);
+			float* OutData = Output.GetData();
+
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				const float LowStart = Quality.GetRampStartGain(PrevGains[LowBand][i], Gains[LowBand][i]);
+				const float HighStart = Quality.GetRampStartGain(PrevGains[HighBand][i], Gains[HighBand][i]);
+				const float LowEnd = Gains[LowBand][i];
+				const float HighEnd = Gains[HighBand][i];
+
+				if (LowStart == 0.f && LowEnd == 0.f && HighStart == 0.f && HighEnd == 0.f)
+				{
+					// Silent inputs are neither filtered nor mixed. Their filter state is cleared once so they come
+					// back without a stale tail.
+					if (!bCrossoverCleared[i])
+					{
+						Crossovers[i] = FLR4Crossover();
+						bCrossoverCleared[i] = true;
+					}
+					continue;
+				}
+				bCrossoverCleared[i] = false;
+
+				// Split, apply both band ramps and sum in one pass
+				FLR4Crossover& Split = Crossovers[i];
+				const float* InData = InputValues[i]->GetData();
+				const float LowDelta = (LowEnd - LowStart) * InvNumFrames;
+				const float HighDelta = (HighEnd - HighStart) * InvNumFrames;
+				for (int32 n = 0; n < NumFrames; ++n)
+				{
+					const float X = InData[n];
+					const float Low = Split.Low[1].Process(LowPass, Split.Low[0].Process(LowPass, X));
+					const float High = Split.High[1].Process(HighPass, Split.High[0].Process(HighPass, X));
+					OutData[n] += Low * (LowStart + n * LowDelta) + High * (HighStart + n * HighDelta);
+				}
+			}
+
+			FMemory::Memcpy(PrevGains, Gains, sizeof(Gains));
+		}
+
+	private:
+		void InitPositions()
+		{
+			const float Target = FMath::Clamp(*CrossfadeValue, 0.0f, (float)(NumInputs - 1));
+			for (int32 Band = 0; Band < NumBands; ++Band)
+			{
+				Positions[Band] = Target;
+				SetGains(Band, Target);
+			}
+			FMemory::Memcpy(PrevGains, Gains, sizeof(Gains));
+		}
+
+		// Slews the band's position towards Target by one input per BandSeconds, then recomputes its gains if it moved
+		void UpdateBand(int32 Band, float Target, float BandSeconds)
+		{
+			float& Position = Positions[Band];
+			if (Position == Target)
+			{
+				return;
+			}
+
+			const float MaxStep = BandSeconds > 0.f ? BlockSeconds / BandSeconds : (float)NumInputs;
+			Position = Position + FMath::Clamp(Target - Position, -MaxStep, MaxStep);
+			SetGains(Band, Position);
+		}
+
+		// Same index and alpha split as EP Crossfade
+		void SetGains(int32 Band, float Position)
+		{
+			int32 IndexA = 0;
+			int32 IndexB = 0;
+			float Alpha = 0.f;
+			FMSUtilsQuality::SplitPosition(Position, NumInputs, IndexA, IndexB, Alpha);
+
+			float GainA = 0.f;
+			float GainB = 0.f;
+			Quality.GetPairGains(Alpha, GainA, GainB);
+
+			float* BandGains = Gains[Band];
+			FMemory::Memzero(BandGains, sizeof(float) * NumInputs);
+			BandGains[IndexA] = GainA;
+			if (IndexB != IndexA)
+			{
+				BandGains[IndexB] = GainB;
+			}
+		}
+
+		FFloatReadRef CrossfadeValue;
+		FFloatReadRef Crossover;
+		FTimeReadRef LowTime;
+		FTimeReadRef HighTime;
+		FInputArray InputValues;
+		TDataWriteReference<FAudioBuffer> OutputValue;
+
+		float SampleRate = 0.f;
+		float BlockSeconds = 0.f;
+		FMSUtilsQuality Quality;
+
+		float PrevCrossover = -1.f;
+		FLR4Crossover::FCoefficients LowPass;
+		FLR4Crossover::FCoefficients HighPass;
+		FLR4Crossover Crossovers[NumInputs];
+		bool bCrossoverCleared[NumInputs] = { };
+
+		float Positions[NumBands] = { };
+		float Gains[NumBands][NumInputs] = { };
+		float PrevGains[NumBands][NumInputs] = { };
+	};
+
+	template<int32 NumInputs>
+	class TBandSplitCrossfadeNode : public FNodeFacade
+	{
+	public:
+		/**
+		 * Constructor used by the Metasound Frontend.
+		 */
+		TBandSplitCrossfadeNode(const FNodeInitData& InInitData)
+			: FNodeFacade(InInitData.InstanceName, InInitData.InstanceID, TFacadeOperatorClass<TBandSplitXFOperator<NumInputs>>())
+		{}
+
+		virtual ~TBandSplitCrossfadeNode() = default;
+	};
+
+	REGISTER_BANDSPLITCROSSFADE_NODE(2);
+	REGISTER_BANDSPLITCROSSFADE_NODE(3);
+	REGISTER_BANDSPLITCROSSFADE_NODE(4);
+	REGISTER_BANDSPLITCROSSFADE_NODE(5);
+	REGISTER_BANDSPLITCROSSFADE_NODE(6);
+	REGISTER_BANDSPLITCROSSFADE_NODE(7);
+	REGISTER_BANDSPLITCROSSFADE_NODE(8);
+
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -1,12 +1,18 @@
 // Copyright Dale Grinsell 2024. All Rights Reserved. 
 
 #include "CrossfadeByParam.h"
+#include "MS_Utils.h"
+#include "MSUtilsKernels.h"
+#include "RenderThreadGuard.h"
 
 #include "DSP/FloatArrayMath.h"
 #include "MetasoundStandardNodesCategories.h"
 
 #define LOCTEXT_NAMESPACE "MetasoundStandardNodes_CrossfadeByParam"
 
+DECLARE_CYCLE_STAT(TEXT("Crossfade By Param Execute"), STAT_MSUtils_CrossfadeByParamExecute, STATGROUP_MSUtils);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Crossfade By Param Operators"), STAT_MSUtils_CrossfadeByParamOperators, STATGROUP_MSUtils);
+
 namespace Metasound
 {
 	//the below stores name and tooltip information for each input/output pin - Name and then description.
@@ -20,6 +26,7 @@ namespace Metasound
 		METASOUND_PARAM(InFadeOutStart, "FadeOutStart", "Fade Out Start");
 		METASOUND_PARAM(InFadeOutEnd, "FadeOutEnd", "Fade Out End");
 		METASOUND_PARAM(InAudioParam, "Audio In 1", "Input Audio Channel 1");
+		METASOUND_PARAM(InProfile, "Profile", "Optional Crossfade Profile asset. When set, its zones and gain law replace the fade and EP inputs");
 		METASOUND_PARAM(OutAudioParam, "Audio Out", "Audio Output");
 	}
 
@@ -30,7 +37,10 @@ namespace Metasound
 		const FFloatReadRef& FadeInStartIn,
 		const FFloatReadRef& FadeInEndIn,
 		const FFloatReadRef& FadeOutStartIn,
-		const FFloatReadRef& FadeOutEndIn)
+		const FFloatReadRef& FadeOutEndIn,
+		const FCrossfadeProfileAssetReadRef& ProfileIn,
+		const FOperatorCapturePtr& InCapture,
+		const FLatencyProbePtr& InLatencyProbe)
 		: AudioInput(InAudio),
 		bUseEPCrossfade(bUseEPCrossfadeIn),
 		FloatIn(ValueIn),
@@ -38,44 +48,80 @@ namespace Metasound
 		FadeInEnd(FadeInEndIn),
 		FadeOutStart(FadeOutStartIn),
 		FadeOutEnd(FadeOutEndIn),
+		Profile(ProfileIn),
 		AudioOutput(FAudioBufferWriteRef::CreateNew(InSettings)),
-		NumFramesPerBlock(InSettings.GetNumFramesPerBlock())
+		NumFramesPerBlock(InSettings.GetNumFramesPerBlock()),
+		Quality(FMSUtilsQuality::Get()),
+		Capture(InCapture),
+		LatencyProbe(InLatencyProbe)
 	{
-
+		INC_DWORD_STAT(STAT_MSUtils_CrossfadeByParamOperators);
 	};
 
+	FCBPOperator::~FCBPOperator()
+	{
+		DEC_DWORD_STAT(STAT_MSUtils_CrossfadeByParamOperators);
+	}
+
 	void FCBPOperator::Execute()
 	{
-		FMemory::Memcpy(AudioOutput->GetData(), AudioInput->GetData(), sizeof(float) * AudioInput->Num());
+		SCOPE_CYCLE_COUNTER(STAT_MSUtils_CrossfadeByParamExecute);
+		MSUTILS_EXECUTE_SCOPE(TEXT("Crossfade By Param"));
 
-		if (*FloatIn != FloatInPrev || bInit == false)
+		if (Capture)
+		{
+			// Same order as the replayer below. The profile asset isn't captured, replay uses the fade inputs.
+			const float Controls[] = { *FloatIn, *bUseEPCrossfade ? 1.f : 0.f, *FadeInStart, *FadeInEnd, *FadeOutStart, *FadeOutEnd };
+			Capture->WriteBlock(Controls, MakeArrayView(&AudioInput, 1));
+		}
+
+		const FCrossfadeProfileData* ProfileData = Profile->GetData();
+
+		if (*FloatIn != FloatInPrev || ProfileData != ProfilePrev || bInit == false)
 		{
 			if (!bInit)
 			{
 				bInit = true;
 			}
 
-			float FadeInValue = FMath::GetMappedRangeValueClamped(FVector2D(*FadeInStart, *FadeInEnd), FVector2D(0.f, 1.f), *FloatIn);
-			float FadeOutValue = FMath::GetMappedRangeValueClamped(FVector2D(*FadeOutStart, *FadeOutEnd), FVector2D(1.f, 0.f), *FloatIn);
-			if (*bUseEPCrossfade)
+			if (ProfileData)
 			{
-				Amplitude = FMath::Clamp(FMath::Cos((1.f - (FadeInValue * FadeOutValue)) * HALF_PI), 0.f, 1.f);
+				// Shared baked table, no per-instance mapping
+				Amplitude = ProfileData->GetGain(*FloatIn);
 			}
 			else
 			{
-				Amplitude = FadeInValue * FadeOutValue;
+				Amplitude = GetParamGain();
 			}
 
-			Audio::ArrayFade(*AudioOutput, AmplitudePrev, Amplitude);
+			// Copy and fade in one pass
+			MSUtilsKernels::FadeCopy(*AudioInput, *AudioOutput, Quality.GetRampStartGain(AmplitudePrev, Amplitude), Amplitude);
 			FloatInPrev = *FloatIn;
 			AmplitudePrev = Amplitude;
+			ProfilePrev = ProfileData;
 		}
 		else
 		{
-			Audio::ArrayFade(*AudioOutput, AmplitudePrev, Amplitude);
+			MSUtilsKernels::FadeCopy(*AudioInput, *AudioOutput, Quality.GetRampStartGain(AmplitudePrev, Amplitude), Amplitude);
+		}
+
+		if (LatencyProbe)
+		{
+			LatencyProbe->OnBlock(*FloatIn, MakeArrayView(&Amplitude, 1));
 		}
 	}
 
+	float FCBPOperator::GetParamGain() const
+	{
+		float FadeInValue = FMath::GetMappedRangeValueClamped(FVector2D(*FadeInStart, *FadeInEnd), FVector2D(0.f, 1.f), *FloatIn);
+		float FadeOutValue = FMath::GetMappedRangeValueClamped(FVector2D(*FadeOutStart, *FadeOutEnd), FVector2D(1.f, 0.f), *FloatIn);
+		if (*bUseEPCrossfade)
+		{
+			return Quality.EqualPowerGain(1.f - (FadeInValue * FadeOutValue));
+		}
+		return FadeInValue * FadeOutValue;
+	}
+
 	const FVertexInterface& FCBPOperator::DeclareVertexInterface()
 	{
 		using namespace ECBPNodeNames;
@@ -88,7 +134,8 @@ namespace Metasound
 				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFadeInEnd)),
 				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFadeOutStart)),
 				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFadeOutEnd)),
-				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam))
+				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam)),
+				TInputDataVertexModel<FCrossfadeProfileAsset>(METASOUND_GET_PARAM_NAME_AND_METADATA(InProfile))
 			),
 			FOutputVertexInterface(
 				TOutputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutAudioParam))
@@ -108,7 +155,7 @@ namespace Metasound
 				{
 						{ TEXT("UE"), TEXT("CrossfadeByParam"), TEXT("Audio") },
 						1, // Major Version
-						0, // Minor Version
+						1, // Minor Version
 						METASOUND_LOCTEXT("CBPDisplayName", "Crossfade By Param (Mono)"),
 						METASOUND_LOCTEXT("CPTestNodeDesc", "A node for fading in and out a single audio channel by a mapped range"),
 						PluginAuthor,
@@ -136,6 +183,7 @@ namespace Metasound
 		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFadeOutStart), FadeOutStart);
 		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFadeOutEnd), FadeOutEnd);
 		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InAudioParam), AudioInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InProfile), Profile);
 	}
 
 	void FCBPOperator::BindOutputs(FOutputVertexInterfaceData& InOutVertexData)
@@ -159,11 +207,20 @@ namespace Metasound
 		TDataReadReference<float> FadeOutEndFloat = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InFadeOutEnd), InParams.OperatorSettings);
 
 		FAudioBufferReadRef AudioIn1 = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InAudioParam), InParams.OperatorSettings);
+		FCrossfadeProfileAssetReadRef ProfileIn = InputCollection.GetDataReadReferenceOrConstruct<FCrossfadeProfileAsset>(METASOUND_GET_PARAM_NAME(InProfile));
+		FOperatorCapturePtr Capture = FOperatorCapture::Open(TEXT("CrossfadeByParam"), InParams.Node.GetInstanceName().ToString(), InParams.OperatorSettings, 6, 1);
+		FLatencyProbePtr LatencyProbe = FLatencyProbe::Open(TEXT("CrossfadeByParam"), METASOUND_GET_PARAM_NAME(InFloatValue), InParams.OperatorSettings, 1, FMSUtilsQuality::Get().bPerBlockRamps);
 
 		//this class is FCBPOperator, which inherits from TExecutableOperator, which inherits from IOperator. IOperator type is returned
-		return MakeUnique<FCBPOperator>(InParams.OperatorSettings, AudioIn1, BoolInput, FloatInputA, FadeInStartFloat, FadeInEndFloat, FadeOutStartFloat, FadeOutEndFloat);
+		return MakeUnique<FCBPOperator>(InParams.OperatorSettings, AudioIn1, BoolInput, FloatInputA, FadeInStartFloat, FadeInEndFloat, FadeOutStartFloat, FadeOutEndFloat, ProfileIn, Capture, LatencyProbe);
 	}
 
+	static FOperatorCaptureReplay CBPReplay(TEXT("CrossfadeByParam"), 6, 1, [](FCaptureReplayContext& Context) -> TUniquePtr<IReplayOperator>
+		{
+			return MakeUnique<TReplayOperator<FCBPOperator>>(Context.GetSettings(), Context.GetAudio(0), Context.GetBool(1), Context.GetFloat(0),
+				Context.GetFloat(2), Context.GetFloat(3), Context.GetFloat(4), Context.GetFloat(5), FCrossfadeProfileAssetWriteRef::CreateNew(), nullptr, nullptr);
+		});
+
 	// Register node
 	METASOUND_REGISTER_NODE(FCBPNode);
 }
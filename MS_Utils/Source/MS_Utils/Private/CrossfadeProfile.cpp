@@ -0,0 +1,102 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "CrossfadeProfile.h"
+#include "MSUtilsQuality.h"
+
+#include "MetasoundDataTypeRegistrationMacro.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(CrossfadeProfile)
+
+REGISTER_METASOUND_DATATYPE(Metasound::FCrossfadeProfileAsset, "CrossfadeProfile", Metasound::ELiteralType::UObjectProxy, UCrossfadeProfile);
+
+float FCrossfadeProfileData::GetGain(float Value) const
+{
+	if (GainTable.Num() < 2)
+	{
+		return 1.f;
+	}
+
+	const float Position = FMath::Clamp((Value - TableMin) / (TableMax - TableMin), 0.f, 1.f) * (GainTable.Num() - 1);
+	const int32 Index = FMath::Min((int32)Position, GainTable.Num() - 2);
+	return FMath::Lerp(GainTable[Index], GainTable[Index + 1], Position - Index);
+}
+
+void UCrossfadeProfile::PostInitProperties()
+{
+	Super::PostInitProperties();
+	Bake();
+}
+
+void UCrossfadeProfile::PostLoad()
+{
+	Super::PostLoad();
+	Bake();
+}
+
+#if WITH_EDITOR
+void UCrossfadeProfile::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// Operators already running keep the data they were given. New ones pick up the rebaked table.
+	Bake();
+}
+#endif
+
+void UCrossfadeProfile::Bake()
+{
+	TSharedRef<FCrossfadeProfileData, ESPMode::ThreadSafe> Data = MakeShared<FCrossfadeProfileData, ESPMode::ThreadSafe>();
+	Data->FadeInStart = FadeInStart;
+	Data->FadeInEnd = FadeInEnd;
+	Data->FadeOutStart = FadeOutStart;
+	Data->FadeOutEnd = FadeOutEnd;
+	Data->GainLaw = GainLaw;
+
+	// Outside the zone edges the mapped gain is constant, so the table only needs to span them
+	Data->TableMin = FMath::Min(FMath::Min(FadeInStart, FadeInEnd), FMath::Min(FadeOutStart, FadeOutEnd));
+	Data->TableMax = FMath::Max(FMath::Max(FadeInStart, FadeInEnd), FMath::Max(FadeOutStart, FadeOutEnd));
+	if (Data->TableMax <= Data->TableMin)
+	{
+		Data->TableMax = Data->TableMin + 1.f;
+	}
+
+	// Baked with the gain law the nodes use at the current quality, so a profile and the fade inputs give the same curve
+	const FMSUtilsQuality Quality = FMSUtilsQuality::Get();
+
+	const int32 NumEntries = FMath::Clamp(TableSize, 2, 4096);
+	Data->GainTable.SetNumUninitialized(NumEntries);
+	for (int32 i = 0; i < NumEntries; ++i)
+	{
+		const float Value = FMath::Lerp(Data->TableMin, Data->TableMax, (float)i / (NumEntries - 1));
+
+		// Same mapping as the Crossfade By Param nodes
+		const float FadeInValue = FMath::GetMappedRangeValueClamped(FVector2D(FadeInStart, FadeInEnd), FVector2D(0.f, 1.f), Value);
+		const float FadeOutValue = FMath::GetMappedRangeValueClamped(FVector2D(FadeOutStart, FadeOutEnd), FVector2D(1.f, 0.f), Value);
+		if (GainLaw == ECrossfadeGainLaw::EqualPower)
+		{
+			Data->GainTable[i] = Quality.EqualPowerGain(1.f - (FadeInValue * FadeOutValue));
+		}
+		else
+		{
+			Data->GainTable[i] = FadeInValue * FadeOutValue;
+		}
+	}
+
+	BakedData = Data;
+}
+
+TSharedPtr<Audio::IProxyData> UCrossfadeProfile::CreateProxyData(const Audio::FProxyDataInitParams& InitParams)
+{
+	return MakeShared<FCrossfadeProfileProxy>(BakedData);
+}
+
+namespace Metasound
+{
+	FCrossfadeProfileAsset::FCrossfadeProfileAsset(const TSharedPtr<Audio::IProxyData>& InInitData)
+	{
+		if (InInitData.IsValid() && InInitData->CheckTypeCast<FCrossfadeProfileProxy>())
+		{
+			Data = InInitData->GetAs<FCrossfadeProfileProxy>().GetData();
+		}
+	}
+}
@@ -1,12 +1,18 @@
 // Copyright Dale Grinsell 2024. All Rights Reserved. 
 
 #include "EPLightWeight.h"
+#include "MS_Utils.h"
+#include "MSUtilsKernels.h"
+#include "RenderThreadGuard.h"
 
 #include "DSP/FloatArrayMath.h"
 #include "MetasoundStandardNodesCategories.h"
 
 #define LOCTEXT_NAMESPACE "MetasoundStandardNodes_EPCrossfade_Lightweight"
 
+DECLARE_CYCLE_STAT(TEXT("EP Lightweight Execute"), STAT_MSUtils_EPLightweightExecute, STATGROUP_MSUtils);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("EP Lightweight Operators"), STAT_MSUtils_EPLightweightOperators, STATGROUP_MSUtils);
+
 namespace Metasound
 {
 	//the below stores name and tooltip information for each input/output pin - Name and then description.
@@ -16,49 +22,85 @@ namespace Metasound
 		METASOUND_PARAM(InFloatValue, "Crossfade Value", "Crossfade Value");
 		METASOUND_PARAM(InAudioParam, "Audio In 1", "Input Audio Channel 1");
 		METASOUND_PARAM(InAudioParam2, "Audio In 2", "Input Audio Channel 2");
+		METASOUND_PARAM(InTrimOne, "Trim 1", "Linear gain for Audio In 1. Negative values invert its polarity.");
+		METASOUND_PARAM(InTrimTwo, "Trim 2", "Linear gain for Audio In 2. Negative values invert its polarity.");
+		METASOUND_PARAM(InMasterGain, "Master Gain", "Linear gain applied to the crossfaded output");
 		METASOUND_PARAM(OutAudioParam, "Audio Out", "Audio Output");
 	}
 
 	FEPXFOperator::FEPXFOperator(const FOperatorSettings& InSettings,
 		const FAudioBufferReadRef& InAudio,
 		const FAudioBufferReadRef& InAudio2,
-		const FFloatReadRef& ValueIn)
+		const FFloatReadRef& ValueIn,
+		const FFloatReadRef& TrimOneIn,
+		const FFloatReadRef& TrimTwoIn,
+		const FFloatReadRef& MasterGainIn,
+		const FOperatorCapturePtr& InCapture,
+		const FLatencyProbePtr& InLatencyProbe)
 		: AudioInput(InAudio),
 		AudioInput2(InAudio2),
 		FloatIn(ValueIn),
+		TrimOne(TrimOneIn),
+		TrimTwo(TrimTwoIn),
+		MasterGain(MasterGainIn),
 		AudioOutput(FAudioBufferWriteRef::CreateNew(InSettings)),
-		NumFramesPerBlock(InSettings.GetNumFramesPerBlock())
+		NumFramesPerBlock(InSettings.GetNumFramesPerBlock()),
+		Quality(FMSUtilsQuality::Get()),
+		Capture(InCapture),
+		LatencyProbe(InLatencyProbe)
 	{
-
+		INC_DWORD_STAT(STAT_MSUtils_EPLightweightOperators);
 	};
 
+	FEPXFOperator::~FEPXFOperator()
+	{
+		DEC_DWORD_STAT(STAT_MSUtils_EPLightweightOperators);
+	}
+
 	void FEPXFOperator::Execute()
 	{
-		if (*FloatIn != FloatInPrev)
+		SCOPE_CYCLE_COUNTER(STAT_MSUtils_EPLightweightExecute);
+		MSUTILS_EXECUTE_SCOPE(TEXT("EP Crossfade Lightweight"));
+
+		if (Capture)
 		{
-			SignalOneFloat = FMath::Clamp(FMath::Cos(*FloatIn * HALF_PI), 0.f, 1.f);
-			SignalTwoFloat = FMath::Clamp(FMath::Cos((1 - *FloatIn) * (HALF_PI)), 0.f, 1.f);
+			const float Controls[] = { *FloatIn, *TrimOne, *TrimTwo, *MasterGain };
+			const FAudioBufferReadRef AudioInputs[] = { AudioInput, AudioInput2 };
+			Capture->WriteBlock(Controls, AudioInputs);
 		}
-	
-			FAudioBuffer& OutputBuffer = *AudioOutput;
-			OutputBuffer.Zero();
-			TArrayView<float> OutAudioBufferView(OutputBuffer.GetData(), OutputBuffer.Num());
-
-			MixInInput(AudioInput, OutAudioBufferView, SignalOnePreviousGain, SignalOneFloat);
-			MixInInput(AudioInput2, OutAudioBufferView, SignalTwoPreviousGain, SignalTwoFloat);
-		
+
 		if (*FloatIn != FloatInPrev)
 		{
+			SignalOneFloat = Quality.EqualPowerGain(*FloatIn);
+			SignalTwoFloat = Quality.EqualPowerGain(1 - *FloatIn);
 			FloatInPrev = *FloatIn;
-			SignalOnePreviousGain = SignalOneFloat;
-			SignalTwoPreviousGain = SignalTwoFloat;
+		}
+
+		// Trims and master gain ride on the crossfade ramps, so they add no passes over the audio
+		const float SignalOneGain = SignalOneFloat * *TrimOne * *MasterGain;
+		const float SignalTwoGain = SignalTwoFloat * *TrimTwo * *MasterGain;
+
+		FAudioBuffer& OutputBuffer = *AudioOutput;
+		OutputBuffer.Zero();
+		TArrayView<float> OutAudioBufferView(OutputBuffer.GetData(), OutputBuffer.Num());
+
+		MixInInput(AudioInput, OutAudioBufferView, SignalOnePreviousGain, SignalOneGain);
+		MixInInput(AudioInput2, OutAudioBufferView, SignalTwoPreviousGain, SignalTwoGain);
+
+		SignalOnePreviousGain = SignalOneGain;
+		SignalTwoPreviousGain = SignalTwoGain;
+
+		if (LatencyProbe)
+		{
+			const float Gains[] = { SignalOneGain, SignalTwoGain };
+			LatencyProbe->OnBlock(*FloatIn, Gains);
 		}
 	}
 
 	void FEPXFOperator::MixInInput(FAudioBufferReadRef& InBuffer, TArrayView<float>& OutBufferView, float PrevGain, float NewGain)
 	{
 		TArrayView<const float> BufferView((*InBuffer).GetData(), NumFramesPerBlock);
-		Audio::ArrayMixIn(BufferView, OutBufferView, PrevGain, NewGain);
+		MSUtilsKernels::MixIn(BufferView, OutBufferView, Quality.GetRampStartGain(PrevGain, NewGain), NewGain);
 	}
 
 	const FVertexInterface& FEPXFOperator::DeclareVertexInterface()
@@ -69,7 +111,10 @@ namespace Metasound
 			FInputVertexInterface(
 				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFloatValue)),
 				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam)),
-				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam2))
+				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam2)),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InTrimOne), 1.0f),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InTrimTwo), 1.0f),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InMasterGain), 1.0f)
 			),
 			FOutputVertexInterface(
 				TOutputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutAudioParam))
@@ -89,7 +134,7 @@ namespace Metasound
 				{
 						{ TEXT("UE"), TEXT("EPLight"), TEXT("Audio") },
 						1, // Major Version
-						0, // Minor Version
+						1, // Minor Version
 						METASOUND_LOCTEXT("EPTestDisplayName", "EP Crossfade Lightweight"),
 						METASOUND_LOCTEXT("EPTestNodeDesc", "Crossfades between two audio channels by the cos equal power function"),
 						PluginAuthor,
@@ -113,6 +158,9 @@ namespace Metasound
 		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFloatValue), FloatIn);
 		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InAudioParam), AudioInput);
 		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InAudioParam2), AudioInput2);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InTrimOne), TrimOne);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InTrimTwo), TrimTwo);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InMasterGain), MasterGain);
 	}
 
 	void FEPXFOperator::BindOutputs(FOutputVertexInterfaceData& InOutVertexData)
@@ -131,11 +179,23 @@ namespace Metasound
 		TDataReadReference<float> FloatInputA = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InFloatValue), InParams.OperatorSettings);
 		FAudioBufferReadRef AudioIn1 = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InAudioParam), InParams.OperatorSettings);
 		FAudioBufferReadRef AudioIn2 = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InAudioParam2), InParams.OperatorSettings);
+		TDataReadReference<float> TrimOneIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InTrimOne), InParams.OperatorSettings);
+		TDataReadReference<float> TrimTwoIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InTrimTwo), InParams.OperatorSettings);
+		TDataReadReference<float> MasterGainIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InMasterGain), InParams.OperatorSettings);
+
+		FOperatorCapturePtr Capture = FOperatorCapture::Open(TEXT("EPLight"), InParams.Node.GetInstanceName().ToString(), InParams.OperatorSettings, 4, 2);
+		FLatencyProbePtr LatencyProbe = FLatencyProbe::Open(TEXT("EPLight"), METASOUND_GET_PARAM_NAME(InFloatValue), InParams.OperatorSettings, 2, FMSUtilsQuality::Get().bPerBlockRamps);
 
 		//this class is FEPXFOperator, which inherits from TExecutableOperator, which inherits from IOperator. IOperator type is returned
-		return MakeUnique<FEPXFOperator>(InParams.OperatorSettings, AudioIn1, AudioIn2, FloatInputA);
+		return MakeUnique<FEPXFOperator>(InParams.OperatorSettings, AudioIn1, AudioIn2, FloatInputA, TrimOneIn, TrimTwoIn, MasterGainIn, Capture, LatencyProbe);
 	}
 
+	static FOperatorCaptureReplay EPLightReplay(TEXT("EPLight"), 4, 2, [](FCaptureReplayContext& Context) -> TUniquePtr<IReplayOperator>
+		{
+			return MakeUnique<TReplayOperator<FEPXFOperator>>(Context.GetSettings(), Context.GetAudio(0), Context.GetAudio(1), Context.GetFloat(0),
+				Context.GetFloat(1), Context.GetFloat(2), Context.GetFloat(3), nullptr, nullptr);
+		});
+
 	// Register node
 	METASOUND_REGISTER_NODE(FEPXFNode);
 }
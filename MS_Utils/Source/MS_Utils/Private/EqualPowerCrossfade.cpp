@@ -1,5 +1,13 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "EqualPowerCrossfade.h"
+#include "MS_Utils.h"
+#include "MSUtilsKernels.h"
+#include "MSUtilsQuality.h"
+#include "MSUtilsVertexNames.h"
+#include "LatencyProbe.h"
+#include "OperatorCapture.h"
+#include "RenderThreadGuard.h"
 #include "MetasoundNodeRegistrationMacro.h"
 #include "MetasoundAudioBuffer.h"
 #include "CoreMinimal.h"
@@ -17,9 +25,13 @@
 
 #define LOCTEXT_NAMESPACE "MetasoundStandardNodes_EPCrossfade"
 
+DECLARE_CYCLE_STAT(TEXT("EP Crossfade Execute"), STAT_MSUtils_EPCrossfadeExecute, STATGROUP_MSUtils);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("EP Crossfade Operators"), STAT_MSUtils_EPCrossfadeOperators, STATGROUP_MSUtils);
+
 #define REGISTER_EPCROSSFADE_NODE(Number) \
 	using FEPCrossfadeNode##Number = TEPCrossfadeNode<Number>; \
 	METASOUND_REGISTER_NODE(FEPCrossfadeNode##Number) \
+	static FOperatorCaptureReplay EPCrossfadeReplay##Number(TEPXFOperator<Number>::GetCaptureType(), TEPXFOperator<Number>::NumControls, Number, &TEPXFOperator<Number>::CreateReplayOperator); \
 
 
 namespace Metasound
@@ -27,11 +39,18 @@ namespace Metasound
 	namespace EPXFVertexNames
 	{
 		METASOUND_PARAM(InputCrossfadeValue, "Crossfade Value", "Crossfade value to crossfade between inputs.")
+		METASOUND_PARAM(InputMasterGain, "Master Gain", "Linear gain applied to the crossfaded output.")
+		METASOUND_PARAM(InputLoudnessCompensation, "Loudness Compensation", "Track the level of the two inputs being mixed and scale their gains so the output level moves evenly in dB between them, instead of dipping or bumping when their levels differ.")
 			METASOUND_PARAM(OutputTrigger, "Out", "Output value.")
 
-			const FVertexName GetInputName(uint32 InIndex)
+		constexpr uint32 MaxNumInputs = 8;
+
+		const FVertexName& GetInputName(uint32 InIndex)
 		{
-			return *FString::Format(TEXT("In {0}"), { InIndex });
+			static const TArray<FVertexName> InputNames = MSUtilsVertexNames::MakeNames(TEXT("In {0}"), MaxNumInputs);
+
+			check(InIndex < MaxNumInputs);
+			return InputNames[InIndex];
 		}
 
 		const FText GetInputDescription(uint32 InIndex)
@@ -43,23 +62,80 @@ namespace Metasound
 		{
 			return METASOUND_LOCTEXT_FORMAT("EPXFInputDisplayName", "In {0}", InIndex);
 		}
+
+		const FVertexName& GetTrimName(uint32 InIndex)
+		{
+			static const TArray<FVertexName> TrimNames = MSUtilsVertexNames::MakeNames(TEXT("Trim {0}"), MaxNumInputs);
+
+			check(InIndex < MaxNumInputs);
+			return TrimNames[InIndex];
+		}
+
+		const FDataVertexMetadata& GetTrimMetadata(uint32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> TrimMetadata = MSUtilsVertexNames::MakeMetadata(MaxNumInputs, [](int32 i) -> FDataVertexMetadata
+				{
+					return { METASOUND_LOCTEXT_FORMAT("EPXFTrimDesc", "Linear gain for input {0}. Negative values invert its polarity.", i),
+						METASOUND_LOCTEXT_FORMAT("EPXFTrimDisplayName", "Trim {0}", i) };
+				});
+
+			check(InIndex < MaxNumInputs);
+			return TrimMetadata[InIndex];
+		}
+
+		const FDataVertexMetadata& GetInputMetadata(uint32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> InputMetadata = MSUtilsVertexNames::MakeMetadata(MaxNumInputs, [](int32 i) -> FDataVertexMetadata
+				{
+					return { GetInputDescription(i), GetInputDisplayName(i) };
+				});
+
+			check(InIndex < MaxNumInputs);
+			return InputMetadata[InIndex];
+		}
 	}
 
 	class TEPXFHelper
 	{
 	public:
-		TEPXFHelper(int32 InNumFramesPerBlock, int32 NumInputs)
-			: NumFramesPerBlock(InNumFramesPerBlock), InputAmount(NumInputs)
+		// Time constant of the running level used by loudness compensation
+		static constexpr float LevelTimeConstantSeconds = 0.3f;
+
+		// Compensation is limited to +/-12 dB, and inputs below -80 dBFS are treated as silent and left uncompensated
+		static constexpr float MinCompensation = 0.25f;
+		static constexpr float MaxCompensation = 4.f;
+		static constexpr float MinMeanSquare = 1e-8f;
+
+		TEPXFHelper(int32 InNumFramesPerBlock, float InSampleRate, int32 NumInputs, const FMSUtilsQuality& InQuality)
+			: NumFramesPerBlock(InNumFramesPerBlock), InputAmount(NumInputs), Quality(InQuality)
 		{
 			PrevGains.AddZeroed(NumInputs);
 			CurrentGains.AddZeroed(NumInputs);
 			NeedsMixing.AddZeroed(NumInputs);
+			MeanSquares.AddZeroed(NumInputs);
+			HasLevel.AddZeroed(NumInputs);
+
+			LevelSmoothing = 1.f - FMath::Exp(-InNumFramesPerBlock / (LevelTimeConstantSeconds * InSampleRate));
 		}
 
-		void GetCrossfadeOutput(int32 IndexA, int32 IndexB, float Alpha, const TArray<FAudioBufferReadRef>& InAudioBuffersValues, FAudioBuffer& OutAudioBuffer)
+		// Trims and MasterGain are folded into each input's gain ramp, so they cost nothing beyond the crossfade's own mix pass
+		void GetCrossfadeOutput(int32 IndexA, int32 IndexB, float Alpha, TArrayView<const FAudioBufferReadRef> InAudioBuffersValues, TArrayView<const FFloatReadRef> Trims, float MasterGain, bool bLoudnessCompensation, FAudioBuffer& OutAudioBuffer)
 		{
-			float EPXFValueA = FMath::Clamp(FMath::Cos(Alpha * HALF_PI), 0.f, 1.f);
-			float EPXFValueB = FMath::Clamp(FMath::Cos((1 - Alpha) * (HALF_PI)), 0.f, 1.f);
+			float EPXFValueA = 0.f;
+			float EPXFValueB = 0.f;
+			Quality.GetPairGains(Alpha, EPXFValueA, EPXFValueB);
+
+			if (bLoudnessCompensation)
+			{
+				// A member that has just become active has no level yet. Measuring it from this block keeps the
+				// compensation from sitting at 1 for a block and then jumping once the level arrives.
+				SeedLevel(IndexA, InAudioBuffersValues[IndexA]);
+				SeedLevel(IndexB, InAudioBuffersValues[IndexB]);
+
+				const float Compensation = GetLoudnessCompensation(IndexA, IndexB, Alpha, EPXFValueA, EPXFValueB, *Trims[IndexA], *Trims[IndexB]);
+				EPXFValueA *= Compensation;
+				EPXFValueB *= Compensation;
+			}
 			//Uncomment below to turn on debug of crossfade values
 			/*GEngine->AddOnScreenDebugMessage(1, 15.0f, FColor::Red, FString::Printf(TEXT("EPXFValueA: %f"), EPXFValueA));
 			GEngine->AddOnScreenDebugMessage(2, 15.0f, FColor::Blue, FString::Printf(TEXT("EPXFValueB: %f"), EPXFValueB));*/
@@ -71,21 +147,22 @@ namespace Metasound
 				// so for example, if the alpha is 0.4 and IndexA is 3, set index 3 to 1.0 - alpha which is 0.6.
 				if (i == IndexA)
 				{
-					CurrentGains[i] = EPXFValueA;
-					NeedsMixing[i] = true;
+					CurrentGains[i] = EPXFValueA * *Trims[i] * MasterGain;
+					NeedsMixing[i] = CurrentGains[i] != 0.0f || PrevGains[i] != 0.0f;
 				}
 				// Cycling through the inputs, if the we come to IndexB, the resulting volume is set to the Alpha.
 				// so for example, if the alpha is 0.4 and IndexB is 4, set index 4 to 0.4.
 				else if (i == IndexB)
 				{
-					CurrentGains[i] = EPXFValueB;
-					NeedsMixing[i] = true;
+					CurrentGains[i] = EPXFValueB * *Trims[i] * MasterGain;
+					NeedsMixing[i] = CurrentGains[i] != 0.0f || PrevGains[i] != 0.0f;
 				}
 				else
 				{
 					CurrentGains[i] = 0.0f;
 
-					// If we were already at 0.0f, don't need to do any mixing!
+					// If we were already at 0.0f, don't need to do any mixing! Otherwise the input ramps to 0 over this
+					// block and drops out on the next, which keeps the two-input fallback from clicking.
 					if (PrevGains[i] == 0.0f)
 					{
 						NeedsMixing[i] = false;
@@ -106,30 +183,95 @@ namespace Metasound
 					// Copy the input to the output
 					const FAudioBufferReadRef& InBuff = InAudioBuffersValues[i];
 					TArrayView<const float> BufferView((*InBuff).GetData(), NumFramesPerBlock);
-					//The below is not used anywhere
-					const float* BufferPtr = (*InBuff).GetData();
 
 					// mix in and fade to the target gain values
-					Audio::ArrayMixIn(BufferView, OutAudioBufferView, PrevGains[i], CurrentGains[i]);
+					if (bLoudnessCompensation)
+					{
+						// The level is measured in the same pass and applies from the next block
+						const float SumOfSquares = MSUtilsKernels::MixInAndMeasure(BufferView, OutAudioBufferView, Quality.GetRampStartGain(PrevGains[i], CurrentGains[i]), CurrentGains[i]);
+						const float BlockMeanSquare = SumOfSquares / NumFramesPerBlock;
+						MeanSquares[i] = HasLevel[i] ? MeanSquares[i] + LevelSmoothing * (BlockMeanSquare - MeanSquares[i]) : BlockMeanSquare;
+						HasLevel[i] = true;
+					}
+					else
+					{
+						MSUtilsKernels::MixIn(BufferView, OutAudioBufferView, Quality.GetRampStartGain(PrevGains[i], CurrentGains[i]), CurrentGains[i]);
+					}
+				}
+				else
+				{
+					// Idle inputs aren't measured, so their level is stale by the time they come back
+					HasLevel[i] = false;
 				}
 			}
 
-			// Copy the CurrentGains to PrevGains
-			PrevGains = CurrentGains;
+			// Every CurrentGains entry is rewritten next block, so swapping is enough. Assigning could reallocate.
+			Swap(PrevGains, CurrentGains);
+		}
+
+		// Each input's gain at the end of the last block
+		TArrayView<const float> GetGains() const
+		{
+			return PrevGains;
 		}
 
 	private:
+		void SeedLevel(int32 Index, const FAudioBufferReadRef& InAudioBuffer)
+		{
+			if (!HasLevel[Index])
+			{
+				const TArrayView<const float> BufferView((*InAudioBuffer).GetData(), NumFramesPerBlock);
+				MeanSquares[Index] = MSUtilsKernels::SumOfSquares(BufferView) / NumFramesPerBlock;
+				HasLevel[Index] = true;
+			}
+		}
+
+		// Scale for both gains that makes the mix level of the pair follow a straight line in dB from A's level to B's.
+		// Levels include the trims, which shift each input's effective level.
+		float GetLoudnessCompensation(int32 IndexA, int32 IndexB, float Alpha, float GainA, float GainB, float TrimA, float TrimB) const
+		{
+			if (IndexA == IndexB || !HasLevel[IndexA] || !HasLevel[IndexB])
+			{
+				return 1.f;
+			}
+
+			const float PowerA = MeanSquares[IndexA] * TrimA * TrimA;
+			const float PowerB = MeanSquares[IndexB] * TrimB * TrimB;
+			if (PowerA < MinMeanSquare || PowerB < MinMeanSquare)
+			{
+				return 1.f;
+			}
+
+			const float TargetPower = FMath::Exp((1.f - Alpha) * FMath::Loge(PowerA) + Alpha * FMath::Loge(PowerB));
+			const float MixPower = GainA * GainA * PowerA + GainB * GainB * PowerB;
+			return FMath::Clamp(FMath::Sqrt(TargetPower / MixPower), MinCompensation, MaxCompensation);
+		}
+
 		int32 InputAmount;
 		int32 NumFramesPerBlock = 0;
 		TArray<float> PrevGains;
 		TArray<float> CurrentGains;
 		TArray<bool> NeedsMixing;
+		FMSUtilsQuality Quality;
+
+		// Running mean square per input, only updated while the input is being mixed or is one of the pair
+		TArray<float> MeanSquares;
+		TArray<bool> HasLevel;
+		float LevelSmoothing = 1.f;
 	};
 
 	template<int32 NumInputs>
 	class TEPXFOperator : public TExecutableOperator<TEPXFOperator<NumInputs>>
 	{
+		static_assert(NumInputs <= EPXFVertexNames::MaxNumInputs, "EPXFVertexNames::MaxNumInputs must cover every registered input count");
+
 	public:
+		using FInputArray = TArray<TDataReadReference<FAudioBuffer>, TInlineAllocator<NumInputs>>;
+		using FTrimArray = TArray<FFloatReadRef, TInlineAllocator<NumInputs>>;
+
+		// Captured controls: Crossfade Value, Master Gain, one trim per input and Loudness Compensation
+		static constexpr int32 NumControls = 3 + NumInputs;
+
 		static const FVertexInterface& GetVertexInterface()
 		{
 			using namespace EPXFVertexNames;
@@ -139,16 +281,17 @@ namespace Metasound
 					FInputVertexInterface InputInterface;
 
 					InputInterface.Add(TInputDataVertex<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputCrossfadeValue)));
+					InputInterface.Add(TInputDataVertex<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputMasterGain), 1.0f));
+					InputInterface.Add(TInputDataVertex<bool>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputLoudnessCompensation), false));
 
 					for (uint32 i = 0; i < NumInputs; ++i)
 					{
-						const FDataVertexMetadata InputMetadata
-						{
-							GetInputDescription(i),
-							GetInputDisplayName(i)
-						};
+						InputInterface.Add(TInputDataVertex<FAudioBuffer>(GetInputName(i), GetInputMetadata(i)));
+					}
 
-						InputInterface.Add(TInputDataVertex<FAudioBuffer>(GetInputName(i), InputMetadata));
+					for (uint32 i = 0; i < NumInputs; ++i)
+					{
+						InputInterface.Add(TInputDataVertex<float>(GetTrimName(i), GetTrimMetadata(i), 1.0f));
 					}
 
 					FOutputVertexInterface OutputInterface;
@@ -175,7 +318,7 @@ namespace Metasound
 					{
 						FNodeClassName { "EPXF", OperatorName, DataTypeName },
 						1, // Major Version
-						0, // Minor Version
+						2, // Minor Version
 						NodeDisplayName,
 						NodeDescription,
 						PluginAuthor,
@@ -201,37 +344,76 @@ namespace Metasound
 
 			FFloatReadRef CrossfadeValue = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InputCrossfadeValue), InParams.OperatorSettings);
 
-			TArray<TDataReadReference<FAudioBuffer>> InputValues;
+			FFloatReadRef MasterGain = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InputMasterGain), InParams.OperatorSettings);
+			FBoolReadRef LoudnessCompensation = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<bool>(InputInterface, METASOUND_GET_PARAM_NAME(InputLoudnessCompensation), InParams.OperatorSettings);
+
+			FInputArray InputValues;
+			FTrimArray TrimValues;
 			for (uint32 i = 0; i < NumInputs; ++i)
 			{
 				InputValues.Add(InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, GetInputName(i), InParams.OperatorSettings));
+				TrimValues.Add(InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, GetTrimName(i), InParams.OperatorSettings));
 			}
 
-			return MakeUnique<TEPXFOperator<NumInputs>>(InParams.OperatorSettings, CrossfadeValue, MoveTemp(InputValues));
+			FOperatorCapturePtr Capture = FOperatorCapture::Open(GetCaptureType(), InParams.Node.GetInstanceName().ToString(), InParams.OperatorSettings, NumControls, NumInputs);
+			FLatencyProbePtr LatencyProbe = FLatencyProbe::Open(GetCaptureType(), METASOUND_GET_PARAM_NAME(InputCrossfadeValue), InParams.OperatorSettings, NumInputs, FMSUtilsQuality::Get().bPerBlockRamps);
+
+			return MakeUnique<TEPXFOperator<NumInputs>>(InParams.OperatorSettings, CrossfadeValue, MasterGain, LoudnessCompensation, MoveTemp(InputValues), MoveTemp(TrimValues), Capture, LatencyProbe);
+		}
+
+		static FName GetCaptureType()
+		{
+			static const FName CaptureType = *FString::Printf(TEXT("EPCrossfade%d"), NumInputs);
+			return CaptureType;
+		}
+
+		static TUniquePtr<IReplayOperator> CreateReplayOperator(FCaptureReplayContext& Context)
+		{
+			// Controls are Crossfade Value, Master Gain, the trims, then Loudness Compensation
+			FInputArray InputValues;
+			FTrimArray TrimValues;
+			for (uint32 i = 0; i < NumInputs; ++i)
+			{
+				InputValues.Add(Context.GetAudio(i));
+				TrimValues.Add(Context.GetFloat(2 + i));
+			}
+			return MakeUnique<TReplayOperator<TEPXFOperator<NumInputs>>>(Context.GetSettings(), Context.GetFloat(0), Context.GetFloat(1), Context.GetBool(2 + NumInputs),
+				MoveTemp(InputValues), MoveTemp(TrimValues), nullptr, nullptr);
 		}
 
 
-		TEPXFOperator(const FOperatorSettings& InSettings, const FFloatReadRef& InCrossfadeValue, TArray<TDataReadReference<FAudioBuffer>>&& InInputValues)
+		TEPXFOperator(const FOperatorSettings& InSettings, const FFloatReadRef& InCrossfadeValue, const FFloatReadRef& InMasterGain, const FBoolReadRef& InLoudnessCompensation, FInputArray&& InInputValues, FTrimArray&& InTrimValues, const FOperatorCapturePtr& InCapture, const FLatencyProbePtr& InLatencyProbe)
 			: CrossfadeValue(InCrossfadeValue)
+			, MasterGain(InMasterGain)
+			, LoudnessCompensation(InLoudnessCompensation)
 			, InputValues(MoveTemp(InInputValues))
+			, TrimValues(MoveTemp(InTrimValues))
 			, OutputValue(TDataWriteReferenceFactory<FAudioBuffer>::CreateAny(InSettings))
-			, Crossfader(InSettings.GetNumFramesPerBlock(), NumInputs)
-
+			, Crossfader(InSettings.GetNumFramesPerBlock(), InSettings.GetSampleRate(), NumInputs, FMSUtilsQuality::Get())
+			, Capture(InCapture)
+			, LatencyProbe(InLatencyProbe)
 		{
+			INC_DWORD_STAT(STAT_MSUtils_EPCrossfadeOperators);
 			PerformCrossfadeOutput();
 		}
 
-		virtual ~TEPXFOperator() = default;
+		virtual ~TEPXFOperator()
+		{
+			DEC_DWORD_STAT(STAT_MSUtils_EPCrossfadeOperators);
+		}
 
 
 		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override
 		{
 			using namespace EPXFVertexNames;
 			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputCrossfadeValue), CrossfadeValue);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputMasterGain), MasterGain);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputLoudnessCompensation), LoudnessCompensation);
 
 			for (uint32 i = 0; i < NumInputs; ++i)
 			{
 				InOutVertexData.BindReadVertex(GetInputName(i), InputValues[i]);
+				InOutVertexData.BindReadVertex(GetTrimName(i), TrimValues[i]);
 			}
 		}
 
@@ -266,17 +448,14 @@ namespace Metasound
 			if (!FMath::IsNearlyEqual(CurrentCrossfadeValue, PrevCrossfadeValue))
 			{
 				PrevCrossfadeValue = CurrentCrossfadeValue;
-				//Set IndexA to the integer below the currentcrossfadevalue.
-				IndexA = (int32)FMath::Floor(CurrentCrossfadeValue);
-				//Set IndexB to the integer above Index A giving a range between them, for example, 3 - 4.
-				IndexB = FMath::Clamp(IndexA + 1, 0.0f, (float)(NumInputs - 1));
+				//IndexA and IndexB are the inputs either side of the crossfade value, for example 3 - 4.
 				//Alpha is the float value between the two integers. So if the crossfade value is 3.4, the alpha will be 0.4.
-				Alpha = CurrentCrossfadeValue - (float)IndexA;
+				FMSUtilsQuality::SplitPosition(CurrentCrossfadeValue, NumInputs, IndexA, IndexB, Alpha);
 			}
 
 			// Need to call this each block in case inputs have changed
 			//Input values is an array of input types such as a float of a FAudioBufferReadRef
-			Crossfader.GetCrossfadeOutput(IndexA, IndexB, Alpha, InputValues, *OutputValue);
+			Crossfader.GetCrossfadeOutput(IndexA, IndexB, Alpha, InputValues, TrimValues, *MasterGain, *LoudnessCompensation, *OutputValue);
 		}
 
 		void Reset(const IOperator::FResetParams& InParams)
@@ -286,12 +465,41 @@ namespace Metasound
 
 		void Execute()
 		{
+			SCOPE_CYCLE_COUNTER(STAT_MSUtils_EPCrossfadeExecute);
+			MSUTILS_EXECUTE_SCOPE(TEXT("EP Crossfade"));
+
+			if (Capture)
+			{
+				float Controls[NumControls];
+				Controls[0] = *CrossfadeValue;
+				Controls[1] = *MasterGain;
+				for (uint32 i = 0; i < NumInputs; ++i)
+				{
+					Controls[2 + i] = *TrimValues[i];
+				}
+				Controls[2 + NumInputs] = *LoudnessCompensation ? 1.f : 0.f;
+				Capture->WriteBlock(Controls, InputValues);
+			}
+
 			PerformCrossfadeOutput();
+
+			if (LatencyProbe)
+			{
+				LatencyProbe->OnBlock(*CrossfadeValue, Crossfader.GetGains());
+			}
+		}
+
+		const FAudioBuffer& GetAudioOutput() const
+		{
+			return *OutputValue;
 		}
 
 	private:
 		FFloatReadRef CrossfadeValue;
-		TArray<TDataReadReference<FAudioBuffer>> InputValues;
+		FFloatReadRef MasterGain;
+		FBoolReadRef LoudnessCompensation;
+		FInputArray InputValues;
+		FTrimArray TrimValues;
 		TDataWriteReference<FAudioBuffer> OutputValue;
 
 		float PrevCrossfadeValue = -1.0f;
@@ -299,6 +507,8 @@ namespace Metasound
 		int32 IndexB = 0;
 		float Alpha = 0.0f;
 		TEPXFHelper Crossfader;
+		FOperatorCapturePtr Capture;
+		FLatencyProbePtr LatencyProbe;
 	};
 
 	template<uint32 NumInputs>
@@ -323,6 +533,20 @@ namespace Metasound
 	REGISTER_EPCROSSFADE_NODE(7);
 	REGISTER_EPCROSSFADE_NODE(8);
 
+	TUniquePtr<INode> CreateEPCrossfadeNode(int32 NumInputs, const FNodeInitData& InInitData)
+	{
+		switch (NumInputs)
+		{
+		case 2: return MakeUnique<TEPCrossfadeNode<2>>(InInitData);
+		case 3: return MakeUnique<TEPCrossfadeNode<3>>(InInitData);
+		case 4: return MakeUnique<TEPCrossfadeNode<4>>(InInitData);
+		case 5: return MakeUnique<TEPCrossfadeNode<5>>(InInitData);
+		case 6: return MakeUnique<TEPCrossfadeNode<6>>(InInitData);
+		case 7: return MakeUnique<TEPCrossfadeNode<7>>(InInitData);
+		case 8: return MakeUnique<TEPCrossfadeNode<8>>(InInitData);
+		default: return nullptr;
+		}
+	}
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,284 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "MS_Utils.h"
+#include "MSUtilsKernels.h"
+#include "MSUtilsQuality.h"
+#include "MSUtilsVertexNames.h"
+#include "RenderThreadGuard.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundAudioBuffer.h"
+#include "CoreMinimal.h"
+#include "Internationalization/Text.h"
+#include "MetasoundExecutableOperator.h"
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundStandardNodesCategories.h"
+#include "MetasoundStandardNodesNames.h"
+#include "MetasoundVertex.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_EPPanner"
+
+DECLARE_CYCLE_STAT(TEXT("EP Panner Execute"), STAT_MSUtils_EPPannerExecute, STATGROUP_MSUtils);
+
+#define REGISTER_EPPANNER_NODE(Number) \
+	using FEPPannerNode##Number = TEPPannerNode<Number>; \
+	METASOUND_REGISTER_NODE(FEPPannerNode##Number) \
+
+
+namespace Metasound
+{
+	namespace EPPannerVertexNames
+	{
+		METASOUND_PARAM(InputAudio, "In", "Audio to pan.")
+		METASOUND_PARAM(InputPosition, "Position", "Pan position from 0 (first output) to the number of outputs - 1. Fractional values sit between two outputs.")
+
+		constexpr int32 MaxNumOutputs = 8;
+
+		const FVertexName& GetOutputName(int32 InIndex)
+		{
+			static const TArray<FVertexName> OutputNames = MSUtilsVertexNames::MakeNames(TEXT("Out {0}"), MaxNumOutputs);
+
+			check(InIndex < MaxNumOutputs);
+			return OutputNames[InIndex];
+		}
+
+		const FDataVertexMetadata& GetOutputMetadata(int32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> OutputMetadata = MSUtilsVertexNames::MakeMetadata(MaxNumOutputs, [](int32 i) -> FDataVertexMetadata
+				{
+					return { METASOUND_LOCTEXT_FORMAT("EPPannerOutputDesc", "Panned output {0}.", i), METASOUND_LOCTEXT_FORMAT("EPPannerOutputDisplayName", "Out {0}", i) };
+				});
+
+			check(InIndex < MaxNumOutputs);
+			return OutputMetadata[InIndex];
+		}
+	}
+
+	// The crossfade run backwards: one input spread over NumOutputs with the same equal power law as EP Crossfade.
+	// At most two outputs carry signal at once.
+	template<int32 NumOutputs>
+	class TEPPannerOperator : public TExecutableOperator<TEPPannerOperator<NumOutputs>>
+	{
+		static_assert(NumOutputs <= EPPannerVertexNames::MaxNumOutputs, "EPPannerVertexNames::MaxNumOutputs must cover every registered output count");
+
+	public:
+		using FOutputArray = TArray<FAudioBufferWriteRef, TInlineAllocator<NumOutputs>>;
+
+		static const FVertexInterface& GetVertexInterface()
+		{
+			using namespace EPPannerVertexNames;
+
+			auto CreateDefaultInterface = []() -> FVertexInterface
+				{
+					FInputVertexInterface InputInterface;
+					InputInterface.Add(TInputDataVertex<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputAudio)));
+					InputInterface.Add(TInputDataVertex<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputPosition), 0.0f));
+
+					FOutputVertexInterface OutputInterface;
+					for (int32 i = 0; i < NumOutputs; ++i)
+					{
+						OutputInterface.Add(TOutputDataVertex<FAudioBuffer>(GetOutputName(i), GetOutputMetadata(i)));
+					}
+
+					return FVertexInterface(InputInterface, OutputInterface);
+				};
+
+			static const FVertexInterface DefaultInterface = CreateDefaultInterface();
+			return DefaultInterface;
+		}
+
+		static const FNodeClassMetadata& GetNodeInfo()
+		{
+			auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+				{
+					FName DataTypeName = GetMetasoundDataTypeName<FAudioBuffer>();
+					FName OperatorName = *FString::Printf(TEXT("EP Panner (%d)"), NumOutputs);
+					FText NodeDisplayName = METASOUND_LOCTEXT_FORMAT("EPPannerDisplayNamePattern", "EP Panner ({0})", NumOutputs);
+					const FText NodeDescription = METASOUND_LOCTEXT("EPPannerDescription", "Pans one input across the outputs by equal power.");
+					FVertexInterface NodeInterface = GetVertexInterface();
+
+					FNodeClassMetadata Metadata
+					{
+						FNodeClassName { "EPPanner", OperatorName, DataTypeName },
+						1, // Major Version
+						0, // Minor Version
+						NodeDisplayName,
+						NodeDescription,
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Spatialization },
+						{ },
+						FNodeDisplayStyle()
+					};
+					return Metadata;
+				};
+
+			static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+			return Metadata;
+		}
+
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, TArray<TUniquePtr<IOperatorBuildError>>& OutErrors)
+		{
+			using namespace EPPannerVertexNames;
+
+			const FInputVertexInterface& InputInterface = InParams.Node.GetVertexInterface().GetInputInterface();
+			const FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+
+			FAudioBufferReadRef Audio = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InputAudio), InParams.OperatorSettings);
+			FFloatReadRef Position = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InputPosition), InParams.OperatorSettings);
+
+			return MakeUnique<TEPPannerOperator<NumOutputs>>(InParams.OperatorSettings, Audio, Position);
+		}
+
+		TEPPannerOperator(const FOperatorSettings& InSettings, const FAudioBufferReadRef& InAudio, const FFloatReadRef& InPosition)
+			: AudioInput(InAudio)
+			, Position(InPosition)
+			, Quality(FMSUtilsQuality::Get())
+		{
+			for (int32 i = 0; i < NumOutputs; ++i)
+			{
+				// New buffers start zeroed, so every output starts out silent and cleared
+				Outputs.Add(FAudioBufferWriteRef::CreateNew(InSettings));
+				bOutputCleared[i] = true;
+			}
+		}
+
+		virtual ~TEPPannerOperator() = default;
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace EPPannerVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputAudio), AudioInput);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputPosition), Position);
+		}
+
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace EPPannerVertexNames;
+			for (int32 i = 0; i < NumOutputs; ++i)
+			{
+				InOutVertexData.BindReadVertex(GetOutputName(i), Outputs[i]);
+			}
+		}
+
+		virtual FDataReferenceCollection GetInputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		virtual FDataReferenceCollection GetOutputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		void Reset(const IOperator::FResetParams& InParams)
+		{
+			PrevPosition = -1.f;
+			FMemory::Memzero(Gains, sizeof(Gains));
+			FMemory::Memzero(PrevGains, sizeof(PrevGains));
+			for (int32 i = 0; i < NumOutputs; ++i)
+			{
+				Outputs[i]->Zero();
+				bOutputCleared[i] = true;
+			}
+		}
+
+		void Execute()
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MSUtils_EPPannerExecute);
+			MSUTILS_EXECUTE_SCOPE(TEXT("EP Panner"));
+
+			UpdateGains();
+
+			TArrayView<const float> InView(AudioInput->GetData(), AudioInput->Num());
+			for (int32 i = 0; i < NumOutputs; ++i)
+			{
+				FAudioBuffer& Output = *Outputs[i];
+				if (Gains[i] != 0.f || PrevGains[i] != 0.f)
+				{
+					MSUtilsKernels::FadeCopy(InView, TArrayView<float>(Output.GetData(), Output.Num()), Quality.GetRampStartGain(PrevGains[i], Gains[i]), Gains[i]);
+					bOutputCleared[i] = false;
+				}
+				else if (!bOutputCleared[i])
+				{
+					// Silent outputs are cleared once and then left alone while they stay silent
+					Output.Zero();
+					bOutputCleared[i] = true;
+				}
+
+				PrevGains[i] = Gains[i];
+			}
+		}
+
+	private:
+		// Same index and alpha split as EP Crossfade, only recomputed when the position moves
+		void UpdateGains()
+		{
+			const float CurrentPosition = FMath::Clamp(*Position, 0.0f, (float)(NumOutputs - 1));
+			if (FMath::IsNearlyEqual(CurrentPosition, PrevPosition))
+			{
+				return;
+			}
+			PrevPosition = CurrentPosition;
+
+			int32 IndexA = 0;
+			int32 IndexB = 0;
+			float Alpha = 0.f;
+			FMSUtilsQuality::SplitPosition(CurrentPosition, NumOutputs, IndexA, IndexB, Alpha);
+
+			float GainA = 0.f;
+			float GainB = 0.f;
+			Quality.GetPairGains(Alpha, GainA, GainB);
+
+			FMemory::Memzero(Gains, sizeof(Gains));
+			Gains[IndexA] = GainA;
+			if (IndexB != IndexA)
+			{
+				Gains[IndexB] = GainB;
+			}
+		}
+
+		FAudioBufferReadRef AudioInput;
+		FFloatReadRef Position;
+		FOutputArray Outputs;
+
+		FMSUtilsQuality Quality;
+		float PrevPosition = -1.f;
+		float Gains[NumOutputs] = { };
+		float PrevGains[NumOutputs] = { };
+		bool bOutputCleared[NumOutputs] = { };
+	};
+
+	template<int32 NumOutputs>
+	class TEPPannerNode : public FNodeFacade
+	{
+	public:
+		/**
+		 * Constructor used by the Metasound Frontend.
+		 */
+		TEPPannerNode(const FNodeInitData& InInitData)
+			: FNodeFacade(InInitData.InstanceName, InInitData.InstanceID, TFacadeOperatorClass<TEPPannerOperator<NumOutputs>>())
+		{}
+
+		virtual ~TEPPannerNode() = default;
+	};
+
+	REGISTER_EPPANNER_NODE(2);
+	REGISTER_EPPANNER_NODE(3);
+	REGISTER_EPPANNER_NODE(4);
+	REGISTER_EPPANNER_NODE(5);
+	REGISTER_EPPANNER_NODE(6);
+	REGISTER_EPPANNER_NODE(7);
+	REGISTER_EPPANNER_NODE(8);
+
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,323 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "MS_Utils.h"
+#include "MSUtilsKernels.h"
+#include "MSUtilsQuality.h"
+#include "MSUtilsVertexNames.h"
+#include "RenderThreadGuard.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundAudioBuffer.h"
+#include "CoreMinimal.h"
+#include "Internationalization/Text.h"
+#include "MetasoundExecutableOperator.h"
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundStandardNodesCategories.h"
+#include "MetasoundStandardNodesNames.h"
+#include "MetasoundTime.h"
+#include "MetasoundVertex.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_EqualPowerSwitch"
+
+DECLARE_CYCLE_STAT(TEXT("EP Switch Execute"), STAT_MSUtils_EqualPowerSwitchExecute, STATGROUP_MSUtils);
+
+#define REGISTER_EPSWITCH_NODE(Number) \
+	using FEPSwitchNode##Number = TEPSwitchNode<Number>; \
+	METASOUND_REGISTER_NODE(FEPSwitchNode##Number) \
+
+
+namespace Metasound
+{
+	namespace EPSwitchVertexNames
+	{
+		METASOUND_PARAM(InputIndex, "Index", "Index of the input to pass through.")
+		METASOUND_PARAM(InputDeclickTime, "Declick Time", "Length of the equal power declick when the index changes.")
+		METASOUND_PARAM(OutputAudio, "Out", "Output audio.")
+
+		constexpr int32 MaxNumInputs = 8;
+
+		const FVertexName& GetInputName(int32 InIndex)
+		{
+			static const TArray<FVertexName> InputNames = MSUtilsVertexNames::MakeNames(TEXT("In {0}"), MaxNumInputs);
+
+			check(InIndex < MaxNumInputs);
+			return InputNames[InIndex];
+		}
+
+		const FDataVertexMetadata& GetInputMetadata(int32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> InputMetadata = MSUtilsVertexNames::MakeMetadata(MaxNumInputs, [](int32 i) -> FDataVertexMetadata
+				{
+					return { METASOUND_LOCTEXT_FORMAT("EPSwitchInputDesc", "Switch {0} input.", i), METASOUND_LOCTEXT_FORMAT("EPSwitchInputDisplayName", "In {0}", i) };
+				});
+
+			check(InIndex < MaxNumInputs);
+			return InputMetadata[InIndex];
+		}
+	}
+
+	// Passes one input through unchanged. When the index changes, the old and new inputs are crossfaded by equal power
+	// over Declick Time, per sample, and then it goes back to a straight copy. An index change during a declick is
+	// picked up once the declick finishes.
+	template<int32 NumInputs>
+	class TEPSwitchOperator : public TExecutableOperator<TEPSwitchOperator<NumInputs>>
+	{
+		static_assert(NumInputs <= EPSwitchVertexNames::MaxNumInputs, "EPSwitchVertexNames::MaxNumInputs must cover every registered input count");
+
+	public:
+		using FInputArray = TArray<FAudioBufferReadRef, TInlineAllocator<NumInputs>>;
+
+		static const FVertexInterface& GetVertexInterface()
+		{
+			using namespace EPSwitchVertexNames;
+
+			auto CreateDefaultInterface = []() -> FVertexInterface
+				{
+					FInputVertexInterface InputInterface;
+
+					InputInterface.Add(TInputDataVertex<int32>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputIndex), 0));
+					InputInterface.Add(TInputDataVertex<FTime>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputDeclickTime), 0.005f));
+
+					for (int32 i = 0; i < NumInputs; ++i)
+					{
+						InputInterface.Add(TInputDataVertex<FAudioBuffer>(GetInputName(i), GetInputMetadata(i)));
+					}
+
+					FOutputVertexInterface OutputInterface;
+					OutputInterface.Add(TOutputDataVertex<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutputAudio)));
+
+					return FVertexInterface(InputInterface, OutputInterface);
+				};
+
+			static const FVertexInterface DefaultInterface = CreateDefaultInterface();
+			return DefaultInterface;
+		}
+
+		static const FNodeClassMetadata& GetNodeInfo()
+		{
+			auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+				{
+					FName DataTypeName = GetMetasoundDataTypeName<FAudioBuffer>();
+					FName OperatorName = *FString::Printf(TEXT("EP Switch (%d)"), NumInputs);
+					FText NodeDisplayName = METASOUND_LOCTEXT_FORMAT("EPSwitchDisplayNamePattern", "EP Switch ({0})", NumInputs);
+					const FText NodeDescription = METASOUND_LOCTEXT("EPSwitchDescription", "Passes the selected input through, with a short equal power declick when the index changes.");
+					FVertexInterface NodeInterface = GetVertexInterface();
+
+					FNodeClassMetadata Metadata
+					{
+						FNodeClassName { "EPSwitch", OperatorName, DataTypeName },
+						1, // Major Version
+						0, // Minor Version
+						NodeDisplayName,
+						NodeDescription,
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Envelopes },
+						{ },
+						FNodeDisplayStyle()
+					};
+					return Metadata;
+				};
+
+			static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+			return Metadata;
+		}
+
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, TArray<TUniquePtr<IOperatorBuildError>>& OutErrors)
+		{
+			using namespace EPSwitchVertexNames;
+
+			const FInputVertexInterface& InputInterface = InParams.Node.GetVertexInterface().GetInputInterface();
+			const FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+
+			FInt32ReadRef Index = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<int32>(InputInterface, METASOUND_GET_PARAM_NAME(InputIndex), InParams.OperatorSettings);
+			FTimeReadRef DeclickTime = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FTime>(InputInterface, METASOUND_GET_PARAM_NAME(InputDeclickTime), InParams.OperatorSettings);
+
+			FInputArray InputValues;
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InputValues.Add(InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, GetInputName(i), InParams.OperatorSettings));
+			}
+
+			return MakeUnique<TEPSwitchOperator<NumInputs>>(InParams.OperatorSettings, Index, DeclickTime, MoveTemp(InputValues));
+		}
+
+		TEPSwitchOperator(const FOperatorSettings& InSettings, const FInt32ReadRef& InIndex, const FTimeReadRef& InDeclickTime, FInputArray&& InInputValues)
+			: Index(InIndex)
+			, DeclickTime(InDeclickTime)
+			, InputValues(MoveTemp(InInputValues))
+			, OutputValue(TDataWriteReferenceFactory<FAudioBuffer>::CreateAny(InSettings))
+			, SampleRate(InSettings.GetSampleRate())
+			, Quality(FMSUtilsQuality::Get())
+		{
+			CurrentIndex = FMath::Clamp(*Index, 0, NumInputs - 1);
+		}
+
+		virtual ~TEPSwitchOperator() = default;
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace EPSwitchVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputIndex), Index);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputDeclickTime), DeclickTime);
+
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InOutVertexData.BindReadVertex(GetInputName(i), InputValues[i]);
+			}
+		}
+
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace EPSwitchVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutputAudio), OutputValue);
+		}
+
+		virtual FDataReferenceCollection GetInputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		virtual FDataReferenceCollection GetOutputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		void Reset(const IOperator::FResetParams& InParams)
+		{
+			CurrentIndex = FMath::Clamp(*Index, 0, NumInputs - 1);
+			FromIndex = INDEX_NONE;
+			DeclickFrame = 0;
+			DeclickLength = 0;
+			OutputValue->Zero();
+		}
+
+		void Execute()
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MSUtils_EqualPowerSwitchExecute);
+			MSUTILS_EXECUTE_SCOPE(TEXT("EP Switch"));
+
+			const int32 RequestedIndex = FMath::Clamp(*Index, 0, NumInputs - 1);
+			float* OutData = OutputValue->GetData();
+			const int32 NumFrames = OutputValue->Num();
+
+			int32 Frame = 0;
+			while (Frame < NumFrames)
+			{
+				if (!IsDeclicking())
+				{
+					if (RequestedIndex == CurrentIndex)
+					{
+						// Steady state: a straight copy of the selected input
+						FMemory::Memcpy(OutData + Frame, InputValues[CurrentIndex]->GetData() + Frame, sizeof(float) * (NumFrames - Frame));
+						break;
+					}
+
+					BeginDeclick(RequestedIndex);
+					continue;
+				}
+
+				Frame += RenderDeclick(Frame, NumFrames);
+			}
+		}
+
+	private:
+		// Frames between equal-power gain evaluations during a declick. Short enough that the linear ramps between
+		// them stay within a fraction of a dB of the curve.
+		static constexpr int32 DeclickSegmentFrames = 64;
+
+		bool IsDeclicking() const
+		{
+			return FromIndex != INDEX_NONE;
+		}
+
+		void BeginDeclick(int32 NewIndex)
+		{
+			DeclickLength = FMath::RoundToInt(FMath::Max(0.f, (float)DeclickTime->GetSeconds()) * SampleRate);
+			if (DeclickLength > 1)
+			{
+				FromIndex = CurrentIndex;
+				DeclickFrame = 0;
+			}
+			// A declick shorter than two samples is a plain cut
+			CurrentIndex = NewIndex;
+		}
+
+		// Renders the declick from StartFrame until it ends or the block does. Returns the number of frames written.
+		int32 RenderDeclick(int32 StartFrame, int32 EndFrame)
+		{
+			const int32 NumFrames = FMath::Min(EndFrame - StartFrame, DeclickLength - DeclickFrame);
+
+			// Gains are worked out at the segment edges and ramped between them, rather than per sample. The ramps
+			// reach the new input's full gain on the first frame after the declick.
+			const float AlphaPerFrame = 1.f / (float)DeclickLength;
+			for (int32 SegmentStart = 0; SegmentStart < NumFrames; SegmentStart += DeclickSegmentFrames)
+			{
+				const int32 SegmentFrames = FMath::Min(DeclickSegmentFrames, NumFrames - SegmentStart);
+				const float StartAlpha = (float)(DeclickFrame + SegmentStart) * AlphaPerFrame;
+				const float EndAlpha = FMath::Min((float)(DeclickFrame + SegmentStart + SegmentFrames) * AlphaPerFrame, 1.f);
+
+				const int32 Offset = StartFrame + SegmentStart;
+				const TArrayView<const float> FromView(InputValues[FromIndex]->GetData() + Offset, SegmentFrames);
+				const TArrayView<const float> ToView(InputValues[CurrentIndex]->GetData() + Offset, SegmentFrames);
+				const TArrayView<float> OutView(OutputValue->GetData() + Offset, SegmentFrames);
+
+				MSUtilsKernels::FadeCopy(FromView, OutView, Quality.EqualPowerGain(StartAlpha), Quality.EqualPowerGain(EndAlpha));
+				MSUtilsKernels::MixIn(ToView, OutView, Quality.EqualPowerGain(1.f - StartAlpha), Quality.EqualPowerGain(1.f - EndAlpha));
+			}
+
+			DeclickFrame += NumFrames;
+			if (DeclickFrame >= DeclickLength)
+			{
+				FromIndex = INDEX_NONE;
+			}
+			return NumFrames;
+		}
+
+		FInt32ReadRef Index;
+		FTimeReadRef DeclickTime;
+		FInputArray InputValues;
+		TDataWriteReference<FAudioBuffer> OutputValue;
+
+		float SampleRate = 0.f;
+		FMSUtilsQuality Quality;
+
+		int32 CurrentIndex = 0;
+		int32 FromIndex = INDEX_NONE;
+		int32 DeclickFrame = 0;
+		int32 DeclickLength = 0;
+	};
+
+	template<int32 NumInputs>
+	class TEPSwitchNode : public FNodeFacade
+	{
+	public:
+		/**
+		 * Constructor used by the Metasound Frontend.
+		 */
+		TEPSwitchNode(const FNodeInitData& InInitData)
+			: FNodeFacade(InInitData.InstanceName, InInitData.InstanceID, TFacadeOperatorClass<TEPSwitchOperator<NumInputs>>())
+		{}
+
+		virtual ~TEPSwitchNode() = default;
+	};
+
+	REGISTER_EPSWITCH_NODE(2);
+	REGISTER_EPSWITCH_NODE(3);
+	REGISTER_EPSWITCH_NODE(4);
+	REGISTER_EPSWITCH_NODE(5);
+	REGISTER_EPSWITCH_NODE(6);
+	REGISTER_EPSWITCH_NODE(7);
+	REGISTER_EPSWITCH_NODE(8);
+
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,646 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "FloatExpression.h"
+#include "MS_Utils.h"
+#include "RenderThreadGuard.h"
+
+#include "MetasoundBuildError.h"
+#include "MetasoundLog.h"
+#include "MetasoundStandardNodesCategories.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_FloatExpression"
+
+DECLARE_CYCLE_STAT(TEXT("Float Expression Execute"), STAT_MSUtils_FloatExpressionExecute, STATGROUP_MSUtils);
+
+namespace Metasound
+{
+	//the below stores name and tooltip information for each input/output pin - Name and then description.
+
+	namespace FloatExprNodeNames
+	{
+		METASOUND_PARAM(InFormula, "Formula", "Expression using inputs a to h, e.g. clamp((a - b) / c, 0, 1). Read when the node is created.");
+		METASOUND_PARAM(OutFloatValue, "Out", "Result of the expression");
+
+		const FVertexName& GetInputName(int32 InIndex)
+		{
+			static const TArray<FVertexName> InputNames = []()
+				{
+					TArray<FVertexName> Names;
+					Names.Reserve(FloatExpression::NumInputs);
+					for (int32 i = 0; i < FloatExpression::NumInputs; ++i)
+					{
+						Names.Add(*FString::Chr(TEXT('A') + i));
+					}
+					return Names;
+				}();
+
+			check(InIndex >= 0 && InIndex < FloatExpression::NumInputs);
+			return InputNames[InIndex];
+		}
+
+		const FDataVertexMetadata& GetInputMetadata(int32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> InputMetadata = []()
+				{
+					TArray<FDataVertexMetadata> Metadata;
+					Metadata.Reserve(FloatExpression::NumInputs);
+					for (int32 i = 0; i < FloatExpression::NumInputs; ++i)
+					{
+						const FText Letter = FText::FromString(FString::Chr(TEXT('a') + i));
+						Metadata.Add({ METASOUND_LOCTEXT_FORMAT("FloatExprInputDesc", "Value of {0} in the formula.", Letter), FText::FromName(GetInputName(i)) });
+					}
+					return Metadata;
+				}();
+
+			check(InIndex >= 0 && InIndex < FloatExpression::NumInputs);
+			return InputMetadata[InIndex];
+		}
+	}
+
+	namespace FloatExpression
+	{
+		namespace Private
+		{
+			// Recursive descent parser emitting postfix instructions.
+			//   Expr    := Term (('+' | '-') Term)*
+			//   Term    := Unary (('*' | '/') Unary)*
+			//   Unary   := '-' Unary | Power
+			//   Power   := Primary ('^' Unary)?
+			//   Primary := Number | 'pi' | Input | Function '(' Args ')' | '(' Expr ')'
+			//   Number  := Digits ('.' Digits)? | '.' Digits
+			class FParser
+			{
+			public:
+				// Limits the parser's own recursion. Chains like "----1" or "((((1))))" recurse once per character while
+				// only ever pushing one value, so MaxStackDepth alone doesn't bound them.
+				static constexpr int32 MaxNesting = 64;
+
+				FParser(const FString& InFormula, TArray<FInstruction>& InInstructions)
+					: Formula(InFormula)
+					, Instructions(InInstructions)
+				{
+				}
+
+				bool Parse(FString& OutError)
+				{
+					// Checked first, as parsing a blank formula would report an unexpected end instead
+					SkipWhitespace();
+					if (Pos >= Formula.Len())
+					{
+						SetError(TEXT("Formula is empty"));
+					}
+					else
+					{
+						ParseExpr();
+						SkipWhitespace();
+						if (Error.IsEmpty() && Pos < Formula.Len())
+						{
+							SetError(FString::Printf(TEXT("Unexpected '%c' at %d"), Formula[Pos], Pos));
+						}
+					}
+
+					OutError = Error;
+					return Error.IsEmpty();
+				}
+
+			private:
+				void SetError(const FString& InError)
+				{
+					if (Error.IsEmpty())
+					{
+						Error = InError;
+					}
+				}
+
+				void SkipWhitespace()
+				{
+					while (Pos < Formula.Len() && FChar::IsWhitespace(Formula[Pos]))
+					{
+						++Pos;
+					}
+				}
+
+				bool Match(TCHAR InChar)
+				{
+					SkipWhitespace();
+					if (Pos < Formula.Len() && Formula[Pos] == InChar)
+					{
+						++Pos;
+						return true;
+					}
+					return false;
+				}
+
+				void Emit(EOp InOp, int32 InIndex = 0, float InValue = 0.f)
+				{
+					// Track the stack depth the program will need so Evaluate can use a fixed stack
+					switch (InOp)
+					{
+					case EOp::PushConst:
+					case EOp::PushInput:
+						++Depth;
+						break;
+					case EOp::Add:
+					case EOp::Sub:
+					case EOp::Mul:
+					case EOp::Div:
+					case EOp::Pow:
+					case EOp::Min:
+					case EOp::Max:
+						--Depth;
+						break;
+					case EOp::Clamp:
+						Depth -= 2;
+						break;
+					default:
+						break;
+					}
+
+					if (Depth > MaxStackDepth)
+					{
+						SetError(TEXT("Formula is nested too deeply"));
+					}
+
+					Instructions.Add({ InOp, InIndex, InValue });
+				}
+
+				void ParseExpr()
+				{
+					ParseTerm();
+					while (Error.IsEmpty())
+					{
+						if (Match(TEXT('+')))
+						{
+							ParseTerm();
+							Emit(EOp::Add);
+						}
+						else if (Match(TEXT('-')))
+						{
+							ParseTerm();
+							Emit(EOp::Sub);
+						}
+						else
+						{
+							break;
+						}
+					}
+				}
+
+				void ParseTerm()
+				{
+					ParseUnary();
+					while (Error.IsEmpty())
+					{
+						if (Match(TEXT('*')))
+						{
+							ParseUnary();
+							Emit(EOp::Mul);
+						}
+						else if (Match(TEXT('/')))
+						{
+							ParseUnary();
+							Emit(EOp::Div);
+						}
+						else
+						{
+							break;
+						}
+					}
+				}
+
+				void ParseUnary()
+				{
+					TGuardValue<int32> NestingGuard(Nesting, Nesting + 1);
+					if (Nesting > MaxNesting)
+					{
+						SetError(TEXT("Formula is nested too deeply"));
+						return;
+					}
+
+					if (Match(TEXT('-')))
+					{
+						ParseUnary();
+						Emit(EOp::Neg);
+					}
+					else
+					{
+						ParsePower();
+					}
+				}
+
+				void ParsePower()
+				{
+					ParsePrimary();
+					if (Error.IsEmpty() && Match(TEXT('^')))
+					{
+						ParseUnary();
+						Emit(EOp::Pow);
+					}
+				}
+
+				void ParsePrimary()
+				{
+					TGuardValue<int32> NestingGuard(Nesting, Nesting + 1);
+					if (Nesting > MaxNesting)
+					{
+						SetError(TEXT("Formula is nested too deeply"));
+						return;
+					}
+
+					SkipWhitespace();
+					if (Pos >= Formula.Len())
+					{
+						SetError(TEXT("Unexpected end of formula"));
+						return;
+					}
+
+					const TCHAR Char = Formula[Pos];
+					if (FChar::IsDigit(Char) || Char == TEXT('.'))
+					{
+						ParseNumber();
+					}
+					else if (FChar::IsAlpha(Char))
+					{
+						const int32 Start = Pos;
+						while (Pos < Formula.Len() && FChar::IsAlnum(Formula[Pos]))
+						{
+							++Pos;
+						}
+						ParseIdentifier(Formula.Mid(Start, Pos - Start).ToLower());
+					}
+					else if (Match(TEXT('(')))
+					{
+						ParseExpr();
+						if (Error.IsEmpty() && !Match(TEXT(')')))
+						{
+							SetError(FString::Printf(TEXT("Expected ')' at %d"), Pos));
+						}
+					}
+					else
+					{
+						SetError(FString::Printf(TEXT("Unexpected '%c' at %d"), Char, Pos));
+					}
+				}
+
+				// Reads the literal itself rather than handing it to Atof, which would quietly take the "1.2" of "1.2.3"
+				void ParseNumber()
+				{
+					const int32 Start = Pos;
+					double Value = 0.0;
+					while (Pos < Formula.Len() && FChar::IsDigit(Formula[Pos]))
+					{
+						Value = Value * 10.0 + (Formula[Pos++] - TEXT('0'));
+					}
+
+					if (Pos < Formula.Len() && Formula[Pos] == TEXT('.'))
+					{
+						++Pos;
+						double Scale = 0.1;
+						int32 NumFractionDigits = 0;
+						while (Pos < Formula.Len() && FChar::IsDigit(Formula[Pos]))
+						{
+							Value += (Formula[Pos++] - TEXT('0')) * Scale;
+							Scale *= 0.1;
+							++NumFractionDigits;
+						}
+
+						if (NumFractionDigits == 0)
+						{
+							SetError(FString::Printf(TEXT("Expected a digit after '.' at %d"), Pos));
+							return;
+						}
+					}
+
+					// A second '.' or a letter straight after the literal, as in "1.2.3" or "2pi"
+					if (Pos < Formula.Len() && (Formula[Pos] == TEXT('.') || FChar::IsAlpha(Formula[Pos])))
+					{
+						while (Pos < Formula.Len() && (FChar::IsAlnum(Formula[Pos]) || Formula[Pos] == TEXT('.')))
+						{
+							++Pos;
+						}
+						SetError(FString::Printf(TEXT("Malformed number '%s' at %d"), *Formula.Mid(Start, Pos - Start), Start));
+						return;
+					}
+
+					if (!FMath::IsFinite((float)Value))
+					{
+						SetError(FString::Printf(TEXT("Number at %d is out of range"), Start));
+						return;
+					}
+
+					Emit(EOp::PushConst, 0, (float)Value);
+				}
+
+				void ParseIdentifier(const FString& InName)
+				{
+					if (InName.Len() == 1 && InName[0] >= TEXT('a') && InName[0] < TEXT('a') + NumInputs)
+					{
+						Emit(EOp::PushInput, InName[0] - TEXT('a'));
+						return;
+					}
+
+					if (InName == TEXT("pi"))
+					{
+						Emit(EOp::PushConst, 0, PI);
+						return;
+					}
+
+					struct FFunction
+					{
+						const TCHAR* Name;
+						EOp Op;
+						int32 NumArgs;
+					};
+
+					static const FFunction Functions[] =
+					{
+						{ TEXT("min"), EOp::Min, 2 },
+						{ TEXT("max"), EOp::Max, 2 },
+						{ TEXT("pow"), EOp::Pow, 2 },
+						{ TEXT("clamp"), EOp::Clamp, 3 },
+						{ TEXT("sin"), EOp::Sin, 1 },
+						{ TEXT("cos"), EOp::Cos, 1 },
+						{ TEXT("sqrt"), EOp::Sqrt, 1 },
+						{ TEXT("abs"), EOp::Abs, 1 }
+					};
+
+					for (const FFunction& Function : Functions)
+					{
+						if (InName == Function.Name)
+						{
+							if (!Match(TEXT('(')))
+							{
+								SetError(FString::Printf(TEXT("Expected '(' after %s"), Function.Name));
+								return;
+							}
+
+							for (int32 Arg = 0; Arg < Function.NumArgs && Error.IsEmpty(); ++Arg)
+							{
+								if (Arg > 0 && !Match(TEXT(',')))
+								{
+									SetError(FString::Printf(TEXT("%s takes %d arguments"), Function.Name, Function.NumArgs));
+									return;
+								}
+								ParseExpr();
+							}
+
+							if (Error.IsEmpty() && !Match(TEXT(')')))
+							{
+								SetError(FString::Printf(TEXT("Expected ')' after %s arguments"), Function.Name));
+								return;
+							}
+
+							Emit(Function.Op);
+							return;
+						}
+					}
+
+					SetError(FString::Printf(TEXT("Unknown name '%s'"), *InName));
+				}
+
+				const FString& Formula;
+				TArray<FInstruction>& Instructions;
+				FString Error;
+				int32 Pos = 0;
+				int32 Depth = 0;
+				int32 Nesting = 0;
+			};
+
+			// Reported on the node when its formula doesn't compile
+			class FCompileError : public FBuildErrorBase
+			{
+			public:
+				FCompileError(const INode& InNode, const FString& InError)
+					: FBuildErrorBase(TEXT("MSUtilsFloatExpressionCompileError"), FText::Format(LOCTEXT("FloatExprCompileError", "Formula failed to compile: {0}"), FText::FromString(InError)))
+				{
+					AddNode(InNode);
+				}
+			};
+		}
+
+		bool Compile(const FString& Formula, TArray<FInstruction>& OutInstructions, FString& OutError)
+		{
+			OutInstructions.Reset();
+			Private::FParser Parser(Formula, OutInstructions);
+			if (!Parser.Parse(OutError))
+			{
+				OutInstructions.Reset();
+				return false;
+			}
+
+			OutInstructions.Shrink();
+			return true;
+		}
+
+		float Evaluate(TArrayView<const FInstruction> Instructions, TArrayView<const float> Inputs)
+		{
+			float Stack[MaxStackDepth];
+			int32 Top = -1;
+
+			for (const FInstruction& Instruction : Instructions)
+			{
+				switch (Instruction.Op)
+				{
+				case EOp::PushConst:
+					Stack[++Top] = Instruction.Value;
+					break;
+				case EOp::PushInput:
+					Stack[++Top] = Inputs[Instruction.Index];
+					break;
+				case EOp::Add:
+					--Top;
+					Stack[Top] += Stack[Top + 1];
+					break;
+				case EOp::Sub:
+					--Top;
+					Stack[Top] -= Stack[Top + 1];
+					break;
+				case EOp::Mul:
+					--Top;
+					Stack[Top] *= Stack[Top + 1];
+					break;
+				case EOp::Div:
+					--Top;
+					// Dividing by zero gives zero rather than feeding inf/nan into downstream gains
+					Stack[Top] = Stack[Top + 1] != 0.f ? Stack[Top] / Stack[Top + 1] : 0.f;
+					break;
+				case EOp::Pow:
+				{
+					--Top;
+					// A negative base with a fractional exponent, or an overflow, gives zero like division by zero does
+					const float Result = FMath::Pow(Stack[Top], Stack[Top + 1]);
+					Stack[Top] = FMath::IsFinite(Result) ? Result : 0.f;
+					break;
+				}
+				case EOp::Neg:
+					Stack[Top] = -Stack[Top];
+					break;
+				case EOp::Min:
+					--Top;
+					Stack[Top] = FMath::Min(Stack[Top], Stack[Top + 1]);
+					break;
+				case EOp::Max:
+					--Top;
+					Stack[Top] = FMath::Max(Stack[Top], Stack[Top + 1]);
+					break;
+				case EOp::Clamp:
+					Top -= 2;
+					Stack[Top] = FMath::Clamp(Stack[Top], Stack[Top + 1], Stack[Top + 2]);
+					break;
+				case EOp::Sin:
+					Stack[Top] = FMath::Sin(Stack[Top]);
+					break;
+				case EOp::Cos:
+					Stack[Top] = FMath::Cos(Stack[Top]);
+					break;
+				case EOp::Sqrt:
+					Stack[Top] = FMath::Sqrt(FMath::Max(Stack[Top], 0.f));
+					break;
+				case EOp::Abs:
+					Stack[Top] = FMath::Abs(Stack[Top]);
+					break;
+				}
+			}
+
+			// Products and sums can still overflow to inf, or give nan from inf - inf
+			return Top == 0 && FMath::IsFinite(Stack[0]) ? Stack[0] : 0.f;
+		}
+	}
+
+	FFloatExprOperator::FFloatExprOperator(const FOperatorSettings& InSettings,
+		const FStringReadRef& FormulaIn,
+		FInputArray&& InputsIn,
+		TArray<FloatExpression::FInstruction>&& InstructionsIn)
+		: Formula(FormulaIn),
+		Inputs(MoveTemp(InputsIn)),
+		FloatOutput(FFloatWriteRef::CreateNew(0.f)),
+		Instructions(MoveTemp(InstructionsIn))
+	{
+		Execute();
+	};
+
+	void FFloatExprOperator::Execute()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_MSUtils_FloatExpressionExecute);
+		MSUTILS_EXECUTE_SCOPE(TEXT("Float Expression"));
+
+		bool bChanged = !bInit;
+		for (int32 i = 0; i < FloatExpression::NumInputs; ++i)
+		{
+			const float Value = *Inputs[i];
+			if (Value != PrevInputs[i])
+			{
+				PrevInputs[i] = Value;
+				bChanged = true;
+			}
+		}
+
+		if (bChanged)
+		{
+			bInit = true;
+			*FloatOutput = FloatExpression::Evaluate(Instructions, MakeArrayView(PrevInputs));
+		}
+	}
+
+	const FVertexInterface& FFloatExprOperator::DeclareVertexInterface()
+	{
+		using namespace FloatExprNodeNames;
+
+		auto CreateDefaultInterface = []() -> FVertexInterface
+			{
+				FInputVertexInterface InputInterface;
+				InputInterface.Add(TInputDataVertex<FString>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFormula), FString(TEXT("a"))));
+
+				for (int32 i = 0; i < FloatExpression::NumInputs; ++i)
+				{
+					InputInterface.Add(TInputDataVertex<float>(GetInputName(i), GetInputMetadata(i), 0.f));
+				}
+
+				FOutputVertexInterface OutputInterface;
+				OutputInterface.Add(TOutputDataVertex<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutFloatValue)));
+
+				return FVertexInterface(InputInterface, OutputInterface);
+			};
+
+		static const FVertexInterface Interface = CreateDefaultInterface();
+		return Interface;
+	};
+
+	const FNodeClassMetadata& FFloatExprOperator::GetNodeInfo()
+	{
+		auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+			{
+				FVertexInterface NodeInterface = DeclareVertexInterface();
+
+				FNodeClassMetadata Metadata
+				{
+						{ TEXT("UE"), TEXT("FloatExpression"), TEXT("Float") },
+						1, // Major Version
+						0, // Minor Version
+						METASOUND_LOCTEXT("FloatExprDisplayName", "Float Expression"),
+						METASOUND_LOCTEXT("FloatExprNodeDesc", "Evaluates a formula of up to eight float inputs, replacing chains of single math nodes"),
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Math },
+						{ },
+						FNodeDisplayStyle{}
+				};
+
+				return Metadata;
+			};
+
+		static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+		return Metadata;
+	};
+
+	void FFloatExprOperator::BindInputs(FInputVertexInterfaceData& InOutVertexData)
+	{
+		using namespace FloatExprNodeNames;
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFormula), Formula);
+
+		for (int32 i = 0; i < FloatExpression::NumInputs; ++i)
+		{
+			InOutVertexData.BindReadVertex(GetInputName(i), Inputs[i]);
+		}
+	}
+
+	void FFloatExprOperator::BindOutputs(FOutputVertexInterfaceData& InOutVertexData)
+	{
+		using namespace FloatExprNodeNames;
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutFloatValue), FloatOutput);
+	}
+
+	TUniquePtr<IOperator> FFloatExprOperator::CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors)
+	{
+		using namespace FloatExprNodeNames;
+
+		const Metasound::FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+		const Metasound::FInputVertexInterface& InputInterface = DeclareVertexInterface().GetInputInterface();
+
+		FStringReadRef FormulaIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FString>(InputInterface, METASOUND_GET_PARAM_NAME(InFormula), InParams.OperatorSettings);
+
+		FInputArray InputValues;
+		for (int32 i = 0; i < FloatExpression::NumInputs; ++i)
+		{
+			InputValues.Add(InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, GetInputName(i), InParams.OperatorSettings));
+		}
+
+		// Compile once here so Execute only runs the flat instruction array
+		TArray<FloatExpression::FInstruction> Instructions;
+		FString CompileError;
+		if (!FloatExpression::Compile(*FormulaIn, Instructions, CompileError))
+		{
+			UE_LOG(LogMetaSound, Warning, TEXT("Float Expression '%s' failed to compile: %s. Output will be 0."), **FormulaIn, *CompileError);
+			OutErrors.Add(MakeUnique<FloatExpression::Private::FCompileError>(InParams.Node, CompileError));
+		}
+
+		//this class is FFloatExprOperator, which inherits from TExecutableOperator, which inherits from IOperator. IOperator type is returned
+		return MakeUnique<FFloatExprOperator>(InParams.OperatorSettings, FormulaIn, MoveTemp(InputValues), MoveTemp(Instructions));
+	}
+
+	// Register node
+	METASOUND_REGISTER_NODE(FFloatExprNode);
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,354 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "LatencyProbe.h"
+#include "RenderThreadGuard.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+#include <atomic>
+
+DEFINE_LOG_CATEGORY_STATIC(LogMSUtilsLatencyProbe, Log, All);
+
+TRACE_DECLARE_FLOAT_COUNTER(MSUtilsLatencyProbeSendMs, TEXT("MSUtils/LatencyProbe/SendMs"));
+TRACE_DECLARE_FLOAT_COUNTER(MSUtilsLatencyProbeRampMs, TEXT("MSUtils/LatencyProbe/RampMs"));
+TRACE_DECLARE_FLOAT_COUNTER(MSUtilsLatencyProbeTotalMs, TEXT("MSUtils/LatencyProbe/TotalMs"));
+
+static int32 MSUtilsLatencyProbeEnabled = 0;
+static FAutoConsoleVariableRef CVarMSUtilsLatencyProbeEnabled(
+	TEXT("au.MSUtils.LatencyProbe.Enabled"),
+	MSUtilsLatencyProbeEnabled,
+	TEXT("Measure parameter-to-gain latency in crossfade nodes created from now on. 0: off (default), 1: on."),
+	ECVF_Default);
+
+static FString MSUtilsLatencyProbeId;
+static FAutoConsoleVariableRef CVarMSUtilsLatencyProbeId(
+	TEXT("au.MSUtils.LatencyProbe.ProbeId"),
+	MSUtilsLatencyProbeId,
+	TEXT("Probe id for nodes created from now on, matched against FLatencyProbe::NoteParameterSent. Empty (default): the name of the input each node watches."),
+	ECVF_Default);
+
+static FAutoConsoleCommand CmdMSUtilsLatencyProbeReport(
+	TEXT("au.MSUtils.LatencyProbe.Report"),
+	TEXT("Prints the latency histograms gathered by au.MSUtils.LatencyProbe.Enabled, per node type."),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			UE_LOG(LogMSUtilsLatencyProbe, Display, TEXT("%s"), *Metasound::FLatencyProbe::GetReport());
+		}));
+
+static FAutoConsoleCommand CmdMSUtilsLatencyProbeReset(
+	TEXT("au.MSUtils.LatencyProbe.Reset"),
+	TEXT("Clears the latency probe histograms."),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			Metasound::FLatencyProbe::ResetHistograms();
+		}));
+
+namespace Metasound
+{
+	// Shared by every probe of one node type and never freed, so probes can hold a reference. Bins are atomic so
+	// render threads can add to them without locking.
+	struct FLatencyHistogram
+	{
+		static constexpr float BinWidthMs = 0.5f;
+
+		// The last bin also counts everything above 200 ms
+		static constexpr int32 NumBins = 401;
+
+		FName NodeType;
+		std::atomic<uint32> SendBins[NumBins];
+		std::atomic<uint32> RampBins[NumBins];
+		std::atomic<uint32> TotalBins[NumBins];
+		std::atomic<uint32> NumChanges { 0 };
+		std::atomic<uint32> NumSuperseded { 0 };
+
+		FLatencyHistogram(FName InNodeType)
+			: NodeType(InNodeType)
+		{
+			Reset();
+		}
+
+		void Reset()
+		{
+			for (int32 i = 0; i < NumBins; ++i)
+			{
+				SendBins[i].store(0, std::memory_order_relaxed);
+				RampBins[i].store(0, std::memory_order_relaxed);
+				TotalBins[i].store(0, std::memory_order_relaxed);
+			}
+			NumChanges.store(0, std::memory_order_relaxed);
+			NumSuperseded.store(0, std::memory_order_relaxed);
+		}
+
+		static void Add(std::atomic<uint32>* Bins, float Milliseconds)
+		{
+			const int32 Bin = FMath::Clamp(FMath::FloorToInt(Milliseconds / BinWidthMs), 0, NumBins - 1);
+			Bins[Bin].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		static FString Describe(const TCHAR* Label, const std::atomic<uint32>* Bins)
+		{
+			uint32 Counts[NumBins];
+			uint64 Total = 0;
+			for (int32 i = 0; i < NumBins; ++i)
+			{
+				Counts[i] = Bins[i].load(std::memory_order_relaxed);
+				Total += Counts[i];
+			}
+
+			if (Total == 0)
+			{
+				return FString::Printf(TEXT("  %s: no samples\n"), Label);
+			}
+
+			// Upper edge of the bin holding the given fraction of samples
+			auto GetPercentile = [&Counts, Total](float Fraction)
+				{
+					const uint64 Rank = FMath::Max<uint64>(1, (uint64)FMath::CeilToDouble(Fraction * Total));
+					uint64 Cumulative = 0;
+					for (int32 i = 0; i < NumBins; ++i)
+					{
+						Cumulative += Counts[i];
+						if (Cumulative >= Rank)
+						{
+							return (i + 1) * BinWidthMs;
+						}
+					}
+					return NumBins * BinWidthMs;
+				};
+
+			FString Result = FString::Printf(TEXT("  %s: %llu samples, p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n"),
+				Label, Total, GetPercentile(0.5f), GetPercentile(0.9f), GetPercentile(0.99f), GetPercentile(1.f));
+
+			for (int32 i = 0; i < NumBins; ++i)
+			{
+				if (Counts[i] > 0)
+				{
+					if (i == NumBins - 1)
+					{
+						Result += FString::Printf(TEXT("    >= %.1f ms: %u\n"), i * BinWidthMs, Counts[i]);
+					}
+					else
+					{
+						Result += FString::Printf(TEXT("    %.1f-%.1f ms: %u\n"), i * BinWidthMs, (i + 1) * BinWidthMs, Counts[i]);
+					}
+				}
+			}
+			return Result;
+		}
+	};
+
+	// Last send of one probe id. Shared by every probe with that id and never freed. The game thread writes Seconds
+	// and then bumps Sequence, so a render thread that sees a new Sequence reads the matching time.
+	struct FLatencySendStamp
+	{
+		std::atomic<double> Seconds { 0.0 };
+		std::atomic<uint32> Sequence { 0 };
+	};
+
+	namespace LatencyProbePrivate
+	{
+		// Changes smaller than this don't move the gain audibly and aren't measured
+		static constexpr float MinGainChange = 1e-4f;
+
+		static constexpr float ReachedFraction = 0.9f;
+
+		static FCriticalSection HistogramsLock;
+		static TMap<FName, TUniquePtr<FLatencyHistogram>> Histograms;
+		static TMap<FName, TUniquePtr<FLatencySendStamp>> SendStamps;
+
+		// Call with HistogramsLock held
+		static FLatencySendStamp& FindOrAddSendStamp(FName ProbeId)
+		{
+			TUniquePtr<FLatencySendStamp>& SendStamp = SendStamps.FindOrAdd(ProbeId);
+			if (!SendStamp)
+			{
+				SendStamp = MakeUnique<FLatencySendStamp>();
+			}
+			return *SendStamp;
+		}
+	}
+
+	TSharedPtr<FLatencyProbe, ESPMode::ThreadSafe> FLatencyProbe::Open(FName NodeType, FName InputName, const FOperatorSettings& InSettings, int32 NumGains, bool bPerBlockRamps)
+	{
+		using namespace LatencyProbePrivate;
+
+		if (MSUtilsLatencyProbeEnabled == 0)
+		{
+			return nullptr;
+		}
+
+		// Only taken when an operator is created, never from Execute
+		MSUTILS_NOTE_LOCK(TEXT("LatencyProbe HistogramsLock"));
+		FScopeLock Lock(&HistogramsLock);
+		TUniquePtr<FLatencyHistogram>& Histogram = Histograms.FindOrAdd(NodeType);
+		if (!Histogram)
+		{
+			Histogram = MakeUnique<FLatencyHistogram>(NodeType);
+		}
+		const FName ProbeId = MSUtilsLatencyProbeId.IsEmpty() ? InputName : FName(*MSUtilsLatencyProbeId);
+		return MakeShared<FLatencyProbe, ESPMode::ThreadSafe>(*Histogram, FindOrAddSendStamp(ProbeId), InSettings, NumGains, bPerBlockRamps);
+	}
+
+	void FLatencyProbe::NoteParameterSent(FName ProbeId)
+	{
+		using namespace LatencyProbePrivate;
+
+		if (MSUtilsLatencyProbeEnabled == 0)
+		{
+			return;
+		}
+
+		const double Now = FPlatformTime::Seconds();
+
+		// Game thread only, never from Execute
+		MSUTILS_NOTE_LOCK(TEXT("LatencyProbe HistogramsLock"));
+		FScopeLock Lock(&HistogramsLock);
+		FLatencySendStamp& SendStamp = FindOrAddSendStamp(ProbeId);
+		SendStamp.Seconds.store(Now, std::memory_order_relaxed);
+		SendStamp.Sequence.fetch_add(1, std::memory_order_release);
+	}
+
+	FString FLatencyProbe::GetReport()
+	{
+		using namespace LatencyProbePrivate;
+
+		MSUTILS_NOTE_LOCK(TEXT("LatencyProbe HistogramsLock"));
+		FScopeLock Lock(&HistogramsLock);
+		if (Histograms.Num() == 0)
+		{
+			return TEXT("No latency probes have run. Set au.MSUtils.LatencyProbe.Enabled 1 before the nodes are created.");
+		}
+
+		FString Report = TEXT("Parameter-to-gain latency. Send: from NoteParameterSent to the block that saw the change. Ramp: from that block to 90% of the new gain. Total: Send plus Ramp.\n");
+		for (const TPair<FName, TUniquePtr<FLatencyHistogram>>& Pair : Histograms)
+		{
+			const FLatencyHistogram& Histogram = *Pair.Value;
+			Report += FString::Printf(TEXT("%s: %u changes, %u superseded before reaching 90%%\n"), *Histogram.NodeType.ToString(),
+				Histogram.NumChanges.load(std::memory_order_relaxed), Histogram.NumSuperseded.load(std::memory_order_relaxed));
+			Report += FLatencyHistogram::Describe(TEXT("Send"), Histogram.SendBins);
+			Report += FLatencyHistogram::Describe(TEXT("Ramp"), Histogram.RampBins);
+			Report += FLatencyHistogram::Describe(TEXT("Total"), Histogram.TotalBins);
+		}
+		return Report;
+	}
+
+	void FLatencyProbe::ResetHistograms()
+	{
+		using namespace LatencyProbePrivate;
+
+		MSUTILS_NOTE_LOCK(TEXT("LatencyProbe HistogramsLock"));
+		FScopeLock Lock(&HistogramsLock);
+		for (TPair<FName, TUniquePtr<FLatencyHistogram>>& Pair : Histograms)
+		{
+			Pair.Value->Reset();
+		}
+	}
+
+	FLatencyProbe::FLatencyProbe(FLatencyHistogram& InHistogram, FLatencySendStamp& InSendStamp, const FOperatorSettings& InSettings, int32 NumGains, bool bInPerBlockRamps)
+		: Histogram(InHistogram),
+		SendStamp(InSendStamp),
+		SendSequence(InSendStamp.Sequence.load(std::memory_order_acquire)),
+		NumFramesPerBlock(InSettings.GetNumFramesPerBlock()),
+		SampleRate(InSettings.GetSampleRate()),
+		bPerBlockRamps(bInPerBlockRamps)
+	{
+		PrevGains.AddZeroed(NumGains);
+	}
+
+	void FLatencyProbe::OnBlock(float InputValue, TArrayView<const float> Gains)
+	{
+		using namespace LatencyProbePrivate;
+
+		check(Gains.Num() == PrevGains.Num());
+
+		if (bHasBlock && InputValue != PrevInput)
+		{
+			Histogram.NumChanges.fetch_add(1, std::memory_order_relaxed);
+			if (bPending)
+			{
+				Histogram.NumSuperseded.fetch_add(1, std::memory_order_relaxed);
+				bPending = false;
+			}
+
+			// Follow the gain that moves furthest
+			float LargestChange = MinGainChange;
+			TrackedGain = INDEX_NONE;
+			for (int32 i = 0; i < Gains.Num(); ++i)
+			{
+				const float Change = FMath::Abs(Gains[i] - PrevGains[i]);
+				if (Change > LargestChange)
+				{
+					LargestChange = Change;
+					TrackedGain = i;
+				}
+			}
+
+			if (TrackedGain != INDEX_NONE)
+			{
+				bPending = true;
+				ChangeBlockIndex = BlockIndex;
+				Origin = PrevGains[TrackedGain];
+				Threshold = Origin + ReachedFraction * (Gains[TrackedGain] - Origin);
+			}
+
+			// A send since the last change is the one that caused this one
+			SendMs = -1.f;
+			const uint32 Sequence = SendStamp.Sequence.load(std::memory_order_acquire);
+			if (Sequence != SendSequence)
+			{
+				SendSequence = Sequence;
+				SendMs = FMath::Max(0.f, (float)(1000.0 * (FPlatformTime::Seconds() - SendStamp.Seconds.load(std::memory_order_relaxed))));
+				FLatencyHistogram::Add(Histogram.SendBins, SendMs);
+				TRACE_COUNTER_SET(MSUtilsLatencyProbeSendMs, SendMs);
+			}
+		}
+
+		if (bPending)
+		{
+			const int32 Frame = FindCrossingFrame(PrevGains[TrackedGain], Gains[TrackedGain]);
+			if (Frame != INDEX_NONE)
+			{
+				const int64 LatencyFrames = (int64)(BlockIndex - ChangeBlockIndex) * NumFramesPerBlock + Frame;
+				const float RampMs = 1000.f * LatencyFrames / SampleRate;
+				FLatencyHistogram::Add(Histogram.RampBins, RampMs);
+				TRACE_COUNTER_SET(MSUtilsLatencyProbeRampMs, RampMs);
+				if (SendMs >= 0.f)
+				{
+					FLatencyHistogram::Add(Histogram.TotalBins, SendMs + RampMs);
+					TRACE_COUNTER_SET(MSUtilsLatencyProbeTotalMs, SendMs + RampMs);
+				}
+				bPending = false;
+			}
+		}
+
+		FMemory::Memcpy(PrevGains.GetData(), Gains.GetData(), Gains.Num() * sizeof(float));
+		PrevInput = InputValue;
+		bHasBlock = true;
+		++BlockIndex;
+	}
+
+	int32 FLatencyProbe::FindCrossingFrame(float StartGain, float EndGain) const
+	{
+		// Work in the direction of travel so rising and falling gains share one test
+		const float Direction = Threshold >= Origin ? 1.f : -1.f;
+		const float RampStart = (bPerBlockRamps ? EndGain : StartGain) * Direction;
+		const float RampEnd = EndGain * Direction;
+		const float Target = Threshold * Direction;
+
+		if (RampStart >= Target)
+		{
+			return 0;
+		}
+		if (RampEnd < Target)
+		{
+			return INDEX_NONE;
+		}
+
+		// Same ramp as the mixing kernels: frame n is at Start + n * (End - Start) / NumFrames
+		const float Delta = (RampEnd - RampStart) / FMath::Max(NumFramesPerBlock, 1);
+		return FMath::Min(FMath::CeilToInt((Target - RampStart) / Delta), NumFramesPerBlock);
+	}
+}
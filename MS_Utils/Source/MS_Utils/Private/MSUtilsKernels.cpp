@@ -0,0 +1,108 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "MSUtilsKernels.h"
+
+#include "DSP/FloatArrayMath.h"
+#include "HAL/IConsoleManager.h"
+
+#if INTEL_ISPC
+#include "MSUtilsKernels.ispc.generated.h"
+#endif
+
+#if !defined(MS_UTILS_ISPC_ENABLED_DEFAULT)
+#define MS_UTILS_ISPC_ENABLED_DEFAULT 1
+#endif
+
+// Shipping builds compile the switch out, like the engine's own ISPC toggles.
+#if !INTEL_ISPC
+static const bool bMSUtilsISPCEnabled = false;
+#elif UE_BUILD_SHIPPING
+static const bool bMSUtilsISPCEnabled = true;
+#else
+static bool bMSUtilsISPCEnabled = MS_UTILS_ISPC_ENABLED_DEFAULT;
+static FAutoConsoleVariableRef CVarMSUtilsISPCEnabled(
+	TEXT("au.MSUtils.ISPC.Enabled"),
+	bMSUtilsISPCEnabled,
+	TEXT("Use the ISPC kernels for MS_Utils mixing and fades. 0 forces the scalar Audio::Array* path."));
+#endif
+
+namespace Metasound
+{
+	namespace MSUtilsKernels
+	{
+		void MixIn(TArrayView<const float> InValues, TArrayView<float> OutValues, float StartGain, float EndGain)
+		{
+			check(InValues.Num() == OutValues.Num());
+
+			if (bMSUtilsISPCEnabled)
+			{
+#if INTEL_ISPC
+				ispc::MixIn(InValues.GetData(), OutValues.GetData(), InValues.Num(), StartGain, EndGain);
+#endif
+			}
+			else
+			{
+				Audio::ArrayMixIn(InValues, OutValues, StartGain, EndGain);
+			}
+		}
+
+		float MixInAndMeasure(TArrayView<const float> InValues, TArrayView<float> OutValues, float StartGain, float EndGain)
+		{
+			check(InValues.Num() == OutValues.Num());
+
+			if (bMSUtilsISPCEnabled)
+			{
+#if INTEL_ISPC
+				return ispc::MixInAndMeasure(InValues.GetData(), OutValues.GetData(), InValues.Num(), StartGain, EndGain);
+#endif
+			}
+
+			const int32 Num = InValues.Num();
+			const float* In = InValues.GetData();
+			float* Out = OutValues.GetData();
+			const float Delta = (EndGain - StartGain) / FMath::Max(Num, 1);
+
+			float SumOfSquares = 0.f;
+			for (int32 i = 0; i < Num; ++i)
+			{
+				Out[i] += In[i] * (StartGain + i * Delta);
+				SumOfSquares += In[i] * In[i];
+			}
+			return SumOfSquares;
+		}
+
+		void FadeCopy(TArrayView<const float> InValues, TArrayView<float> OutValues, float StartGain, float EndGain)
+		{
+			check(InValues.Num() == OutValues.Num());
+
+			if (bMSUtilsISPCEnabled)
+			{
+#if INTEL_ISPC
+				ispc::FadeCopy(InValues.GetData(), OutValues.GetData(), InValues.Num(), StartGain, EndGain);
+#endif
+			}
+			else
+			{
+				FMemory::Memcpy(OutValues.GetData(), InValues.GetData(), sizeof(float) * InValues.Num());
+				Audio::ArrayFade(OutValues, StartGain, EndGain);
+			}
+		}
+
+		float SumOfSquares(TArrayView<const float> InValues)
+		{
+			if (bMSUtilsISPCEnabled)
+			{
+#if INTEL_ISPC
+				return ispc::SumOfSquares(InValues.GetData(), InValues.Num());
+#endif
+			}
+
+			float Sum = 0.f;
+			for (const float Value : InValues)
+			{
+				Sum += Value * Value;
+			}
+			return Sum;
+		}
+	}
+}
@@ -0,0 +1,61 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "MSUtilsQuality.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/ConfigUtilities.h"
+
+// 0 = low, 1 = medium, 2 = high
+static int32 MSUtilsQualityTier = 2;
+static FAutoConsoleVariableRef CVarMSUtilsQualityTier(
+	TEXT("au.MSUtils.Quality"),
+	MSUtilsQualityTier,
+	TEXT("Quality tier for MS_Utils nodes created from now on. 0: approximate gains, per-block ramps, two-corner Vector Crossfade. 1: approximate gains. 2: exact (default)."),
+	ECVF_Scalability);
+
+// Per-option overrides. -1 follows au.MSUtils.Quality.
+static int32 MSUtilsApproximateGains = -1;
+static FAutoConsoleVariableRef CVarMSUtilsApproximateGains(
+	TEXT("au.MSUtils.ApproximateGains"),
+	MSUtilsApproximateGains,
+	TEXT("1 uses a cubic approximation of the equal-power curve, 0 uses cos. -1 follows au.MSUtils.Quality."),
+	ECVF_Scalability);
+
+static int32 MSUtilsPerBlockRamps = -1;
+static FAutoConsoleVariableRef CVarMSUtilsPerBlockRamps(
+	TEXT("au.MSUtils.PerBlockRamps"),
+	MSUtilsPerBlockRamps,
+	TEXT("1 steps gains at block boundaries, 0 ramps them per sample. -1 follows au.MSUtils.Quality."),
+	ECVF_Scalability);
+
+static int32 MSUtilsTwoInputFallback = -1;
+static FAutoConsoleVariableRef CVarMSUtilsTwoInputFallback(
+	TEXT("au.MSUtils.TwoInputFallback"),
+	MSUtilsTwoInputFallback,
+	TEXT("1 limits Vector Crossfade to its two loudest corners. Corners leaving the mix still fade out over one block. Other crossfades always mix at most two inputs. -1 follows au.MSUtils.Quality."),
+	ECVF_Scalability);
+
+namespace Metasound
+{
+	FMSUtilsQuality FMSUtilsQuality::Get()
+	{
+		auto Resolve = [](int32 Override, bool bTierDefault)
+			{
+				return Override < 0 ? bTierDefault : Override != 0;
+			};
+
+		FMSUtilsQuality Quality;
+		Quality.bApproximateGains = Resolve(MSUtilsApproximateGains, MSUtilsQualityTier <= 1);
+		Quality.bPerBlockRamps = Resolve(MSUtilsPerBlockRamps, MSUtilsQualityTier <= 0);
+		Quality.bTwoInputFallback = Resolve(MSUtilsTwoInputFallback, MSUtilsQualityTier <= 0);
+		return Quality;
+	}
+
+	void FMSUtilsQuality::ApplyPlatformSettings()
+	{
+		// GEngineIni is already layered per platform, so this picks up Config/<Platform>/<Platform>Engine.ini.
+		// Set at project priority so device profiles and the console can still override.
+		UE::ConfigUtilities::ApplyCVarSettingsFromIni(TEXT("MSUtils.Quality"), *GEngineIni, ECVF_SetByProjectSetting);
+	}
+}
@@ -0,0 +1,45 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MetasoundVertex.h"
+
+//------------------------------------------------------------------------------------
+// MSUtilsVertexNames
+//------------------------------------------------------------------------------------
+
+// Builders for the numbered vertex tables of the nodes registered at several input or output counts. A node keeps each
+// table in a function static sized to the largest count it registers, so every variant shares it and
+// GetVertexInterface, CreateOperator and BindInputs don't format strings or create FNames per call.
+namespace Metasound
+{
+	namespace MSUtilsVertexNames
+	{
+		// Names for indices 0 to Num - 1, formatted from Pattern: "In {0}" gives In 0, In 1 and so on
+		inline TArray<FVertexName> MakeNames(const TCHAR* Pattern, int32 Num)
+		{
+			TArray<FVertexName> Names;
+			Names.Reserve(Num);
+			for (int32 i = 0; i < Num; ++i)
+			{
+				Names.Add(*FString::Format(Pattern, { i }));
+			}
+			return Names;
+		}
+
+		// Metadata for indices 0 to Num - 1, MakeEntry(Index) giving each entry
+		template<typename FuncType>
+		TArray<FDataVertexMetadata> MakeMetadata(int32 Num, FuncType&& MakeEntry)
+		{
+			TArray<FDataVertexMetadata> Metadata;
+			Metadata.Reserve(Num);
+			for (int32 i = 0; i < Num; ++i)
+			{
+				Metadata.Add(MakeEntry(i));
+			}
+			return Metadata;
+		}
+	}
+}
@@ -2,6 +2,8 @@
 
 #include "MS_Utils.h"
 #include "MetasoundNodeRegistrationMacro.h"
+#include "MSUtilsQuality.h"
+#include "OperatorCapture.h"
 
 #define LOCTEXT_NAMESPACE "FMS_UtilsModule"
 
@@ -9,12 +11,14 @@ void FMS_UtilsModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
 	FMetasoundFrontendRegistryContainer::Get()->RegisterPendingNodes();
+	Metasound::FMSUtilsQuality::ApplyPlatformSettings();
 }
 
 void FMS_UtilsModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	Metasound::FOperatorCapture::Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
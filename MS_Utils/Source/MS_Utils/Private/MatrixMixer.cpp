@@ -0,0 +1,461 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "MS_Utils.h"
+#include "MSUtilsQuality.h"
+#include "MSUtilsVertexNames.h"
+#include "RenderThreadGuard.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundAudioBuffer.h"
+#include "CoreMinimal.h"
+#include "Internationalization/Text.h"
+#include "MetasoundExecutableOperator.h"
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundStandardNodesCategories.h"
+#include "MetasoundStandardNodesNames.h"
+#include "MetasoundVertex.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_MatrixMixer"
+
+DECLARE_CYCLE_STAT(TEXT("Matrix Mixer Execute"), STAT_MSUtils_MatrixMixerExecute, STATGROUP_MSUtils);
+
+#define REGISTER_MATRIXMIXER_NODE(NumIn, NumOut) \
+	using FMatrixMixerNode##NumIn##x##NumOut = TMatrixMixerNode<NumIn, NumOut>; \
+	METASOUND_REGISTER_NODE(FMatrixMixerNode##NumIn##x##NumOut) \
+
+namespace Metasound
+{
+	namespace MatrixMixerVertexNames
+	{
+		METASOUND_PARAM(InputGains, "Gains", "Gain matrix, one row per input: element [Input * NumOutputs + Output]. Missing elements are treated as 0.")
+
+		constexpr int32 MaxNumChannels = 64;
+
+		const FVertexName& GetInputName(int32 InIndex)
+		{
+			static const TArray<FVertexName> InputNames = MSUtilsVertexNames::MakeNames(TEXT("In {0}"), MaxNumChannels);
+
+			check(InIndex < MaxNumChannels);
+			return InputNames[InIndex];
+		}
+
+		const FVertexName& GetOutputName(int32 InIndex)
+		{
+			static const TArray<FVertexName> OutputNames = MSUtilsVertexNames::MakeNames(TEXT("Out {0}"), MaxNumChannels);
+
+			check(InIndex < MaxNumChannels);
+			return OutputNames[InIndex];
+		}
+
+		const FDataVertexMetadata& GetInputMetadata(int32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> InputMetadata = MSUtilsVertexNames::MakeMetadata(MaxNumChannels, [](int32 i) -> FDataVertexMetadata
+				{
+					return { METASOUND_LOCTEXT_FORMAT("MatrixMixerInputDesc", "Matrix input {0}, gain row {0}.", i), METASOUND_LOCTEXT_FORMAT("MatrixMixerInputDisplayName", "In {0}", i) };
+				});
+
+			check(InIndex < MaxNumChannels);
+			return InputMetadata[InIndex];
+		}
+
+		const FDataVertexMetadata& GetOutputMetadata(int32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> OutputMetadata = MSUtilsVertexNames::MakeMetadata(MaxNumChannels, [](int32 i) -> FDataVertexMetadata
+				{
+					return { METASOUND_LOCTEXT_FORMAT("MatrixMixerOutputDesc", "Matrix output {0}, gain column {0}.", i), METASOUND_LOCTEXT_FORMAT("MatrixMixerOutputDisplayName", "Out {0}", i) };
+				});
+
+			check(InIndex < MaxNumChannels);
+			return OutputMetadata[InIndex];
+		}
+	}
+
+	class FMatrixMixerHelper
+	{
+	public:
+		FMatrixMixerHelper(int32 InNumFramesPerBlock, int32 InNumInputs, int32 InNumOutputs, const FMSUtilsQuality& InQuality)
+			: NumFramesPerBlock(InNumFramesPerBlock), NumInputs(InNumInputs), NumOutputs(InNumOutputs), Quality(InQuality)
+		{
+			// Everything is sized up front so Execute never allocates
+			PrevGains.AddZeroed(NumInputs * NumOutputs);
+			TargetGains.AddZeroed(NumInputs * NumOutputs);
+			Cells.Reserve(NumInputs * NumOutputs);
+			OutputCellStart.AddZeroed(NumOutputs + 1);
+			OutputSilent.Init(false, NumOutputs);
+			RowDirty.Init(true, NumInputs);
+			RowRamping.Init(false, NumInputs);
+		}
+
+		// Copies in the rows of the gain matrix that changed and flags them. Rows stop comparing at the first
+		// difference, and unchanged rows leave the cell list alone.
+		void SetGains(const TArray<float>& InGains)
+		{
+			for (int32 InputIndex = 0; InputIndex < NumInputs; ++InputIndex)
+			{
+				const int32 RowStart = InputIndex * NumOutputs;
+				const int32 NumProvided = FMath::Clamp(InGains.Num() - RowStart, 0, NumOutputs);
+				float* TargetRow = &TargetGains[RowStart];
+
+				bool bChanged = NumProvided > 0 && FMemory::Memcmp(TargetRow, &InGains[RowStart], NumProvided * sizeof(float)) != 0;
+				for (int32 i = NumProvided; i < NumOutputs && !bChanged; ++i)
+				{
+					bChanged = TargetRow[i] != 0.f;
+				}
+
+				if (bChanged)
+				{
+					if (NumProvided > 0)
+					{
+						FMemory::Memcpy(TargetRow, &InGains[RowStart], NumProvided * sizeof(float));
+					}
+					FMemory::Memzero(TargetRow + NumProvided, (NumOutputs - NumProvided) * sizeof(float));
+					RowDirty[InputIndex] = true;
+					bCellsDirty = true;
+				}
+			}
+		}
+
+		// Takes the current gains without ramping from whatever was playing before the reset
+		void Reset(const TArray<float>& InGains)
+		{
+			SetGains(InGains);
+			FMemory::Memcpy(PrevGains.GetData(), TargetGains.GetData(), PrevGains.Num() * sizeof(float));
+			for (int32 InputIndex = 0; InputIndex < NumInputs; ++InputIndex)
+			{
+				RowDirty[InputIndex] = true;
+				RowRamping[InputIndex] = false;
+			}
+			for (int32 OutputIndex = 0; OutputIndex < NumOutputs; ++OutputIndex)
+			{
+				OutputSilent[OutputIndex] = false;
+			}
+			bRamping = false;
+			bCellsDirty = true;
+		}
+
+		void Process(TArrayView<const FAudioBufferReadRef> InAudioBuffers, TArrayView<const FAudioBufferWriteRef> OutAudioBuffers)
+		{
+			if (bCellsDirty)
+			{
+				RebuildCells();
+			}
+
+			// Serial on purpose: the graph's voices already render in parallel, and fanning out here would allocate
+			// tasks and wait on them inside Execute
+			for (int32 OutputIndex = 0; OutputIndex < NumOutputs; ++OutputIndex)
+			{
+				MixOutputTiled(OutputIndex, InAudioBuffers, *OutAudioBuffers[OutputIndex]);
+			}
+
+			// Ramps finish each block. The rows that ran one settle on their targets, and the cell list is rebuilt so
+			// finished cells drop to a constant gain and cells that reached zero are skipped.
+			if (bRamping)
+			{
+				for (int32 InputIndex = 0; InputIndex < NumInputs; ++InputIndex)
+				{
+					if (RowRamping[InputIndex])
+					{
+						const int32 RowStart = InputIndex * NumOutputs;
+						FMemory::Memcpy(&PrevGains[RowStart], &TargetGains[RowStart], NumOutputs * sizeof(float));
+						RowRamping[InputIndex] = false;
+						RowDirty[InputIndex] = true;
+					}
+				}
+				bRamping = false;
+				bCellsDirty = true;
+			}
+		}
+
+	private:
+		struct FCell
+		{
+			int32 InputIndex;
+			float StartGain;
+			float EndGain;
+		};
+
+		// Rebuilds the sparse list of contributing cells, grouped by output. A cell is kept while its previous or
+		// target gain is non-zero, the same rule TEPXFHelper uses for NeedsMixing. Only dirty rows can start a ramp,
+		// so only they are checked for one.
+		void RebuildCells()
+		{
+			Cells.Reset();
+
+			for (int32 OutputIndex = 0; OutputIndex < NumOutputs; ++OutputIndex)
+			{
+				OutputCellStart[OutputIndex] = Cells.Num();
+				for (int32 InputIndex = 0; InputIndex < NumInputs; ++InputIndex)
+				{
+					const int32 CellIndex = InputIndex * NumOutputs + OutputIndex;
+					const float EndGain = TargetGains[CellIndex];
+					const float StartGain = RowDirty[InputIndex] ? Quality.GetRampStartGain(PrevGains[CellIndex], EndGain) : EndGain;
+					if (StartGain != 0.f || EndGain != 0.f)
+					{
+						Cells.Add({ InputIndex, StartGain, EndGain });
+						if (StartGain != EndGain)
+						{
+							RowRamping[InputIndex] = true;
+							bRamping = true;
+						}
+					}
+				}
+			}
+			OutputCellStart[NumOutputs] = Cells.Num();
+
+			for (bool& bRowDirty : RowDirty)
+			{
+				bRowDirty = false;
+			}
+			bCellsDirty = false;
+		}
+
+		// Accumulates every contributing input for one output a tile at a time, so partial sums stay in registers
+		// and the output buffer is written once per tile instead of once per input.
+		void MixOutputTiled(int32 OutputIndex, TArrayView<const FAudioBufferReadRef> InAudioBuffers, FAudioBuffer& OutAudioBuffer)
+		{
+			const int32 FirstCell = OutputCellStart[OutputIndex];
+			const int32 NumOutputCells = OutputCellStart[OutputIndex + 1] - FirstCell;
+			float* OutData = OutAudioBuffer.GetData();
+
+			if (NumOutputCells == 0)
+			{
+				// Silent outputs only need zeroing once
+				if (!OutputSilent[OutputIndex])
+				{
+					OutAudioBuffer.Zero();
+					OutputSilent[OutputIndex] = true;
+				}
+				return;
+			}
+			OutputSilent[OutputIndex] = false;
+
+			constexpr int32 TileSize = 16;
+			const float InvNumFrames = 1.f / NumFramesPerBlock;
+
+			for (int32 TileStart = 0; TileStart < NumFramesPerBlock; TileStart += TileSize)
+			{
+				const int32 NumTileFrames = FMath::Min(TileSize, NumFramesPerBlock - TileStart);
+				float Accum[TileSize] = { };
+
+				for (int32 CellIndex = FirstCell; CellIndex < FirstCell + NumOutputCells; ++CellIndex)
+				{
+					const FCell& Cell = Cells[CellIndex];
+					const float* InData = InAudioBuffers[Cell.InputIndex]->GetData() + TileStart;
+
+					// Same ramp as Audio::ArrayMixIn: sample i gets StartGain + i * (EndGain - StartGain) / NumFrames
+					const float Delta = (Cell.EndGain - Cell.StartGain) * InvNumFrames;
+					const float Gain = Cell.StartGain + TileStart * Delta;
+
+					for (int32 i = 0; i < NumTileFrames; ++i)
+					{
+						Accum[i] += InData[i] * (Gain + i * Delta);
+					}
+				}
+
+				FMemory::Memcpy(OutData + TileStart, Accum, NumTileFrames * sizeof(float));
+			}
+		}
+
+		int32 NumFramesPerBlock = 0;
+		int32 NumInputs = 0;
+		int32 NumOutputs = 0;
+		FMSUtilsQuality Quality;
+		TArray<float> PrevGains;
+		TArray<float> TargetGains;
+		TArray<FCell> Cells;
+		TArray<int32> OutputCellStart;
+		TArray<bool> OutputSilent;
+
+		// Per input row: gains changed since the last rebuild, and a ramp is running this block
+		TArray<bool> RowDirty;
+		TArray<bool> RowRamping;
+		bool bCellsDirty = true;
+		bool bRamping = false;
+	};
+
+	template<int32 NumInputs, int32 NumOutputs>
+	class TMatrixMixerOperator : public TExecutableOperator<TMatrixMixerOperator<NumInputs, NumOutputs>>
+	{
+		static_assert(NumInputs <= MatrixMixerVertexNames::MaxNumChannels && NumOutputs <= MatrixMixerVertexNames::MaxNumChannels, "MatrixMixerVertexNames::MaxNumChannels must cover every registered channel count");
+
+	public:
+		using FInputArray = TArray<FAudioBufferReadRef, TInlineAllocator<NumInputs>>;
+		using FOutputArray = TArray<FAudioBufferWriteRef, TInlineAllocator<NumOutputs>>;
+
+		static const FVertexInterface& GetVertexInterface()
+		{
+			using namespace MatrixMixerVertexNames;
+
+			auto CreateDefaultInterface = []() -> FVertexInterface
+				{
+					FInputVertexInterface InputInterface;
+
+					InputInterface.Add(TInputDataVertex<TArray<float>>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputGains)));
+
+					for (int32 i = 0; i < NumInputs; ++i)
+					{
+						InputInterface.Add(TInputDataVertex<FAudioBuffer>(GetInputName(i), GetInputMetadata(i)));
+					}
+
+					FOutputVertexInterface OutputInterface;
+					for (int32 i = 0; i < NumOutputs; ++i)
+					{
+						OutputInterface.Add(TOutputDataVertex<FAudioBuffer>(GetOutputName(i), GetOutputMetadata(i)));
+					}
+
+					return FVertexInterface(InputInterface, OutputInterface);
+				};
+
+			static const FVertexInterface DefaultInterface = CreateDefaultInterface();
+			return DefaultInterface;
+		}
+
+		static const FNodeClassMetadata& GetNodeInfo()
+		{
+			auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+				{
+					FName DataTypeName = GetMetasoundDataTypeName<FAudioBuffer>();
+					FName OperatorName = *FString::Printf(TEXT("Matrix Mixer (%d x %d)"), NumInputs, NumOutputs);
+					FText NodeDisplayName = METASOUND_LOCTEXT_FORMAT("MatrixMixerDisplayNamePattern", "Matrix Mixer ({0} x {1})", NumInputs, NumOutputs);
+					const FText NodeDescription = METASOUND_LOCTEXT("MatrixMixerDescription", "Mixes every input into every output through a ramped gain matrix, skipping zero cells.");
+					FVertexInterface NodeInterface = GetVertexInterface();
+
+					FNodeClassMetadata Metadata
+					{
+						FNodeClassName { "MatrixMixer", OperatorName, DataTypeName },
+						1, // Major Version
+						0, // Minor Version
+						NodeDisplayName,
+						NodeDescription,
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Mix },
+						{ },
+						FNodeDisplayStyle()
+					};
+					return Metadata;
+				};
+
+			static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+			return Metadata;
+		}
+
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, TArray<TUniquePtr<IOperatorBuildError>>& OutErrors)
+		{
+			using namespace MatrixMixerVertexNames;
+
+			const FInputVertexInterface& InputInterface = InParams.Node.GetVertexInterface().GetInputInterface();
+			const FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+
+			TDataReadReference<TArray<float>> Gains = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<TArray<float>>(InputInterface, METASOUND_GET_PARAM_NAME(InputGains), InParams.OperatorSettings);
+
+			FInputArray InputValues;
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InputValues.Add(InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, GetInputName(i), InParams.OperatorSettings));
+			}
+
+			return MakeUnique<TMatrixMixerOperator<NumInputs, NumOutputs>>(InParams.OperatorSettings, Gains, MoveTemp(InputValues));
+		}
+
+		TMatrixMixerOperator(const FOperatorSettings& InSettings, const TDataReadReference<TArray<float>>& InGains, FInputArray&& InInputValues)
+			: Gains(InGains)
+			, InputValues(MoveTemp(InInputValues))
+			, Mixer(InSettings.GetNumFramesPerBlock(), NumInputs, NumOutputs, FMSUtilsQuality::Get())
+		{
+			for (int32 i = 0; i < NumOutputs; ++i)
+			{
+				OutputValues.Add(TDataWriteReferenceFactory<FAudioBuffer>::CreateAny(InSettings));
+			}
+
+			Execute();
+		}
+
+		virtual ~TMatrixMixerOperator() = default;
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace MatrixMixerVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputGains), Gains);
+
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InOutVertexData.BindReadVertex(GetInputName(i), InputValues[i]);
+			}
+		}
+
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace MatrixMixerVertexNames;
+
+			for (int32 i = 0; i < NumOutputs; ++i)
+			{
+				InOutVertexData.BindReadVertex(GetOutputName(i), OutputValues[i]);
+			}
+		}
+
+		virtual FDataReferenceCollection GetInputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		virtual FDataReferenceCollection GetOutputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		void Reset(const IOperator::FResetParams& InParams)
+		{
+			Mixer.Reset(*Gains);
+			Execute();
+		}
+
+		void Execute()
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MSUtils_MatrixMixerExecute);
+			MSUTILS_EXECUTE_SCOPE(TEXT("Matrix Mixer"));
+
+			Mixer.SetGains(*Gains);
+			Mixer.Process(InputValues, OutputValues);
+		}
+
+	private:
+		TDataReadReference<TArray<float>> Gains;
+		FInputArray InputValues;
+		FOutputArray OutputValues;
+		FMatrixMixerHelper Mixer;
+	};
+
+	template<int32 NumInputs, int32 NumOutputs>
+	class TMatrixMixerNode : public FNodeFacade
+	{
+	public:
+		/**
+		 * Constructor used by the Metasound Frontend.
+		 */
+		TMatrixMixerNode(const FNodeInitData& InInitData)
+			: FNodeFacade(InInitData.InstanceName, InInitData.InstanceID, TFacadeOperatorClass<TMatrixMixerOperator<NumInputs, NumOutputs>>())
+		{}
+
+		virtual ~TMatrixMixerNode() = default;
+	};
+
+	REGISTER_MATRIXMIXER_NODE(2, 2);
+	REGISTER_MATRIXMIXER_NODE(4, 2);
+	REGISTER_MATRIXMIXER_NODE(4, 4);
+	REGISTER_MATRIXMIXER_NODE(8, 2);
+	REGISTER_MATRIXMIXER_NODE(8, 8);
+	REGISTER_MATRIXMIXER_NODE(16, 16);
+	REGISTER_MATRIXMIXER_NODE(64, 64);
+
+}
+
+#undef LOCTEXT_NAMESPACE
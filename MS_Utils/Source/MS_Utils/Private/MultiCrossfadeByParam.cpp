@@ -0,0 +1,363 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "CrossfadeProfile.h"
+#include "MS_Utils.h"
+#include "MSUtilsKernels.h"
+#include "MSUtilsQuality.h"
+#include "RenderThreadGuard.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundAudioBuffer.h"
+#include "CoreMinimal.h"
+#include "Internationalization/Text.h"
+#include "MetasoundExecutableOperator.h"
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundStandardNodesCategories.h"
+#include "MetasoundStandardNodesNames.h"
+#include "MetasoundVertex.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_MultiCrossfadeByParam"
+
+DECLARE_CYCLE_STAT(TEXT("Multi Crossfade By Param Execute"), STAT_MSUtils_MultiCrossfadeByParamExecute, STATGROUP_MSUtils);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Multi Crossfade By Param Operators"), STAT_MSUtils_MultiCrossfadeByParamOperators, STATGROUP_MSUtils);
+
+#define REGISTER_MULTICBP_NODE(Number) \
+	using FMultiCBPNode##Number = TMultiCBPNode<Number>; \
+	METASOUND_REGISTER_NODE(FMultiCBPNode##Number) \
+
+
+namespace Metasound
+{
+	namespace MultiCBPVertexNames
+	{
+		METASOUND_PARAM(InputAudio, "Audio In", "Input audio.")
+		METASOUND_PARAM(OutputAudio, "Audio Out", "Input audio scaled by the product of every axis gain.")
+
+		constexpr int32 MaxNumAxes = 4;
+
+		// The inputs each axis has, in vertex order
+		enum class EAxisInput : int32
+		{
+			Value,
+			UseEPCrossfade,
+			FadeInStart,
+			FadeInEnd,
+			FadeOutStart,
+			FadeOutEnd,
+			Profile,
+			Count
+		};
+
+		constexpr int32 NumAxisInputs = (int32)EAxisInput::Count;
+
+		// Names and metadata are built once on first use and shared by every node variant, so
+		// GetVertexInterface, CreateOperator and BindInputs don't format strings or create FNames per call.
+		const FVertexName& GetAxisInputName(int32 InAxis, EAxisInput InInput)
+		{
+			static const TArray<FVertexName> AxisInputNames = []()
+				{
+					static const TCHAR* Patterns[NumAxisInputs] =
+					{
+						TEXT("Value {0}"), TEXT("Use EP Crossfade {0}"), TEXT("Fade In Start {0}"), TEXT("Fade In End {0}"), TEXT("Fade Out Start {0}"), TEXT("Fade Out End {0}"), TEXT("Profile {0}")
+					};
+
+					TArray<FVertexName> Names;
+					Names.Reserve(MaxNumAxes * NumAxisInputs);
+					for (int32 i = 0; i < MaxNumAxes; ++i)
+					{
+						for (int32 j = 0; j < NumAxisInputs; ++j)
+						{
+							Names.Add(*FString::Format(Patterns[j], { i }));
+						}
+					}
+					return Names;
+				}();
+
+			check(InAxis < MaxNumAxes);
+			return AxisInputNames[InAxis * NumAxisInputs + (int32)InInput];
+		}
+
+		const FDataVertexMetadata& GetAxisInputMetadata(int32 InAxis, EAxisInput InInput)
+		{
+			static const TArray<FDataVertexMetadata> AxisInputMetadata = []()
+				{
+					TArray<FDataVertexMetadata> Metadata;
+					Metadata.Reserve(MaxNumAxes * NumAxisInputs);
+					for (int32 i = 0; i < MaxNumAxes; ++i)
+					{
+						Metadata.Add({ METASOUND_LOCTEXT_FORMAT("MultiCBPValueDesc", "Parameter value of axis {0}.", i), METASOUND_LOCTEXT_FORMAT("MultiCBPValueDisplayName", "Value {0}", i) });
+						Metadata.Add({ METASOUND_LOCTEXT_FORMAT("MultiCBPUseEPDesc", "Use an equal power gain law for axis {0} instead of linear.", i), METASOUND_LOCTEXT_FORMAT("MultiCBPUseEPDisplayName", "Use EP Crossfade {0}", i) });
+						Metadata.Add({ METASOUND_LOCTEXT_FORMAT("MultiCBPFadeInStartDesc", "Value at which axis {0} starts fading in.", i), METASOUND_LOCTEXT_FORMAT("MultiCBPFadeInStartDisplayName", "Fade In Start {0}", i) });
+						Metadata.Add({ METASOUND_LOCTEXT_FORMAT("MultiCBPFadeInEndDesc", "Value at which axis {0} is fully faded in.", i), METASOUND_LOCTEXT_FORMAT("MultiCBPFadeInEndDisplayName", "Fade In End {0}", i) });
+						Metadata.Add({ METASOUND_LOCTEXT_FORMAT("MultiCBPFadeOutStartDesc", "Value at which axis {0} starts fading out.", i), METASOUND_LOCTEXT_FORMAT("MultiCBPFadeOutStartDisplayName", "Fade Out Start {0}", i) });
+						Metadata.Add({ METASOUND_LOCTEXT_FORMAT("MultiCBPFadeOutEndDesc", "Value at which axis {0} is fully faded out.", i), METASOUND_LOCTEXT_FORMAT("MultiCBPFadeOutEndDisplayName", "Fade Out End {0}", i) });
+						Metadata.Add({ METASOUND_LOCTEXT_FORMAT("MultiCBPProfileDesc", "Optional Crossfade Profile asset for axis {0}. When set, its zones and gain law replace the axis's fade and EP inputs.", i), METASOUND_LOCTEXT_FORMAT("MultiCBPProfileDisplayName", "Profile {0}", i) });
+					}
+					return Metadata;
+				}();
+
+			check(InAxis < MaxNumAxes);
+			return AxisInputMetadata[InAxis * NumAxisInputs + (int32)InInput];
+		}
+	}
+
+	// Crossfade By Param with several parameter axes. Each axis maps its value through its own fade in and fade out
+	// ranges and gain law, the same way Crossfade By Param does. The axis gains multiply into one gain, applied with
+	// a single ramped copy, so a layer that fades on distance and intensity costs one pass over the audio instead of
+	// two chained nodes. An axis gain is only worked out again when that axis's value or profile changes.
+	template<int32 NumAxes>
+	class TMultiCBPOperator : public TExecutableOperator<TMultiCBPOperator<NumAxes>>
+	{
+		static_assert(NumAxes <= MultiCBPVertexNames::MaxNumAxes, "MultiCBPVertexNames::MaxNumAxes must cover every registered axis count");
+
+	public:
+		struct FAxisInputs
+		{
+			FFloatReadRef Value;
+			FBoolReadRef bUseEPCrossfade;
+			FFloatReadRef FadeInStart;
+			FFloatReadRef FadeInEnd;
+			FFloatReadRef FadeOutStart;
+			FFloatReadRef FadeOutEnd;
+			FCrossfadeProfileAssetReadRef Profile;
+		};
+
+		using FAxisArray = TArray<FAxisInputs, TInlineAllocator<NumAxes>>;
+
+		static const FVertexInterface& GetVertexInterface()
+		{
+			using namespace MultiCBPVertexNames;
+
+			auto CreateDefaultInterface = []() -> FVertexInterface
+				{
+					FInputVertexInterface InputInterface;
+
+					InputInterface.Add(TInputDataVertex<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputAudio)));
+
+					for (int32 i = 0; i < NumAxes; ++i)
+					{
+						InputInterface.Add(TInputDataVertex<float>(GetAxisInputName(i, EAxisInput::Value), GetAxisInputMetadata(i, EAxisInput::Value)));
+						InputInterface.Add(TInputDataVertex<bool>(GetAxisInputName(i, EAxisInput::UseEPCrossfade), GetAxisInputMetadata(i, EAxisInput::UseEPCrossfade)));
+						InputInterface.Add(TInputDataVertex<float>(GetAxisInputName(i, EAxisInput::FadeInStart), GetAxisInputMetadata(i, EAxisInput::FadeInStart)));
+						InputInterface.Add(TInputDataVertex<float>(GetAxisInputName(i, EAxisInput::FadeInEnd), GetAxisInputMetadata(i, EAxisInput::FadeInEnd)));
+						InputInterface.Add(TInputDataVertex<float>(GetAxisInputName(i, EAxisInput::FadeOutStart), GetAxisInputMetadata(i, EAxisInput::FadeOutStart)));
+						InputInterface.Add(TInputDataVertex<float>(GetAxisInputName(i, EAxisInput::FadeOutEnd), GetAxisInputMetadata(i, EAxisInput::FadeOutEnd)));
+						InputInterface.Add(TInputDataVertex<FCrossfadeProfileAsset>(GetAxisInputName(i, EAxisInput::Profile), GetAxisInputMetadata(i, EAxisInput::Profile)));
+					}
+
+					FOutputVertexInterface OutputInterface;
+					OutputInterface.Add(TOutputDataVertex<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutputAudio)));
+
+					return FVertexInterface(InputInterface, OutputInterface);
+				};
+
+			static const FVertexInterface DefaultInterface = CreateDefaultInterface();
+			return DefaultInterface;
+		}
+
+		static const FNodeClassMetadata& GetNodeInfo()
+		{
+			auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+				{
+					FName DataTypeName = GetMetasoundDataTypeName<FAudioBuffer>();
+					FName OperatorName = *FString::Printf(TEXT("Crossfade By Param (%d Axes)"), NumAxes);
+					FText NodeDisplayName = METASOUND_LOCTEXT_FORMAT("MultiCBPDisplayNamePattern", "Crossfade By Param ({0} Axes)", NumAxes);
+					const FText NodeDescription = METASOUND_LOCTEXT("MultiCBPDescription", "Fades a single audio channel by several mapped parameters at once. The gain of each axis is multiplied into one fade.");
+					FVertexInterface NodeInterface = GetVertexInterface();
+
+					FNodeClassMetadata Metadata
+					{
+						FNodeClassName { "MultiCrossfadeByParam", OperatorName, DataTypeName },
+						1, // Major Version
+						1, // Minor Version
+						NodeDisplayName,
+						NodeDescription,
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Envelopes },
+						{ },
+						FNodeDisplayStyle()
+					};
+					return Metadata;
+				};
+
+			static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+			return Metadata;
+		}
+
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, TArray<TUniquePtr<IOperatorBuildError>>& OutErrors)
+		{
+			using namespace MultiCBPVertexNames;
+
+			const FInputVertexInterface& InputInterface = InParams.Node.GetVertexInterface().GetInputInterface();
+			const FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+
+			FAudioBufferReadRef AudioIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InputAudio), InParams.OperatorSettings);
+
+			auto GetFloat = [&](int32 Axis, EAxisInput Input)
+				{
+					return InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, GetAxisInputName(Axis, Input), InParams.OperatorSettings);
+				};
+
+			FAxisArray Axes;
+			for (int32 i = 0; i < NumAxes; ++i)
+			{
+				Axes.Add({
+					GetFloat(i, EAxisInput::Value),
+					InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<bool>(InputInterface, GetAxisInputName(i, EAxisInput::UseEPCrossfade), InParams.OperatorSettings),
+					GetFloat(i, EAxisInput::FadeInStart),
+					GetFloat(i, EAxisInput::FadeInEnd),
+					GetFloat(i, EAxisInput::FadeOutStart),
+					GetFloat(i, EAxisInput::FadeOutEnd),
+					InputCollection.GetDataReadReferenceOrConstruct<FCrossfadeProfileAsset>(GetAxisInputName(i, EAxisInput::Profile)) });
+			}
+
+			return MakeUnique<TMultiCBPOperator<NumAxes>>(InParams.OperatorSettings, AudioIn, MoveTemp(Axes));
+		}
+
+		TMultiCBPOperator(const FOperatorSettings& InSettings, const FAudioBufferReadRef& InAudio, FAxisArray&& InAxes)
+			: AudioInput(InAudio)
+			, Axes(MoveTemp(InAxes))
+			, AudioOutput(TDataWriteReferenceFactory<FAudioBuffer>::CreateAny(InSettings))
+			, Quality(FMSUtilsQuality::Get())
+		{
+			INC_DWORD_STAT(STAT_MSUtils_MultiCrossfadeByParamOperators);
+		}
+
+		virtual ~TMultiCBPOperator()
+		{
+			DEC_DWORD_STAT(STAT_MSUtils_MultiCrossfadeByParamOperators);
+		}
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace MultiCBPVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputAudio), AudioInput);
+
+			for (int32 i = 0; i < NumAxes; ++i)
+			{
+				FAxisInputs& Axis = Axes[i];
+				InOutVertexData.BindReadVertex(GetAxisInputName(i, EAxisInput::Value), Axis.Value);
+				InOutVertexData.BindReadVertex(GetAxisInputName(i, EAxisInput::UseEPCrossfade), Axis.bUseEPCrossfade);
+				InOutVertexData.BindReadVertex(GetAxisInputName(i, EAxisInput::FadeInStart), Axis.FadeInStart);
+				InOutVertexData.BindReadVertex(GetAxisInputName(i, EAxisInput::FadeInEnd), Axis.FadeInEnd);
+				InOutVertexData.BindReadVertex(GetAxisInputName(i, EAxisInput::FadeOutStart), Axis.FadeOutStart);
+				InOutVertexData.BindReadVertex(GetAxisInputName(i, EAxisInput::FadeOutEnd), Axis.FadeOutEnd);
+				InOutVertexData.BindReadVertex(GetAxisInputName(i, EAxisInput::Profile), Axis.Profile);
+			}
+		}
+
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace MultiCBPVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutputAudio), AudioOutput);
+		}
+
+		virtual FDataReferenceCollection GetInputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		virtual FDataReferenceCollection GetOutputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		void Reset(const IOperator::FResetParams& InParams)
+		{
+			bInit = false;
+			Amplitude = 0.f;
+			AmplitudePrev = 0.f;
+			AudioOutput->Zero();
+		}
+
+		void Execute()
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MSUtils_MultiCrossfadeByParamExecute);
+			MSUTILS_EXECUTE_SCOPE(TEXT("Multi Crossfade By Param"));
+
+			bool bChanged = false;
+			for (int32 i = 0; i < NumAxes; ++i)
+			{
+				const float Value = *Axes[i].Value;
+				const FCrossfadeProfileData* ProfileData = Axes[i].Profile->GetData();
+				if (!bInit || Value != PrevValues[i] || ProfileData != PrevProfiles[i])
+				{
+					AxisGains[i] = ProfileData ? ProfileData->GetGain(Value) : GetAxisGain(Axes[i]);
+					PrevValues[i] = Value;
+					PrevProfiles[i] = ProfileData;
+					bChanged = true;
+				}
+			}
+			bInit = true;
+
+			if (bChanged)
+			{
+				Amplitude = 1.f;
+				for (int32 i = 0; i < NumAxes; ++i)
+				{
+					Amplitude *= AxisGains[i];
+				}
+			}
+
+			// Copy and fade in one pass, whatever the number of axes
+			MSUtilsKernels::FadeCopy(*AudioInput, *AudioOutput, Quality.GetRampStartGain(AmplitudePrev, Amplitude), Amplitude);
+			AmplitudePrev = Amplitude;
+		}
+
+	private:
+		// Same mapping and gain law as Crossfade By Param
+		float GetAxisGain(const FAxisInputs& Axis) const
+		{
+			const float FadeInValue = FMath::GetMappedRangeValueClamped(FVector2D(*Axis.FadeInStart, *Axis.FadeInEnd), FVector2D(0.f, 1.f), *Axis.Value);
+			const float FadeOutValue = FMath::GetMappedRangeValueClamped(FVector2D(*Axis.FadeOutStart, *Axis.FadeOutEnd), FVector2D(1.f, 0.f), *Axis.Value);
+			if (*Axis.bUseEPCrossfade)
+			{
+				return Quality.EqualPowerGain(1.f - (FadeInValue * FadeOutValue));
+			}
+			return FadeInValue * FadeOutValue;
+		}
+
+		FAudioBufferReadRef AudioInput;
+		FAxisArray Axes;
+		TDataWriteReference<FAudioBuffer> AudioOutput;
+
+		FMSUtilsQuality Quality;
+
+		float PrevValues[NumAxes] = { };
+		const FCrossfadeProfileData* PrevProfiles[NumAxes] = { };
+		float AxisGains[NumAxes] = { };
+		float Amplitude = 0.f;
+		float AmplitudePrev = 0.f;
+		bool bInit = false;
+	};
+
+	template<int32 NumAxes>
+	class TMultiCBPNode : public FNodeFacade
+	{
+	public:
+		/**
+		 * Constructor used by the Metasound Frontend.
+		 */
+		TMultiCBPNode(const FNodeInitData& InInitData)
+			: FNodeFacade(InInitData.InstanceName, InInitData.InstanceID, TFacadeOperatorClass<TMultiCBPOperator<NumAxes>>())
+		{}
+
+		virtual ~TMultiCBPNode() = default;
+	};
+
+	REGISTER_MULTICBP_NODE(2);
+	REGISTER_MULTICBP_NODE(3);
+	REGISTER_MULTICBP_NODE(4);
+
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,551 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "OperatorCapture.h"
+#include "RenderThreadGuard.h"
+
+#include "Containers/Queue.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMSUtilsCapture, Log, All);
+
+static int32 MSUtilsCaptureEnabled = 0;
+static FAutoConsoleVariableRef CVarMSUtilsCaptureEnabled(
+	TEXT("au.MSUtils.Capture.Enabled"),
+	MSUtilsCaptureEnabled,
+	TEXT("Capture the inputs of crossfade and meter operators created from now on to Saved/Captures. 0: off (default), 1: on."),
+	ECVF_Default);
+
+static int32 MSUtilsCaptureAudio = 1;
+static FAutoConsoleVariableRef CVarMSUtilsCaptureAudio(
+	TEXT("au.MSUtils.Capture.Audio"),
+	MSUtilsCaptureAudio,
+	TEXT("Include input audio in new captures. 0: controls only, replayed against silence. 1: controls and audio (default)."),
+	ECVF_Default);
+
+static int32 MSUtilsCaptureQueueBlocks = 256;
+static FAutoConsoleVariableRef CVarMSUtilsCaptureQueueBlocks(
+	TEXT("au.MSUtils.Capture.QueueBlocks"),
+	MSUtilsCaptureQueueBlocks,
+	TEXT("Blocks each capture can queue before the writer drains them. Further blocks are dropped."),
+	ECVF_Default);
+
+static float MSUtilsCaptureWriteIntervalMs = 100.f;
+static FAutoConsoleVariableRef CVarMSUtilsCaptureWriteIntervalMs(
+	TEXT("au.MSUtils.Capture.WriteIntervalMs"),
+	MSUtilsCaptureWriteIntervalMs,
+	TEXT("Milliseconds between capture writes."),
+	ECVF_Default);
+
+static FAutoConsoleCommand CmdMSUtilsCaptureReplay(
+	TEXT("au.MSUtils.Capture.Replay"),
+	TEXT("Replays an operator capture through Execute and reports timings. Args: <CaptureFile> [Iterations] [-Out=<File>] [-Compare=<File>]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.Num() < 1)
+			{
+				UE_LOG(LogMSUtilsCapture, Display, TEXT("Usage: au.MSUtils.Capture.Replay <CaptureFile> [Iterations] [-Out=<File>] [-Compare=<File>]"));
+				return;
+			}
+
+			int32 NumIterations = 1;
+			FString OutputFilename;
+			FString CompareFilename;
+			for (int32 i = 1; i < Args.Num(); ++i)
+			{
+				if (!FParse::Value(*Args[i], TEXT("-Out="), OutputFilename) && !FParse::Value(*Args[i], TEXT("-Compare="), CompareFilename))
+				{
+					NumIterations = FMath::Max(FCString::Atoi(*Args[i]), 1);
+				}
+			}
+
+			Metasound::FOperatorCaptureReplay::Replay(Args[0], NumIterations, OutputFilename, CompareFilename);
+		}));
+
+namespace Metasound
+{
+	namespace OperatorCaptureFormat
+	{
+		static constexpr uint64 Magic = 0x3130504143555342ull; // "BSUCAP01"
+		// Bump whenever a capture's layout changes, including the controls an operator writes, so old captures are
+		// rejected instead of replayed into the wrong inputs. 2: EP Crossfade gained Master Gain, per-input trims and
+		// Loudness Compensation.
+		static constexpr uint32 Version = 2;
+
+		// Largest header values Replay accepts. Anything bigger is a corrupt file.
+		static constexpr int32 MaxNumFramesPerBlock = 1 << 16;
+		static constexpr float MaxSampleRate = 768000.f;
+
+		// Header: Magic, Version, OperatorType, InstanceName, SampleRate, NumFramesPerBlock, NumControls, NumAudioInputs,
+		// bCaptureAudio. Then per block: BlockIndex followed by the slot's floats.
+	}
+
+	//------------------------------------------------------------------------------------
+	// FOperatorCaptureWriter
+	//------------------------------------------------------------------------------------
+
+	// Owns one file per capture. New captures arrive through a lock-free queue and every ring is drained on this thread.
+	// A capture is closed once its operator has released it and the ring is empty.
+	class FOperatorCaptureWriter : public FRunnable
+	{
+	public:
+		FOperatorCaptureWriter()
+		{
+			Thread = FRunnableThread::Create(this, TEXT("MSUtilsCaptureWriter"), 0, TPri_BelowNormal);
+		}
+
+		virtual ~FOperatorCaptureWriter()
+		{
+			if (Thread)
+			{
+				Thread->Kill(true);
+				delete Thread;
+			}
+		}
+
+		void AddCapture(const FOperatorCapturePtr& Capture)
+		{
+			NewCaptures.Enqueue(Capture);
+		}
+
+		//~ Begin FRunnable Interface
+		virtual uint32 Run() override
+		{
+			while (!bStopping.load())
+			{
+				Drain();
+				FPlatformProcess::Sleep(FMath::Max(MSUtilsCaptureWriteIntervalMs, 1.f) * 0.001f);
+			}
+			Drain();
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopping.store(true);
+		}
+		//~ End FRunnable Interface
+
+	private:
+		struct FOpenCapture
+		{
+			FOperatorCapturePtr Capture;
+			TUniquePtr<FArchive> File;
+		};
+
+		void Drain()
+		{
+			FOperatorCapturePtr NewCapture;
+			while (NewCaptures.Dequeue(NewCapture))
+			{
+				FOpenCapture& Open = Captures.AddDefaulted_GetRef();
+				Open.Capture = MoveTemp(NewCapture);
+				Open.File = OpenFile(*Open.Capture);
+			}
+
+			for (int32 i = Captures.Num() - 1; i >= 0; --i)
+			{
+				FOperatorCapture& Capture = *Captures[i].Capture;
+				FArchive* File = Captures[i].File.Get();
+
+				// Checked before draining so the last blocks of a destroyed operator are not missed
+				const bool bClosed = Captures[i].Capture.IsUnique();
+
+				uint32 Read = Capture.ReadIndex.load(std::memory_order_relaxed);
+				const uint32 Write = Capture.WriteIndex.load(std::memory_order_acquire);
+				for (; Read != Write; ++Read)
+				{
+					if (File)
+					{
+						const int32 Slot = Read % Capture.NumSlots;
+						*File << Capture.SlotBlockIndices[Slot];
+						File->Serialize(&Capture.Slots[Slot * Capture.SlotSize], Capture.SlotSize * sizeof(float));
+					}
+				}
+				Capture.ReadIndex.store(Read, std::memory_order_release);
+
+				if (File)
+				{
+					File->Flush();
+				}
+
+				if (bClosed)
+				{
+					Captures.RemoveAtSwap(i);
+				}
+			}
+		}
+
+		TUniquePtr<FArchive> OpenFile(FOperatorCapture& Capture)
+		{
+			using namespace OperatorCaptureFormat;
+
+			const FString Filename = FPaths::ProjectSavedDir() / TEXT("Captures") / FPaths::MakeValidFileName(
+				FString::Printf(TEXT("%s_%s_%s"), *Capture.OperatorType.ToString(), *Capture.InstanceName, *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S-%s")))) + TEXT(".opcap");
+
+			TUniquePtr<FArchive> File(IFileManager::Get().CreateFileWriter(*Filename));
+			if (!File)
+			{
+				UE_LOG(LogMSUtilsCapture, Error, TEXT("Could not open '%s', capture discarded."), *Filename);
+				return nullptr;
+			}
+
+			uint64 FileMagic = Magic;
+			uint32 FileVersion = Version;
+			FString OperatorType = Capture.OperatorType.ToString();
+			uint8 bCaptureAudio = Capture.bCaptureAudio;
+			*File << FileMagic << FileVersion << OperatorType << Capture.InstanceName << Capture.SampleRate << Capture.NumFramesPerBlock
+				<< Capture.NumControls << Capture.NumAudioInputs << bCaptureAudio;
+
+			UE_LOG(LogMSUtilsCapture, Display, TEXT("Capturing '%s' to '%s'."), *Capture.InstanceName, *Filename);
+			return File;
+		}
+
+		FRunnableThread* Thread = nullptr;
+		std::atomic<bool> bStopping { false };
+
+		TQueue<FOperatorCapturePtr, EQueueMode::Mpsc> NewCaptures;
+		TArray<FOpenCapture> Captures;
+	};
+
+	namespace OperatorCapturePrivate
+	{
+		static FCriticalSection WriterLock;
+		static TUniquePtr<FOperatorCaptureWriter> Writer;
+
+		struct FReplayer
+		{
+			FCreateReplayOperator Create;
+			int32 NumControls = 0;
+			int32 NumAudioInputs = 0;
+		};
+
+		static TMap<FName, FReplayer>& GetReplayers()
+		{
+			static TMap<FName, FReplayer> Replayers;
+			return Replayers;
+		}
+	}
+
+	//------------------------------------------------------------------------------------
+	// FOperatorCapture
+	//------------------------------------------------------------------------------------
+
+	FOperatorCapturePtr FOperatorCapture::Open(FName OperatorType, const FString& InstanceName, const FOperatorSettings& InSettings, int32 InNumControls, int32 InNumAudioInputs)
+	{
+		using namespace OperatorCapturePrivate;
+
+		if (MSUtilsCaptureEnabled == 0)
+		{
+			return nullptr;
+		}
+
+		FOperatorCapturePtr Capture = MakeShared<FOperatorCapture, ESPMode::ThreadSafe>(OperatorType, InstanceName, InSettings,
+			InNumControls, InNumAudioInputs, MSUtilsCaptureAudio != 0, FMath::Max(MSUtilsCaptureQueueBlocks, 2));
+
+		// Only taken when an operator is created, never from Execute
+		MSUTILS_NOTE_LOCK(TEXT("OperatorCapture WriterLock"));
+		FScopeLock Lock(&WriterLock);
+		if (!Writer)
+		{
+			Writer = MakeUnique<FOperatorCaptureWriter>();
+		}
+		Writer->AddCapture(Capture);
+		return Capture;
+	}
+
+	void FOperatorCapture::Shutdown()
+	{
+		using namespace OperatorCapturePrivate;
+
+		MSUTILS_NOTE_LOCK(TEXT("OperatorCapture WriterLock"));
+		FScopeLock Lock(&WriterLock);
+		Writer.Reset();
+	}
+
+	FOperatorCapture::FOperatorCapture(FName InOperatorType, const FString& InInstanceName, const FOperatorSettings& InSettings, int32 InNumControls, int32 InNumAudioInputs, bool bInCaptureAudio, int32 InNumSlots)
+		: OperatorType(InOperatorType),
+		InstanceName(InInstanceName),
+		SampleRate(InSettings.GetSampleRate()),
+		NumFramesPerBlock(InSettings.GetNumFramesPerBlock()),
+		NumControls(InNumControls),
+		NumAudioInputs(InNumAudioInputs),
+		bCaptureAudio(bInCaptureAudio),
+		NumSlots(InNumSlots)
+	{
+		SlotSize = NumControls + (bCaptureAudio ? NumAudioInputs * NumFramesPerBlock : 0);
+		Slots.AddZeroed(NumSlots * SlotSize);
+		SlotBlockIndices.AddZeroed(NumSlots);
+	}
+
+	void FOperatorCapture::WriteBlock(TArrayView<const float> Controls, TArrayView<const FAudioBufferReadRef> AudioInputs)
+	{
+		const uint64 BlockIndex = NextBlockIndex++;
+
+		const uint32 Write = WriteIndex.load(std::memory_order_relaxed);
+		if (Write - ReadIndex.load(std::memory_order_acquire) >= (uint32)NumSlots)
+		{
+			return;
+		}
+
+		const int32 Slot = Write % NumSlots;
+		SlotBlockIndices[Slot] = BlockIndex;
+
+		float* SlotData = &Slots[Slot * SlotSize];
+		FMemory::Memcpy(SlotData, Controls.GetData(), FMath::Min(Controls.Num(), NumControls) * sizeof(float));
+
+		if (bCaptureAudio)
+		{
+			float* AudioData = SlotData + NumControls;
+			for (int32 i = 0; i < NumAudioInputs; ++i)
+			{
+				const FAudioBuffer& Buffer = *AudioInputs[i];
+				FMemory::Memcpy(AudioData + i * NumFramesPerBlock, Buffer.GetData(), FMath::Min(Buffer.Num(), NumFramesPerBlock) * sizeof(float));
+			}
+		}
+
+		WriteIndex.store(Write + 1, std::memory_order_release);
+	}
+
+	//------------------------------------------------------------------------------------
+	// FCaptureReplayContext
+	//------------------------------------------------------------------------------------
+
+	FCaptureReplayContext::FCaptureReplayContext(const FOperatorSettings& InSettings, int32 NumControls, int32 NumAudioInputs)
+		: Settings(InSettings)
+	{
+		ControlSetters.SetNum(NumControls);
+		for (int32 i = 0; i < NumAudioInputs; ++i)
+		{
+			AudioInputs.Add(FAudioBufferWriteRef::CreateNew(Settings));
+		}
+	}
+
+	FFloatReadRef FCaptureReplayContext::GetFloat(int32 ControlIndex)
+	{
+		FFloatWriteRef Value = FFloatWriteRef::CreateNew(0.f);
+		if (ControlSetters.IsValidIndex(ControlIndex))
+		{
+			ControlSetters[ControlIndex] = [Value](float Control) mutable { *Value = Control; };
+		}
+		return Value;
+	}
+
+	FBoolReadRef FCaptureReplayContext::GetBool(int32 ControlIndex)
+	{
+		FBoolWriteRef Value = FBoolWriteRef::CreateNew(false);
+		if (ControlSetters.IsValidIndex(ControlIndex))
+		{
+			ControlSetters[ControlIndex] = [Value](float Control) mutable { *Value = Control != 0.f; };
+		}
+		return Value;
+	}
+
+	FInt32ReadRef FCaptureReplayContext::GetInt32(int32 ControlIndex)
+	{
+		FInt32WriteRef Value = FInt32WriteRef::CreateNew(0);
+		if (ControlSetters.IsValidIndex(ControlIndex))
+		{
+			ControlSetters[ControlIndex] = [Value](float Control) mutable { *Value = FMath::RoundToInt(Control); };
+		}
+		return Value;
+	}
+
+	FAudioBufferReadRef FCaptureReplayContext::GetAudio(int32 AudioIndex)
+	{
+		if (AudioInputs.IsValidIndex(AudioIndex))
+		{
+			return AudioInputs[AudioIndex];
+		}
+		return FAudioBufferWriteRef::CreateNew(Settings);
+	}
+
+	void FCaptureReplayContext::SetBlock(const float* Controls, const float* Audio, int32 NumCapturedFrames)
+	{
+		for (int32 i = 0; i < ControlSetters.Num(); ++i)
+		{
+			if (ControlSetters[i])
+			{
+				ControlSetters[i](Controls[i]);
+			}
+		}
+
+		if (Audio)
+		{
+			for (int32 i = 0; i < AudioInputs.Num(); ++i)
+			{
+				FAudioBuffer& Buffer = *AudioInputs[i];
+				FMemory::Memcpy(Buffer.GetData(), Audio + i * NumCapturedFrames, FMath::Min(Buffer.Num(), NumCapturedFrames) * sizeof(float));
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------
+	// FOperatorCaptureReplay
+	//------------------------------------------------------------------------------------
+
+	FOperatorCaptureReplay::FOperatorCaptureReplay(FName OperatorType, int32 NumControls, int32 NumAudioInputs, FCreateReplayOperator&& InCreate)
+	{
+		OperatorCapturePrivate::GetReplayers().Add(OperatorType, { MoveTemp(InCreate), NumControls, NumAudioInputs });
+	}
+
+	TUniquePtr<IReplayOperator> FOperatorCaptureReplay::CreateOperator(FName OperatorType, FCaptureReplayContext& Context)
+	{
+		const OperatorCapturePrivate::FReplayer* Replayer = OperatorCapturePrivate::GetReplayers().Find(OperatorType);
+		return Replayer ? Replayer->Create(Context) : nullptr;
+	}
+
+	bool FOperatorCaptureReplay::Replay(const FString& CaptureFilename, int32 NumIterations, const FString& OutputFilename, const FString& CompareFilename)
+	{
+		using namespace OperatorCaptureFormat;
+
+		TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*CaptureFilename, FILEREAD_AllowWrite));
+		if (!Reader)
+		{
+			UE_LOG(LogMSUtilsCapture, Error, TEXT("Could not open '%s'."), *CaptureFilename);
+			return false;
+		}
+
+		uint64 FileMagic = 0;
+		uint32 FileVersion = 0;
+		*Reader << FileMagic << FileVersion;
+		if (FileMagic != Magic || FileVersion != Version)
+		{
+			UE_LOG(LogMSUtilsCapture, Error, TEXT("'%s' is not an operator capture."), *CaptureFilename);
+			return false;
+		}
+
+		FString OperatorType;
+		FString InstanceName;
+		float SampleRate = 0.f;
+		int32 NumFramesPerBlock = 0;
+		int32 NumControls = 0;
+		int32 NumAudioInputs = 0;
+		uint8 bCaptureAudio = 0;
+		*Reader << OperatorType << InstanceName << SampleRate << NumFramesPerBlock << NumControls << NumAudioInputs << bCaptureAudio;
+
+		const OperatorCapturePrivate::FReplayer* Replayer = OperatorCapturePrivate::GetReplayers().Find(*OperatorType);
+		if (!Replayer)
+		{
+			UE_LOG(LogMSUtilsCapture, Error, TEXT("No replayer for '%s' in '%s'."), *OperatorType, *CaptureFilename);
+			return false;
+		}
+
+		// The header sizes everything below, so a corrupt or stale one must not get further than this
+		if (!(SampleRate > 0.f && SampleRate <= MaxSampleRate) || NumFramesPerBlock <= 0 || NumFramesPerBlock > MaxNumFramesPerBlock)
+		{
+			UE_LOG(LogMSUtilsCapture, Error, TEXT("'%s' has an invalid sample rate (%f) or block size (%d)."), *CaptureFilename, SampleRate, NumFramesPerBlock);
+			return false;
+		}
+		if (NumControls != Replayer->NumControls || NumAudioInputs != Replayer->NumAudioInputs)
+		{
+			UE_LOG(LogMSUtilsCapture, Error, TEXT("'%s' has %d controls and %d audio inputs, but the %s replayer reads %d and %d."), *CaptureFilename,
+				NumControls, NumAudioInputs, *OperatorType, Replayer->NumControls, Replayer->NumAudioInputs);
+			return false;
+		}
+
+		// Load every block up front so file reads don't count towards the timings
+		const int32 SlotSize = NumControls + (bCaptureAudio ? NumAudioInputs * NumFramesPerBlock : 0);
+		TArray<float> Blocks;
+		int32 NumBlocks = 0;
+		uint64 NumDropped = 0;
+		uint64 ExpectedBlockIndex = 0;
+		while (Reader->TotalSize() - Reader->Tell() >= (int64)(sizeof(uint64) + SlotSize * sizeof(float)))
+		{
+			uint64 BlockIndex = 0;
+			*Reader << BlockIndex;
+			NumDropped += BlockIndex - ExpectedBlockIndex;
+			ExpectedBlockIndex = BlockIndex + 1;
+
+			Blocks.AddUninitialized(SlotSize);
+			Reader->Serialize(&Blocks[NumBlocks * SlotSize], SlotSize * sizeof(float));
+			++NumBlocks;
+		}
+
+		FCaptureReplayContext Context(FOperatorSettings(SampleRate, SampleRate / NumFramesPerBlock), NumControls, NumAudioInputs);
+		TUniquePtr<IReplayOperator> Operator = Replayer->Create(Context);
+		if (!Operator)
+		{
+			return false;
+		}
+
+		TArray<float> Output;
+		double SumOfSquares = 0.0;
+		uint64 TotalCycles = 0;
+		uint64 MaxCycles = 0;
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			for (int32 Block = 0; Block < NumBlocks; ++Block)
+			{
+				const float* BlockData = &Blocks[Block * SlotSize];
+				Context.SetBlock(BlockData, bCaptureAudio ? BlockData + NumControls : nullptr, NumFramesPerBlock);
+
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				Operator->Execute();
+				const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+				TotalCycles += Cycles;
+				MaxCycles = FMath::Max(MaxCycles, Cycles);
+
+				// Output is collected from the first pass only, later passes are for timing
+				if (Iteration == 0)
+				{
+					const FAudioBuffer& Buffer = Operator->GetAudioOutput();
+					Output.Append(Buffer.GetData(), Buffer.Num());
+					for (int32 i = 0; i < Buffer.Num(); ++i)
+					{
+						SumOfSquares += Buffer.GetData()[i] * Buffer.GetData()[i];
+					}
+				}
+			}
+		}
+
+		const int32 NumExecutes = FMath::Max(NumBlocks * NumIterations, 1);
+		const double TotalMs = FPlatformTime::ToMilliseconds64(TotalCycles);
+		const double AudioMs = 1000.0 * NumBlocks * NumIterations * NumFramesPerBlock / SampleRate;
+		UE_LOG(LogMSUtilsCapture, Display, TEXT("Replayed %s '%s': %d blocks x %d, %llu dropped in capture%s."),
+			*OperatorType, *InstanceName, NumBlocks, NumIterations, NumDropped, bCaptureAudio ? TEXT("") : TEXT(", silent audio"));
+		UE_LOG(LogMSUtilsCapture, Display, TEXT("Execute: total %.3f ms, mean %.3f us, max %.3f us, %.1fx real time. Output RMS %.6f."),
+			TotalMs, 1000.0 * TotalMs / NumExecutes, 1000.0 * FPlatformTime::ToMilliseconds64(MaxCycles), TotalMs > 0.0 ? AudioMs / TotalMs : 0.0,
+			FMath::Sqrt(SumOfSquares / FMath::Max(Output.Num(), 1)));
+
+		if (!OutputFilename.IsEmpty())
+		{
+			TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*OutputFilename));
+			if (Writer)
+			{
+				Writer->Serialize(Output.GetData(), Output.Num() * sizeof(float));
+				UE_LOG(LogMSUtilsCapture, Display, TEXT("Wrote output to '%s'."), *OutputFilename);
+			}
+		}
+
+		if (!CompareFilename.IsEmpty())
+		{
+			TArray<uint8> Reference;
+			if (!FFileHelper::LoadFileToArray(Reference, *CompareFilename))
+			{
+				UE_LOG(LogMSUtilsCapture, Error, TEXT("Could not read '%s'."), *CompareFilename);
+				return false;
+			}
+
+			const float* ReferenceSamples = reinterpret_cast<const float*>(Reference.GetData());
+			const int32 NumReferenceSamples = Reference.Num() / sizeof(float);
+			float MaxDifference = 0.f;
+			for (int32 i = 0; i < FMath::Min(NumReferenceSamples, Output.Num()); ++i)
+			{
+				MaxDifference = FMath::Max(MaxDifference, FMath::Abs(Output[i] - ReferenceSamples[i]));
+			}
+
+			UE_LOG(LogMSUtilsCapture, Display, TEXT("Compared with '%s': max difference %g (%.1f dB)%s."), *CompareFilename, MaxDifference,
+				20.f * FMath::LogX(10.f, FMath::Max(MaxDifference, 1e-9f)),
+				NumReferenceSamples != Output.Num() ? TEXT(", lengths differ") : TEXT(""));
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,221 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "SidechainDucker.h"
+#include "MS_Utils.h"
+#include "RenderThreadGuard.h"
+
+#include "MetasoundStandardNodesCategories.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_SidechainDucker"
+
+DECLARE_CYCLE_STAT(TEXT("Sidechain Ducker Execute"), STAT_MSUtils_SidechainDuckerExecute, STATGROUP_MSUtils);
+
+namespace Metasound
+{
+	//the below stores name and tooltip information for each input/output pin - Name and then description.
+
+	namespace DuckerNodeNames
+	{
+		METASOUND_PARAM(InAudioParam, "Audio In", "Audio to duck");
+		METASOUND_PARAM(InSidechainParam, "Sidechain", "Audio whose level drives the gain");
+		METASOUND_PARAM(InbUsePeak, "Use Peak", "Follow the sidechain peak level instead of its RMS level");
+		METASOUND_PARAM(InAttackMs, "Attack", "Envelope attack time in milliseconds");
+		METASOUND_PARAM(InReleaseMs, "Release", "Envelope release time in milliseconds");
+		METASOUND_PARAM(InbUseEPCrossfade, "Use EP Crossfade", "Use Equal Power Crossfade");
+		METASOUND_PARAM(InFadeInStart, "FadeInStart", "Sidechain level in dB where the fade in starts");
+		METASOUND_PARAM(InFadeInEnd, "FadeInEnd", "Sidechain level in dB where the fade in ends");
+		METASOUND_PARAM(InFadeOutStart, "FadeOutStart", "Sidechain level in dB where the fade out starts");
+		METASOUND_PARAM(InFadeOutEnd, "FadeOutEnd", "Sidechain level in dB where the fade out ends");
+		METASOUND_PARAM(OutAudioParam, "Audio Out", "Audio Output");
+	}
+
+	FDuckerOperator::FDuckerOperator(const FOperatorSettings& InSettings,
+		const FAudioBufferReadRef& InAudio,
+		const FAudioBufferReadRef& InSidechain,
+		const FBoolReadRef& bUsePeakIn,
+		const FFloatReadRef& AttackMsIn,
+		const FFloatReadRef& ReleaseMsIn,
+		const FBoolReadRef& bUseEPCrossfadeIn,
+		const FFloatReadRef& FadeInStartIn,
+		const FFloatReadRef& FadeInEndIn,
+		const FFloatReadRef& FadeOutStartIn,
+		const FFloatReadRef& FadeOutEndIn)
+		: AudioInput(InAudio),
+		SidechainInput(InSidechain),
+		bUsePeak(bUsePeakIn),
+		AttackMs(AttackMsIn),
+		ReleaseMs(ReleaseMsIn),
+		bUseEPCrossfade(bUseEPCrossfadeIn),
+		FadeInStart(FadeInStartIn),
+		FadeInEnd(FadeInEndIn),
+		FadeOutStart(FadeOutStartIn),
+		FadeOutEnd(FadeOutEndIn),
+		AudioOutput(FAudioBufferWriteRef::CreateNew(InSettings)),
+		SampleRate(InSettings.GetSampleRate()),
+		Quality(FMSUtilsQuality::Get())
+	{
+		GainPrev = GetTargetGain();
+	};
+
+	float FDuckerOperator::GetTargetGain() const
+	{
+		// Peak follows |x|, RMS follows x^2
+		const float LevelDb = *bUsePeak
+			? 20.f * FMath::LogX(10.f, FMath::Max(Envelope, 1e-6f))
+			: 10.f * FMath::LogX(10.f, FMath::Max(Envelope, 1e-12f));
+
+		float FadeInValue = FMath::GetMappedRangeValueClamped(FVector2D(*FadeInStart, *FadeInEnd), FVector2D(0.f, 1.f), LevelDb);
+		float FadeOutValue = FMath::GetMappedRangeValueClamped(FVector2D(*FadeOutStart, *FadeOutEnd), FVector2D(1.f, 0.f), LevelDb);
+		if (*bUseEPCrossfade)
+		{
+			return Quality.EqualPowerGain(1.f - (FadeInValue * FadeOutValue));
+		}
+		return FadeInValue * FadeOutValue;
+	}
+
+	void FDuckerOperator::Execute()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_MSUtils_SidechainDuckerExecute);
+		MSUTILS_EXECUTE_SCOPE(TEXT("Sidechain Ducker"));
+
+		// One-pole coefficients only change with their inputs
+		if (*AttackMs != AttackMsPrev)
+		{
+			AttackMsPrev = *AttackMs;
+			AttackCoeff = FMath::Exp(-1000.f / (FMath::Max(AttackMsPrev, 0.01f) * SampleRate));
+		}
+		if (*ReleaseMs != ReleaseMsPrev)
+		{
+			ReleaseMsPrev = *ReleaseMs;
+			ReleaseCoeff = FMath::Exp(-1000.f / (FMath::Max(ReleaseMsPrev, 0.01f) * SampleRate));
+		}
+
+		// The gain ramps toward the level measured up to the end of the previous block, so the envelope can be
+		// followed and the gain applied in the same pass over the audio.
+		const float Gain = GetTargetGain();
+		const float StartGain = Quality.GetRampStartGain(GainPrev, Gain);
+
+		const int32 NumFrames = AudioInput->Num();
+		const float* InData = AudioInput->GetData();
+		const float* SidechainData = SidechainInput->GetData();
+		float* OutData = AudioOutput->GetData();
+
+		// Same ramp as Audio::ArrayFade: sample i gets StartGain + i * (Gain - StartGain) / NumFrames
+		const float Delta = NumFrames > 0 ? (Gain - StartGain) / NumFrames : 0.f;
+		const bool bPeak = *bUsePeak;
+		float Env = Envelope;
+
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			const float Detector = bPeak ? FMath::Abs(SidechainData[i]) : SidechainData[i] * SidechainData[i];
+			const float Coeff = Detector > Env ? AttackCoeff : ReleaseCoeff;
+			Env = Detector + Coeff * (Env - Detector);
+
+			OutData[i] = InData[i] * (StartGain + i * Delta);
+		}
+
+		Envelope = Env;
+		GainPrev = Gain;
+	}
+
+	const FVertexInterface& FDuckerOperator::DeclareVertexInterface()
+	{
+		using namespace DuckerNodeNames;
+
+		static const FVertexInterface Interface(
+			FInputVertexInterface(
+				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam)),
+				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InSidechainParam)),
+				TInputDataVertexModel<bool>(METASOUND_GET_PARAM_NAME_AND_METADATA(InbUsePeak), false),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAttackMs), 10.f),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InReleaseMs), 250.f),
+				TInputDataVertexModel<bool>(METASOUND_GET_PARAM_NAME_AND_METADATA(InbUseEPCrossfade), false),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFadeInStart), -200.f),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFadeInEnd), -200.f),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFadeOutStart), -40.f),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFadeOutEnd), -10.f)
+			),
+			FOutputVertexInterface(
+				TOutputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutAudioParam))
+			)
+		);
+
+		return Interface;
+	};
+
+	const FNodeClassMetadata& FDuckerOperator::GetNodeInfo()
+	{
+		auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+			{
+				FVertexInterface NodeInterface = DeclareVertexInterface();
+
+				FNodeClassMetadata Metadata
+				{
+						{ TEXT("UE"), TEXT("SidechainDucker"), TEXT("Audio") },
+						1, // Major Version
+						0, // Minor Version
+						METASOUND_LOCTEXT("DuckerDisplayName", "Sidechain Ducker (Mono)"),
+						METASOUND_LOCTEXT("DuckerNodeDesc", "Fades a single audio channel by the level of a sidechain, mapped through fade in and fade out ranges like Crossfade By Param"),
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Dynamics },
+						{ },
+						FNodeDisplayStyle{}
+				};
+
+				return Metadata;
+			};
+
+		static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+		return Metadata;
+	};
+
+	void FDuckerOperator::BindInputs(FInputVertexInterfaceData& InOutVertexData)
+	{
+		using namespace DuckerNodeNames;
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InAudioParam), AudioInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InSidechainParam), SidechainInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InbUsePeak), bUsePeak);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InAttackMs), AttackMs);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InReleaseMs), ReleaseMs);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InbUseEPCrossfade), bUseEPCrossfade);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFadeInStart), FadeInStart);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFadeInEnd), FadeInEnd);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFadeOutStart), FadeOutStart);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFadeOutEnd), FadeOutEnd);
+	}
+
+	void FDuckerOperator::BindOutputs(FOutputVertexInterfaceData& InOutVertexData)
+	{
+		using namespace DuckerNodeNames;
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutAudioParam), AudioOutput);
+	}
+
+	TUniquePtr<IOperator> FDuckerOperator::CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors)
+	{
+		using namespace DuckerNodeNames;
+
+		const Metasound::FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+		const Metasound::FInputVertexInterface& InputInterface = DeclareVertexInterface().GetInputInterface();
+
+		FAudioBufferReadRef AudioIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InAudioParam), InParams.OperatorSettings);
+		FAudioBufferReadRef SidechainIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InSidechainParam), InParams.OperatorSettings);
+		TDataReadReference<bool> UsePeak = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<bool>(InputInterface, METASOUND_GET_PARAM_NAME(InbUsePeak), InParams.OperatorSettings);
+		TDataReadReference<float> Attack = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InAttackMs), InParams.OperatorSettings);
+		TDataReadReference<float> Release = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InReleaseMs), InParams.OperatorSettings);
+		TDataReadReference<bool> UseEP = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<bool>(InputInterface, METASOUND_GET_PARAM_NAME(InbUseEPCrossfade), InParams.OperatorSettings);
+		TDataReadReference<float> FadeInStartFloat = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InFadeInStart), InParams.OperatorSettings);
+		TDataReadReference<float> FadeInEndFloat = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InFadeInEnd), InParams.OperatorSettings);
+		TDataReadReference<float> FadeOutStartFloat = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InFadeOutStart), InParams.OperatorSettings);
+		TDataReadReference<float> FadeOutEndFloat = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InFadeOutEnd), InParams.OperatorSettings);
+
+		//this class is FDuckerOperator, which inherits from TExecutableOperator, which inherits from IOperator. IOperator type is returned
+		return MakeUnique<FDuckerOperator>(InParams.OperatorSettings, AudioIn, SidechainIn, UsePeak, Attack, Release, UseEP, FadeInStartFloat, FadeInEndFloat, FadeOutStartFloat, FadeOutEndFloat);
+	}
+
+	// Register node
+	METASOUND_REGISTER_NODE(FDuckerNode);
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,365 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "MS_Utils.h"
+#include "MSUtilsKernels.h"
+#include "MSUtilsQuality.h"
+#include "MSUtilsVertexNames.h"
+#include "RenderThreadGuard.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundAudioBuffer.h"
+#include "CoreMinimal.h"
+#include "Internationalization/Text.h"
+#include "MetasoundExecutableOperator.h"
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundStandardNodesCategories.h"
+#include "MetasoundStandardNodesNames.h"
+#include "MetasoundTime.h"
+#include "MetasoundTrigger.h"
+#include "MetasoundVertex.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_TimedCrossfade"
+
+DECLARE_CYCLE_STAT(TEXT("EP Timed Crossfade Execute"), STAT_MSUtils_TimedCrossfadeExecute, STATGROUP_MSUtils);
+
+#define REGISTER_TIMEDCROSSFADE_NODE(Number) \
+	using FTimedCrossfadeNode##Number = TTimedCrossfadeNode<Number>; \
+	METASOUND_REGISTER_NODE(FTimedCrossfadeNode##Number) \
+
+
+namespace Metasound
+{
+	namespace TimedXFVertexNames
+	{
+		METASOUND_PARAM(InputStart, "Start", "Starts a crossfade from the current mix to the target input.")
+		METASOUND_PARAM(InputTarget, "Target", "Index of the input to crossfade to. Read when Start triggers.")
+		METASOUND_PARAM(InputDuration, "Duration", "Length of the crossfade. Read when Start triggers.")
+		METASOUND_PARAM(OutputAudio, "Out", "Output audio.")
+		METASOUND_PARAM(OutputDone, "Done", "Triggers on the frame the crossfade reaches the target.")
+
+		constexpr int32 MaxNumInputs = 8;
+
+		const FVertexName& GetInputName(int32 InIndex)
+		{
+			static const TArray<FVertexName> InputNames = MSUtilsVertexNames::MakeNames(TEXT("In {0}"), MaxNumInputs);
+
+			check(InIndex < MaxNumInputs);
+			return InputNames[InIndex];
+		}
+
+		const FDataVertexMetadata& GetInputMetadata(int32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> InputMetadata = MSUtilsVertexNames::MakeMetadata(MaxNumInputs, [](int32 i) -> FDataVertexMetadata
+				{
+					return { METASOUND_LOCTEXT_FORMAT("TimedXFInputDesc", "Crossfade {0} input.", i), METASOUND_LOCTEXT_FORMAT("TimedXFInputDisplayName", "In {0}", i) };
+				});
+
+			check(InIndex < MaxNumInputs);
+			return InputMetadata[InIndex];
+		}
+	}
+
+	template<int32 NumInputs>
+	class TTimedXFOperator : public TExecutableOperator<TTimedXFOperator<NumInputs>>
+	{
+		static_assert(NumInputs <= TimedXFVertexNames::MaxNumInputs, "TimedXFVertexNames::MaxNumInputs must cover every registered input count");
+
+	public:
+		using FInputArray = TArray<FAudioBufferReadRef, TInlineAllocator<NumInputs>>;
+
+		static const FVertexInterface& GetVertexInterface()
+		{
+			using namespace TimedXFVertexNames;
+
+			auto CreateDefaultInterface = []() -> FVertexInterface
+				{
+					FInputVertexInterface InputInterface;
+
+					InputInterface.Add(TInputDataVertex<FTrigger>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputStart)));
+					InputInterface.Add(TInputDataVertex<int32>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputTarget), 0));
+					InputInterface.Add(TInputDataVertex<FTime>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputDuration), 1.0f));
+
+					for (int32 i = 0; i < NumInputs; ++i)
+					{
+						InputInterface.Add(TInputDataVertex<FAudioBuffer>(GetInputName(i), GetInputMetadata(i)));
+					}
+
+					FOutputVertexInterface OutputInterface;
+					OutputInterface.Add(TOutputDataVertex<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutputAudio)));
+					OutputInterface.Add(TOutputDataVertex<FTrigger>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutputDone)));
+
+					return FVertexInterface(InputInterface, OutputInterface);
+				};
+
+			static const FVertexInterface DefaultInterface = CreateDefaultInterface();
+			return DefaultInterface;
+		}
+
+		static const FNodeClassMetadata& GetNodeInfo()
+		{
+			auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+				{
+					FName DataTypeName = GetMetasoundDataTypeName<FAudioBuffer>();
+					FName OperatorName = *FString::Printf(TEXT("EP Timed Crossfade (%d)"), NumInputs);
+					FText NodeDisplayName = METASOUND_LOCTEXT_FORMAT("TimedXFDisplayNamePattern", "EP Timed Crossfade ({0})", NumInputs);
+					const FText NodeDescription = METASOUND_LOCTEXT("TimedXFDescription", "On Start, crossfades by equal power to the target input over the given duration, then triggers Done.");
+					FVertexInterface NodeInterface = GetVertexInterface();
+
+					FNodeClassMetadata Metadata
+					{
+						FNodeClassName { "EPTimedXF", OperatorName, DataTypeName },
+						1, // Major Version
+						0, // Minor Version
+						NodeDisplayName,
+						NodeDescription,
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Envelopes },
+						{ },
+						FNodeDisplayStyle()
+					};
+					return Metadata;
+				};
+
+			static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+			return Metadata;
+		}
+
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, TArray<TUniquePtr<IOperatorBuildError>>& OutErrors)
+		{
+			using namespace TimedXFVertexNames;
+
+			const FInputVertexInterface& InputInterface = InParams.Node.GetVertexInterface().GetInputInterface();
+			const FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+
+			FTriggerReadRef Start = InputCollection.GetDataReadReferenceOrConstruct<FTrigger>(METASOUND_GET_PARAM_NAME(InputStart), InParams.OperatorSettings);
+			FInt32ReadRef Target = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<int32>(InputInterface, METASOUND_GET_PARAM_NAME(InputTarget), InParams.OperatorSettings);
+			FTimeReadRef Duration = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FTime>(InputInterface, METASOUND_GET_PARAM_NAME(InputDuration), InParams.OperatorSettings);
+
+			FInputArray InputValues;
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InputValues.Add(InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, GetInputName(i), InParams.OperatorSettings));
+			}
+
+			return MakeUnique<TTimedXFOperator<NumInputs>>(InParams.OperatorSettings, Start, Target, Duration, MoveTemp(InputValues));
+		}
+
+		TTimedXFOperator(const FOperatorSettings& InSettings, const FTriggerReadRef& InStart, const FInt32ReadRef& InTarget, const FTimeReadRef& InDuration, FInputArray&& InInputValues)
+			: StartTrigger(InStart)
+			, Target(InTarget)
+			, Duration(InDuration)
+			, InputValues(MoveTemp(InInputValues))
+			, OutputValue(TDataWriteReferenceFactory<FAudioBuffer>::CreateAny(InSettings))
+			, DoneTrigger(FTriggerWriteRef::CreateNew(InSettings))
+			, SampleRate(InSettings.GetSampleRate())
+			, Quality(FMSUtilsQuality::Get())
+		{
+			// Start settled on the initial target
+			TargetIndex = FMath::Clamp(*Target, 0, NumInputs - 1);
+			FromGains[TargetIndex] = 1.f;
+		}
+
+		virtual ~TTimedXFOperator() = default;
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace TimedXFVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputStart), StartTrigger);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputTarget), Target);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputDuration), Duration);
+
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InOutVertexData.BindReadVertex(GetInputName(i), InputValues[i]);
+			}
+		}
+
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace TimedXFVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutputAudio), OutputValue);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutputDone), DoneTrigger);
+		}
+
+		virtual FDataReferenceCollection GetInputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		virtual FDataReferenceCollection GetOutputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		void Reset(const IOperator::FResetParams& InParams)
+		{
+			DoneTrigger->Reset();
+			FMemory::Memzero(FromGains, sizeof(FromGains));
+			TargetIndex = FMath::Clamp(*Target, 0, NumInputs - 1);
+			FromGains[TargetIndex] = 1.f;
+			Progress = 1.f;
+			OutputValue->Zero();
+		}
+
+		void Execute()
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MSUtils_TimedCrossfadeExecute);
+			MSUTILS_EXECUTE_SCOPE(TEXT("EP Timed Crossfade"));
+
+			DoneTrigger->AdvanceBlock();
+			OutputValue->Zero();
+
+			// Render up to each Start trigger, then begin the new crossfade on the trigger's frame
+			StartTrigger->ExecuteBlock(
+				[this](int32 StartFrame, int32 EndFrame)
+				{
+					RenderFrames(StartFrame, EndFrame);
+				},
+				[this](int32 StartFrame, int32 EndFrame)
+				{
+					BeginCrossfade(StartFrame);
+					RenderFrames(StartFrame, EndFrame);
+				}
+			);
+		}
+
+	private:
+		bool IsFading() const
+		{
+			return Progress < 1.f;
+		}
+
+		// Gain of input i at crossfade progress P. Inputs in the starting mix fade out by cos, and the target rises so the
+		// summed power stays at 1, even when a new Start interrupts a crossfade already in progress.
+		float GetGain(int32 InputIndex, float P) const
+		{
+			const float FadeOut = Quality.EqualPowerGain(P);
+			if (InputIndex == TargetIndex)
+			{
+				const float FadeIn = Quality.EqualPowerGain(1.f - P);
+				return FMath::Sqrt(FMath::Square(FromGains[InputIndex] * FadeOut) + FMath::Square(FadeIn));
+			}
+			return FMath::Max(FromGains[InputIndex] * FadeOut, 0.f);
+		}
+
+		void BeginCrossfade(int32 Frame)
+		{
+			// The mix at this frame becomes the starting point of the new crossfade
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				FromGains[i] = GetGain(i, Progress);
+			}
+
+			TargetIndex = FMath::Clamp(*Target, 0, NumInputs - 1);
+
+			const float DurationSamples = FMath::Max(0.f, (float)Duration->GetSeconds()) * SampleRate;
+			if (DurationSamples < 1.f)
+			{
+				// Zero length: settle immediately
+				SettleOnTarget(Frame);
+			}
+			else
+			{
+				Progress = 0.f;
+				ProgressPerFrame = 1.f / DurationSamples;
+			}
+		}
+
+		void SettleOnTarget(int32 Frame)
+		{
+			FMemory::Memzero(FromGains, sizeof(FromGains));
+			FromGains[TargetIndex] = 1.f;
+			Progress = 1.f;
+			DoneTrigger->TriggerFrame(Frame);
+		}
+
+		void RenderFrames(int32 StartFrame, int32 EndFrame)
+		{
+			while (StartFrame < EndFrame)
+			{
+				int32 NumFrames = EndFrame - StartFrame;
+				if (IsFading())
+				{
+					// Stop this segment where the crossfade ends so Done lands on the exact frame
+					const int32 FramesLeft = FMath::CeilToInt((1.f - Progress) / ProgressPerFrame);
+					NumFrames = FMath::Min(NumFrames, FMath::Max(FramesLeft, 1));
+				}
+
+				const float StartProgress = Progress;
+				const float EndProgress = IsFading() ? FMath::Min(Progress + NumFrames * ProgressPerFrame, 1.f) : Progress;
+
+				// Gains are evaluated at the segment ends and ramped linearly in between, like the other crossfades here
+				TArrayView<float> OutView(OutputValue->GetData() + StartFrame, NumFrames);
+				for (int32 i = 0; i < NumInputs; ++i)
+				{
+					const float StartGain = GetGain(i, StartProgress);
+					const float EndGain = GetGain(i, EndProgress);
+					if (StartGain > 0.f || EndGain > 0.f)
+					{
+						TArrayView<const float> InView(InputValues[i]->GetData() + StartFrame, NumFrames);
+						MSUtilsKernels::MixIn(InView, OutView, Quality.GetRampStartGain(StartGain, EndGain), EndGain);
+					}
+				}
+
+				StartFrame += NumFrames;
+
+				if (IsFading())
+				{
+					Progress = EndProgress;
+					if (Progress >= 1.f)
+					{
+						SettleOnTarget(StartFrame - 1);
+					}
+				}
+			}
+		}
+
+		FTriggerReadRef StartTrigger;
+		FInt32ReadRef Target;
+		FTimeReadRef Duration;
+		FInputArray InputValues;
+		TDataWriteReference<FAudioBuffer> OutputValue;
+		FTriggerWriteRef DoneTrigger;
+
+		float SampleRate = 0.f;
+		FMSUtilsQuality Quality;
+		float FromGains[NumInputs] = { };
+		int32 TargetIndex = 0;
+		float Progress = 1.f;
+		float ProgressPerFrame = 0.f;
+	};
+
+	template<int32 NumInputs>
+	class TTimedCrossfadeNode : public FNodeFacade
+	{
+	public:
+		/**
+		 * Constructor used by the Metasound Frontend.
+		 */
+		TTimedCrossfadeNode(const FNodeInitData& InInitData)
+			: FNodeFacade(InInitData.InstanceName, InInitData.InstanceID, TFacadeOperatorClass<TTimedXFOperator<NumInputs>>())
+		{}
+
+		virtual ~TTimedCrossfadeNode() = default;
+	};
+
+	REGISTER_TIMEDCROSSFADE_NODE(2);
+	REGISTER_TIMEDCROSSFADE_NODE(3);
+	REGISTER_TIMEDCROSSFADE_NODE(4);
+	REGISTER_TIMEDCROSSFADE_NODE(5);
+	REGISTER_TIMEDCROSSFADE_NODE(6);
+	REGISTER_TIMEDCROSSFADE_NODE(7);
+	REGISTER_TIMEDCROSSFADE_NODE(8);
+
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,422 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "MS_Utils.h"
+#include "MSUtilsKernels.h"
+#include "MSUtilsQuality.h"
+#include "RenderThreadGuard.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundAudioBuffer.h"
+#include "CoreMinimal.h"
+#include "Algo/Sort.h"
+#include "Internationalization/Text.h"
+#include "MetasoundExecutableOperator.h"
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundStandardNodesCategories.h"
+#include "MetasoundStandardNodesNames.h"
+#include "MetasoundVertex.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_VectorCrossfade"
+
+DECLARE_CYCLE_STAT(TEXT("EP Vector Crossfade Execute"), STAT_MSUtils_VectorCrossfadeExecute, STATGROUP_MSUtils);
+
+#define REGISTER_VECTORCROSSFADE_NODE(Columns, Rows) \
+	using FVectorCrossfadeNode##Columns##x##Rows = TVectorCrossfadeNode<Columns, Rows>; \
+	METASOUND_REGISTER_NODE(FVectorCrossfadeNode##Columns##x##Rows) \
+
+
+namespace Metasound
+{
+	namespace VectorXFVertexNames
+	{
+		METASOUND_PARAM(InputX, "X", "Column position, from 0 to Columns - 1. Fractional values crossfade between neighbouring columns.")
+		METASOUND_PARAM(InputY, "Y", "Row position, from 0 to Rows - 1. Fractional values crossfade between neighbouring rows.")
+		METASOUND_PARAM(OutputAudio, "Out", "Output audio.")
+
+		// Input names depend on the grid width, so each width gets its own table, built once on first use.
+		template<int32 Columns, int32 Rows>
+		const FVertexName& GetInputName(int32 InIndex)
+		{
+			static const TArray<FVertexName> InputNames = []()
+				{
+					TArray<FVertexName> Names;
+					Names.Reserve(Columns * Rows);
+					for (int32 i = 0; i < Columns * Rows; ++i)
+					{
+						Names.Add(*FString::Format(TEXT("In {0},{1}"), { i % Columns, i / Columns }));
+					}
+					return Names;
+				}();
+
+			return InputNames[InIndex];
+		}
+
+		template<int32 Columns, int32 Rows>
+		const FDataVertexMetadata& GetInputMetadata(int32 InIndex)
+		{
+			static const TArray<FDataVertexMetadata> InputMetadata = []()
+				{
+					TArray<FDataVertexMetadata> Metadata;
+					Metadata.Reserve(Columns * Rows);
+					for (int32 i = 0; i < Columns * Rows; ++i)
+					{
+						Metadata.Add({
+							METASOUND_LOCTEXT_FORMAT("VectorXFInputDesc", "Input at column {0}, row {1}.", i % Columns, i / Columns),
+							METASOUND_LOCTEXT_FORMAT("VectorXFInputDisplayName", "In {0},{1}", i % Columns, i / Columns) });
+					}
+					return Metadata;
+				}();
+
+			return InputMetadata[InIndex];
+		}
+	}
+
+	class FVectorXFHelper
+	{
+	public:
+		FVectorXFHelper(int32 InNumColumns, int32 InNumRows, const FMSUtilsQuality& InQuality)
+			: NumColumns(InNumColumns), NumRows(InNumRows), Quality(InQuality)
+		{
+		}
+
+		// Finds the (at most) four cells around X/Y and their bilinear equal-power gains. Only called when the position changes.
+		void SetPosition(float X, float Y)
+		{
+			// Each axis splits like an EP Crossfade position
+			int32 Column0, Column1, Row0, Row1;
+			float AlphaX, AlphaY;
+			FMSUtilsQuality::SplitPosition(X, NumColumns, Column0, Column1, AlphaX);
+			FMSUtilsQuality::SplitPosition(Y, NumRows, Row0, Row1, AlphaY);
+
+			// Equal power along each axis, so the product keeps the sum of squared gains at 1
+			float GainX0, GainX1, GainY0, GainY1;
+			Quality.GetPairGains(AlphaX, GainX0, GainX1);
+			Quality.GetPairGains(AlphaY, GainY0, GainY1);
+
+			NumCurrent = 0;
+			AddCorner(Row0 * NumColumns + Column0, GainX0 * GainY0);
+			AddCorner(Row0 * NumColumns + Column1, GainX1 * GainY0);
+			AddCorner(Row1 * NumColumns + Column0, GainX0 * GainY1);
+			AddCorner(Row1 * NumColumns + Column1, GainX1 * GainY1);
+
+			if (Quality.bTwoInputFallback)
+			{
+				KeepTwoLoudestCorners();
+			}
+
+			bEntriesDirty = true;
+		}
+
+		void GetCrossfadeOutput(TArrayView<const FAudioBufferReadRef> InAudioBuffersValues, FAudioBuffer& OutAudioBuffer)
+		{
+			if (bEntriesDirty)
+			{
+				RebuildEntries();
+			}
+
+			// Zero the output buffer so we can mix into it
+			OutAudioBuffer.Zero();
+			TArrayView<float> OutAudioBufferView(OutAudioBuffer.GetData(), OutAudioBuffer.Num());
+
+			for (int32 i = 0; i < NumEntries; ++i)
+			{
+				const FMixEntry& Entry = Entries[i];
+				const FAudioBuffer& InBuff = *InAudioBuffersValues[Entry.Index];
+				MSUtilsKernels::MixIn(TArrayView<const float>(InBuff.GetData(), InBuff.Num()), OutAudioBufferView, Entry.StartGain, Entry.EndGain);
+			}
+
+			FMemory::Memcpy(Previous, Current, sizeof(Current));
+			NumPrevious = NumCurrent;
+
+			// Ramps complete within the block. Rebuild next block so cells that faded out are dropped.
+			if (bRamping)
+			{
+				bEntriesDirty = true;
+			}
+		}
+
+	private:
+		struct FCorner
+		{
+			int32 Index;
+			float Gain;
+		};
+
+		struct FMixEntry
+		{
+			int32 Index;
+			float StartGain;
+			float EndGain;
+		};
+
+		void AddCorner(int32 InIndex, float InGain)
+		{
+			if (InGain > 0.f)
+			{
+				Current[NumCurrent++] = { InIndex, InGain };
+			}
+		}
+
+		// Drops all but the two loudest corners and rescales those two back to unit power
+		void KeepTwoLoudestCorners()
+		{
+			if (NumCurrent <= 2)
+			{
+				return;
+			}
+
+			Algo::Sort(MakeArrayView(Current, NumCurrent), [](const FCorner& A, const FCorner& B) { return A.Gain > B.Gain; });
+			NumCurrent = 2;
+
+			const float Scale = FMath::InvSqrt(FMath::Square(Current[0].Gain) + FMath::Square(Current[1].Gain));
+			Current[0].Gain *= Scale;
+			Current[1].Gain *= Scale;
+		}
+
+		// Pairs current corners with previous ones so each contributing input gets a single ramped mix.
+		// At most eight entries: four fading in or holding, four fading out.
+		void RebuildEntries()
+		{
+			NumEntries = 0;
+			bRamping = false;
+
+			for (int32 i = 0; i < NumCurrent; ++i)
+			{
+				float StartGain = 0.f;
+				for (int32 j = 0; j < NumPrevious; ++j)
+				{
+					if (Previous[j].Index == Current[i].Index)
+					{
+						StartGain = Previous[j].Gain;
+						break;
+					}
+				}
+				Entries[NumEntries++] = { Current[i].Index, Quality.GetRampStartGain(StartGain, Current[i].Gain), Current[i].Gain };
+				bRamping |= StartGain != Current[i].Gain;
+			}
+
+			for (int32 j = 0; j < NumPrevious; ++j)
+			{
+				bool bStillActive = false;
+				for (int32 i = 0; i < NumCurrent; ++i)
+				{
+					bStillActive |= Previous[j].Index == Current[i].Index;
+				}
+
+				// Outgoing cells ramp to 0 over one block and are dropped on the next rebuild. Per-block ramps step
+				// straight to 0 instead.
+				if (!bStillActive && !Quality.bPerBlockRamps)
+				{
+					Entries[NumEntries++] = { Previous[j].Index, Previous[j].Gain, 0.f };
+					bRamping = true;
+				}
+			}
+
+			bEntriesDirty = false;
+		}
+
+		int32 NumColumns = 0;
+		int32 NumRows = 0;
+		FMSUtilsQuality Quality;
+		FCorner Current[4];
+		FCorner Previous[4];
+		FMixEntry Entries[8];
+		int32 NumCurrent = 0;
+		int32 NumPrevious = 0;
+		int32 NumEntries = 0;
+		bool bEntriesDirty = false;
+		bool bRamping = false;
+	};
+
+	template<int32 Columns, int32 Rows>
+	class TVectorXFOperator : public TExecutableOperator<TVectorXFOperator<Columns, Rows>>
+	{
+	public:
+		static constexpr int32 NumInputs = Columns * Rows;
+		using FInputArray = TArray<FAudioBufferReadRef, TInlineAllocator<NumInputs>>;
+
+		static const FVertexInterface& GetVertexInterface()
+		{
+			using namespace VectorXFVertexNames;
+
+			auto CreateDefaultInterface = []() -> FVertexInterface
+				{
+					FInputVertexInterface InputInterface;
+
+					InputInterface.Add(TInputDataVertex<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputX)));
+					InputInterface.Add(TInputDataVertex<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InputY)));
+
+					for (int32 i = 0; i < NumInputs; ++i)
+					{
+						InputInterface.Add(TInputDataVertex<FAudioBuffer>(GetInputName<Columns, Rows>(i), GetInputMetadata<Columns, Rows>(i)));
+					}
+
+					FOutputVertexInterface OutputInterface;
+					OutputInterface.Add(TOutputDataVertex<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutputAudio)));
+
+					return FVertexInterface(InputInterface, OutputInterface);
+				};
+
+			static const FVertexInterface DefaultInterface = CreateDefaultInterface();
+			return DefaultInterface;
+		}
+
+		static const FNodeClassMetadata& GetNodeInfo()
+		{
+			auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+				{
+					FName DataTypeName = GetMetasoundDataTypeName<FAudioBuffer>();
+					FName OperatorName = *FString::Printf(TEXT("EP Vector Crossfade (%d x %d)"), Columns, Rows);
+					FText NodeDisplayName = METASOUND_LOCTEXT_FORMAT("VectorXFDisplayNamePattern", "EP Vector Crossfade ({0} x {1})", Columns, Rows);
+					const FText NodeDescription = METASOUND_LOCTEXT("VectorXFDescription", "Crossfades a grid of inputs by equal power from an X/Y position, mixing only the surrounding cells.");
+					FVertexInterface NodeInterface = GetVertexInterface();
+
+					FNodeClassMetadata Metadata
+					{
+						FNodeClassName { "EPVectorXF", OperatorName, DataTypeName },
+						1, // Major Version
+						0, // Minor Version
+						NodeDisplayName,
+						NodeDescription,
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ NodeCategories::Envelopes },
+						{ },
+						FNodeDisplayStyle()
+					};
+					return Metadata;
+				};
+
+			static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+			return Metadata;
+		}
+
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, TArray<TUniquePtr<IOperatorBuildError>>& OutErrors)
+		{
+			using namespace VectorXFVertexNames;
+
+			const FInputVertexInterface& InputInterface = InParams.Node.GetVertexInterface().GetInputInterface();
+			const FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+
+			FFloatReadRef X = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InputX), InParams.OperatorSettings);
+			FFloatReadRef Y = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InputY), InParams.OperatorSettings);
+
+			FInputArray InputValues;
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InputValues.Add(InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, GetInputName<Columns, Rows>(i), InParams.OperatorSettings));
+			}
+
+			return MakeUnique<TVectorXFOperator<Columns, Rows>>(InParams.OperatorSettings, X, Y, MoveTemp(InputValues));
+		}
+
+		TVectorXFOperator(const FOperatorSettings& InSettings, const FFloatReadRef& InX, const FFloatReadRef& InY, FInputArray&& InInputValues)
+			: X(InX)
+			, Y(InY)
+			, InputValues(MoveTemp(InInputValues))
+			, OutputValue(TDataWriteReferenceFactory<FAudioBuffer>::CreateAny(InSettings))
+			, Crossfader(Columns, Rows, FMSUtilsQuality::Get())
+		{
+			PerformCrossfadeOutput();
+		}
+
+		virtual ~TVectorXFOperator() = default;
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace VectorXFVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputX), X);
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InputY), Y);
+
+			for (int32 i = 0; i < NumInputs; ++i)
+			{
+				InOutVertexData.BindReadVertex(GetInputName<Columns, Rows>(i), InputValues[i]);
+			}
+		}
+
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override
+		{
+			using namespace VectorXFVertexNames;
+			InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutputAudio), OutputValue);
+		}
+
+		virtual FDataReferenceCollection GetInputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		virtual FDataReferenceCollection GetOutputs() const override
+		{
+			// This should never be called. Bind(...) is called instead. This method
+			// exists as a stop-gap until the API can be deprecated and removed.
+			checkNoEntry();
+			return {};
+		}
+
+		void PerformCrossfadeOutput()
+		{
+			// Only recompute the corner gains if the position has changed. Compared after clamping, so a position
+			// held outside the grid doesn't count as a change.
+			const float ClampedX = FMath::Clamp(*X, 0.f, (float)(Columns - 1));
+			const float ClampedY = FMath::Clamp(*Y, 0.f, (float)(Rows - 1));
+			if (ClampedX != PrevX || ClampedY != PrevY || bInit == false)
+			{
+				bInit = true;
+				PrevX = ClampedX;
+				PrevY = ClampedY;
+				Crossfader.SetPosition(PrevX, PrevY);
+			}
+
+			Crossfader.GetCrossfadeOutput(InputValues, *OutputValue);
+		}
+
+		void Reset(const IOperator::FResetParams& InParams)
+		{
+			PerformCrossfadeOutput();
+		}
+
+		void Execute()
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MSUtils_VectorCrossfadeExecute);
+			MSUTILS_EXECUTE_SCOPE(TEXT("Vector Crossfade"));
+			PerformCrossfadeOutput();
+		}
+
+	private:
+		FFloatReadRef X;
+		FFloatReadRef Y;
+		FInputArray InputValues;
+		TDataWriteReference<FAudioBuffer> OutputValue;
+
+		float PrevX = 0.0f;
+		float PrevY = 0.0f;
+		bool bInit = false;
+		FVectorXFHelper Crossfader;
+	};
+
+	template<int32 Columns, int32 Rows>
+	class TVectorCrossfadeNode : public FNodeFacade
+	{
+	public:
+		/**
+		 * Constructor used by the Metasound Frontend.
+		 */
+		TVectorCrossfadeNode(const FNodeInitData& InInitData)
+			: FNodeFacade(InInitData.InstanceName, InInitData.InstanceID, TFacadeOperatorClass<TVectorXFOperator<Columns, Rows>>())
+		{}
+
+		virtual ~TVectorCrossfadeNode() = default;
+	};
+
+	REGISTER_VECTORCROSSFADE_NODE(2, 2);
+	REGISTER_VECTORCROSSFADE_NODE(3, 3);
+	REGISTER_VECTORCROSSFADE_NODE(4, 4);
+
+}
+
+#undef LOCTEXT_NAMESPACE
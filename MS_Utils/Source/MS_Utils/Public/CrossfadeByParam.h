@@ -12,6 +12,10 @@
 #include "MetasoundStandardNodesNames.h" 
 #include "MetasoundFacade.h"
 #include "MetasoundParamHelper.h" 
+#include "MSUtilsQuality.h"
+#include "CrossfadeProfile.h"
+#include "LatencyProbe.h"
+#include "OperatorCapture.h"
 
 
 //------------------------------------------------------------------------------------
@@ -30,7 +34,12 @@ namespace Metasound
 			const FFloatReadRef& FadeInEndIn,
 			const FFloatReadRef& FadeOutStartIn,
 			const FFloatReadRef& FadeOutEndIn,
-			const FFloatReadRef& ValueIn);
+			const FFloatReadRef& ValueIn,
+			const FCrossfadeProfileAssetReadRef& ProfileIn,
+			const FOperatorCapturePtr& InCapture,
+			const FLatencyProbePtr& InLatencyProbe);
+
+		virtual ~FCBPOperator();
 
 		//UFUNCTION()
 		//static functions exist across the class and not instances. They cannot access member instance variables or non-static members
@@ -50,7 +59,14 @@ namespace Metasound
 		//UFUNCTION()
 		void Execute();
 
+		const FAudioBuffer& GetAudioOutput() const
+		{
+			return *AudioOutput;
+		}
+
 	private:
+		// Gain from the per-node fade inputs, used when no profile is connected
+		float GetParamGain() const;
 
 		FFloatReadRef FloatIn;
 		FBoolReadRef bUseEPCrossfade;
@@ -58,6 +74,7 @@ namespace Metasound
 		FFloatReadRef FadeInEnd;
 		FFloatReadRef FadeOutStart;
 		FFloatReadRef FadeOutEnd;
+		FCrossfadeProfileAssetReadRef Profile;
 		FAudioBufferReadRef AudioInput;
 		FAudioBufferWriteRef AudioOutput;
 		int32 NumFramesPerBlock = 0;
@@ -68,7 +85,11 @@ namespace Metasound
 		float AmplitudePrev = 0.0f;
 		float FadeInCos;
 		float FadeOutCos;
+		const FCrossfadeProfileData* ProfilePrev = nullptr;
 		bool bInit = false;
+		FMSUtilsQuality Quality;
+		FOperatorCapturePtr Capture;
+		FLatencyProbePtr LatencyProbe;
 	};
 
 	//------------------------------------------------------------------------------------
@@ -0,0 +1,147 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Engine/DataAsset.h"
+#include "IAudioProxyInitializer.h"
+#include "MetasoundDataReferenceMacro.h"
+
+#include "CrossfadeProfile.generated.h"
+
+UENUM(BlueprintType)
+enum class ECrossfadeGainLaw : uint8
+{
+	Linear,
+	EqualPower
+};
+
+//------------------------------------------------------------------------------------
+// FCrossfadeProfileData
+//------------------------------------------------------------------------------------
+
+// Baked, immutable form of a UCrossfadeProfile. Built once when the asset loads or is edited and shared read-only by
+// every operator that uses the profile, so instances neither copy the zones nor re-bake the gain table.
+struct MS_UTILS_API FCrossfadeProfileData
+{
+	float FadeInStart = 0.f;
+	float FadeInEnd = 0.f;
+	float FadeOutStart = 1.f;
+	float FadeOutEnd = 1.f;
+	ECrossfadeGainLaw GainLaw = ECrossfadeGainLaw::Linear;
+
+	// Gain sampled evenly from TableMin to TableMax, covering every zone edge
+	TArray<float> GainTable;
+	float TableMin = 0.f;
+	float TableMax = 1.f;
+
+	// Looks up the gain for Value, interpolating between table entries
+	float GetGain(float Value) const;
+};
+
+using FCrossfadeProfileDataPtr = TSharedPtr<const FCrossfadeProfileData, ESPMode::ThreadSafe>;
+
+//------------------------------------------------------------------------------------
+// FCrossfadeProfileProxy
+//------------------------------------------------------------------------------------
+
+// Hands the baked data from the game thread to the audio render thread
+class MS_UTILS_API FCrossfadeProfileProxy : public Audio::TProxyData<FCrossfadeProfileProxy>
+{
+public:
+	IMPL_AUDIOPROXY_CLASS(FCrossfadeProfileProxy);
+
+	explicit FCrossfadeProfileProxy(const FCrossfadeProfileDataPtr& InData)
+		: Data(InData)
+	{
+	}
+
+	FCrossfadeProfileProxy(const FCrossfadeProfileProxy& Other) = default;
+
+	const FCrossfadeProfileDataPtr& GetData() const
+	{
+		return Data;
+	}
+
+private:
+	FCrossfadeProfileDataPtr Data;
+};
+
+//------------------------------------------------------------------------------------
+// UCrossfadeProfile
+//------------------------------------------------------------------------------------
+
+// Fade zones and gain law shared by the Crossfade By Param nodes. Create one as a Data Asset and connect it to a node's
+// Profile input. The EP, Vector and Timed crossfades move between inputs rather than fade one over a range of values,
+// so they have no Profile input.
+UCLASS(BlueprintType)
+class MS_UTILS_API UCrossfadeProfile : public UDataAsset, public IAudioProxyDataFactory
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Zones")
+	float FadeInStart = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Zones")
+	float FadeInEnd = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Zones")
+	float FadeOutStart = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Zones")
+	float FadeOutEnd = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gain")
+	ECrossfadeGainLaw GainLaw = ECrossfadeGainLaw::EqualPower;
+
+	// Number of entries in the baked gain table
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gain", meta = (ClampMin = "2", ClampMax = "4096"))
+	int32 TableSize = 256;
+
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	//~ Begin IAudioProxyDataFactory Interface
+	virtual TSharedPtr<Audio::IProxyData> CreateProxyData(const Audio::FProxyDataInitParams& InitParams) override;
+	//~ End IAudioProxyDataFactory Interface
+
+private:
+	void Bake();
+
+	FCrossfadeProfileDataPtr BakedData;
+};
+
+//------------------------------------------------------------------------------------
+// FCrossfadeProfileAsset
+//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// MetaSound data type for a Crossfade Profile input
+	class MS_UTILS_API FCrossfadeProfileAsset
+	{
+	public:
+		FCrossfadeProfileAsset() = default;
+		FCrossfadeProfileAsset(const FCrossfadeProfileAsset&) = default;
+		FCrossfadeProfileAsset& operator=(const FCrossfadeProfileAsset& Other) = default;
+
+		FCrossfadeProfileAsset(const TSharedPtr<Audio::IProxyData>& InInitData);
+
+		// Null when no profile is connected
+		const FCrossfadeProfileData* GetData() const
+		{
+			return Data.Get();
+		}
+
+	private:
+		FCrossfadeProfileDataPtr Data;
+	};
+}
+
+DECLARE_METASOUND_DATA_REFERENCE_TYPES(Metasound::FCrossfadeProfileAsset, MS_UTILS_API, FCrossfadeProfileAssetTypeInfo, FCrossfadeProfileAssetReadRef, FCrossfadeProfileAssetWriteRef);
@@ -12,6 +12,9 @@
 #include "MetasoundStandardNodesNames.h" 
 #include "MetasoundFacade.h"
 #include "MetasoundParamHelper.h" 
+#include "MSUtilsQuality.h"
+#include "LatencyProbe.h"
+#include "OperatorCapture.h"
 
 
 //------------------------------------------------------------------------------------
@@ -26,7 +29,14 @@ namespace Metasound
 		FEPXFOperator(const FOperatorSettings& InSettings, 
 			const FAudioBufferReadRef& InAudio, 
 			const FAudioBufferReadRef& InAudio2, 
-			const FFloatReadRef& ValueIn);
+			const FFloatReadRef& ValueIn,
+			const FFloatReadRef& TrimOneIn,
+			const FFloatReadRef& TrimTwoIn,
+			const FFloatReadRef& MasterGainIn,
+			const FOperatorCapturePtr& InCapture,
+			const FLatencyProbePtr& InLatencyProbe);
+
+		virtual ~FEPXFOperator();
 
 		//UFUNCTION()
 		//static functions exist across the class and not instances. They cannot access member instance variables or non-static members
@@ -49,9 +59,17 @@ namespace Metasound
 		//UFUNCTION()
 		void MixInInput(FAudioBufferReadRef& InBuffer, TArrayView<float>& OutBufferView, float PrevGain, float NewGain);
 
+		const FAudioBuffer& GetAudioOutput() const
+		{
+			return *AudioOutput;
+		}
+
 	private:
 
 		FFloatReadRef FloatIn;
+		FFloatReadRef TrimOne;
+		FFloatReadRef TrimTwo;
+		FFloatReadRef MasterGain;
 		FAudioBufferReadRef AudioInput;
 		FAudioBufferReadRef AudioInput2;
 		FAudioBufferWriteRef AudioOutput;
@@ -61,6 +79,9 @@ namespace Metasound
 		float FloatInPrev = 1.1f;
 		float SignalOneFloat;
 		float SignalTwoFloat;
+		FMSUtilsQuality Quality;
+		FOperatorCapturePtr Capture;
+		FLatencyProbePtr LatencyProbe;
 	};
 
 	//------------------------------------------------------------------------------------
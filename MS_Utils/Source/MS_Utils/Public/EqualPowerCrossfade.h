@@ -0,0 +1,18 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MetasoundNodeInterface.h"
+
+//------------------------------------------------------------------------------------
+// EP Crossfade
+//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// Creates an EP Crossfade node of NumInputs inputs, the same node class the Frontend registers. Null unless
+	// NumInputs is a registered size, 2 to 8.
+	MS_UTILS_API TUniquePtr<INode> CreateEPCrossfadeNode(int32 NumInputs, const FNodeInitData& InInitData);
+}
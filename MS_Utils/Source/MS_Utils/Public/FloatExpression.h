@@ -0,0 +1,122 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MetasoundExecutableOperator.h"
+#include "Internationalization/Text.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundTime.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundStandardNodesNames.h" 
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h" 
+
+
+//------------------------------------------------------------------------------------
+// FFloatExprOperator
+//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	namespace FloatExpression
+	{
+		// Number of float inputs, exposed as A to H and referenced by those letters in the formula.
+		constexpr int32 NumInputs = 8;
+
+		// The compiler rejects formulas that would need a deeper evaluation stack than this.
+		constexpr int32 MaxStackDepth = 32;
+
+		enum class EOp : uint8
+		{
+			PushConst,
+			PushInput,
+			Add,
+			Sub,
+			Mul,
+			Div,
+			Pow,
+			Neg,
+			Min,
+			Max,
+			Clamp,
+			Sin,
+			Cos,
+			Sqrt,
+			Abs
+		};
+
+		// One postfix instruction. Index is the input for PushInput, Value the constant for PushConst.
+		struct FInstruction
+		{
+			EOp Op = EOp::PushConst;
+			int32 Index = 0;
+			float Value = 0.f;
+		};
+
+		// Compiles Formula into a flat postfix program. Supports + - * / ^, unary minus, parentheses, numbers, pi,
+		// inputs a-h and the functions min, max, clamp, sin, cos, sqrt and abs. Returns false and sets OutError on failure.
+		MS_UTILS_API bool Compile(const FString& Formula, TArray<FInstruction>& OutInstructions, FString& OutError);
+
+		// Runs a program produced by Compile. Never returns inf or nan: a result that would be is 0, as is division by
+		// zero and a negative number raised to a fractional power.
+		MS_UTILS_API float Evaluate(TArrayView<const FInstruction> Instructions, TArrayView<const float> Inputs);
+	}
+
+	class FFloatExprOperator : public TExecutableOperator<FFloatExprOperator>
+	{
+	public:
+		using FInputArray = TArray<FFloatReadRef, TInlineAllocator<FloatExpression::NumInputs>>;
+
+		FFloatExprOperator(const FOperatorSettings& InSettings,
+			const FStringReadRef& FormulaIn,
+			FInputArray&& InputsIn,
+			TArray<FloatExpression::FInstruction>&& InstructionsIn);
+
+		//UFUNCTION()
+		static const FVertexInterface& DeclareVertexInterface();
+
+		//UFUNCTION()
+		static const FNodeClassMetadata& GetNodeInfo();
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override;
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override;
+
+		//UFUNCTION
+		// Used to instantiate a new runtime instance of your node
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors);
+
+		//UFUNCTION()
+		void Execute();
+
+	private:
+
+		FStringReadRef Formula;
+		FInputArray Inputs;
+		FFloatWriteRef FloatOutput;
+
+		// Compiled once in CreateOperator from the formula's value at that point
+		TArray<FloatExpression::FInstruction> Instructions;
+
+		// Input values from the last evaluation, so unchanged blocks skip the interpreter
+		float PrevInputs[FloatExpression::NumInputs] = { };
+		bool bInit = false;
+	};
+
+	//------------------------------------------------------------------------------------
+	// FFloatExprNode
+	//------------------------------------------------------------------------------------
+
+	// Node Class - Inheriting from FNodeFacade is recommended for nodes that have a static FVertexInterface
+	class FFloatExprNode : public FNodeFacade
+	{
+	public:
+		//MetaSound frontend constructor
+		FFloatExprNode(const FNodeInitData& InitData) : FNodeFacade(InitData.InstanceName, InitData.InstanceID,
+			TFacadeOperatorClass<FFloatExprOperator>())
+		{
+		}
+	};
+
+}
@@ -0,0 +1,76 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MetasoundOperatorSettings.h"
+
+//------------------------------------------------------------------------------------
+// FLatencyProbe
+//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	struct FLatencyHistogram;
+	struct FLatencySendStamp;
+
+	// Measures how long a change to an operator's watched input takes to be heard. Enabled with
+	// au.MSUtils.LatencyProbe.Enabled. A change is stamped on the block where the operator first sees it. The probe then
+	// follows the gain that moves furthest and records the block and sample where it is 90% of the way to its new value.
+	// To cover parameter transmission and block quantisation as well, call NoteParameterSent from the game thread as
+	// the parameter is set. Sends are matched by probe id: the name of the node input the probe watches, or
+	// au.MSUtils.LatencyProbe.ProbeId when set. Results are kept per node type in fixed histograms. They are printed by
+	// au.MSUtils.LatencyProbe.Report and traced as counters for Insights.
+	class MS_UTILS_API FLatencyProbe
+	{
+	public:
+		// Null unless the probe is enabled. InputName is the watched input. NumGains is the length of the array passed
+		// to OnBlock.
+		static TSharedPtr<FLatencyProbe, ESPMode::ThreadSafe> Open(FName NodeType, FName InputName, const FOperatorSettings& InSettings, int32 NumGains, bool bPerBlockRamps);
+
+		// Game thread. Stamps the send time of a parameter feeding the probes with this id. The next change those
+		// probes see is measured from here.
+		static void NoteParameterSent(FName ProbeId);
+
+		// Summary of every node type's histograms
+		static FString GetReport();
+
+		static void ResetHistograms();
+
+		FLatencyProbe(FLatencyHistogram& InHistogram, FLatencySendStamp& InSendStamp, const FOperatorSettings& InSettings, int32 NumGains, bool bInPerBlockRamps);
+
+		// Render thread only. Call once per block after the gains are worked out. Gains holds the value each gain
+		// reaches at the end of this block. Gains ramp linearly from their previous values across the block, or step
+		// at its start with per-block ramps. Never blocks or allocates.
+		void OnBlock(float InputValue, TArrayView<const float> Gains);
+
+	private:
+		// Finds the frame of this block where the tracked gain crosses Threshold, or INDEX_NONE
+		int32 FindCrossingFrame(float StartGain, float EndGain) const;
+
+		FLatencyHistogram& Histogram;
+		FLatencySendStamp& SendStamp;
+		uint32 SendSequence = 0;
+		int32 NumFramesPerBlock = 0;
+		float SampleRate = 0.f;
+		bool bPerBlockRamps = false;
+
+		TArray<float> PrevGains;
+		float PrevInput = 0.f;
+		bool bHasBlock = false;
+		uint64 BlockIndex = 0;
+
+		// The change being followed
+		bool bPending = false;
+		uint64 ChangeBlockIndex = 0;
+		int32 TrackedGain = INDEX_NONE;
+		float Origin = 0.f;
+		float Threshold = 0.f;
+
+		// Send to the block that saw the change, or negative if the change had no matching send
+		float SendMs = -1.f;
+	};
+
+	using FLatencyProbePtr = TSharedPtr<FLatencyProbe, ESPMode::ThreadSafe>;
+}
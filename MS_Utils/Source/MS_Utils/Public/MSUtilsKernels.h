@@ -0,0 +1,31 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//------------------------------------------------------------------------------------
+// MSUtilsKernels
+//------------------------------------------------------------------------------------
+
+// Inner loops shared by the MS_Utils nodes, and by MetaSoundsSPL when it is built with MS_Utils. When the module is built with ISPC these run the kernels in
+// MSUtilsKernels.ispc, which are compiled for every ISPC target of the platform and dispatched at runtime.
+// Set au.MSUtils.ISPC.Enabled 0 to force the Audio::Array* path for comparison.
+namespace Metasound
+{
+	namespace MSUtilsKernels
+	{
+		// Adds InValues into OutValues with a gain ramped linearly from StartGain to EndGain across the buffer.
+		// Same result as Audio::ArrayMixIn.
+		MS_UTILS_API void MixIn(TArrayView<const float> InValues, TArrayView<float> OutValues, float StartGain, float EndGain);
+
+		// MixIn that also returns the sum of squares of InValues, so a level can be tracked without a second pass
+		MS_UTILS_API float MixInAndMeasure(TArrayView<const float> InValues, TArrayView<float> OutValues, float StartGain, float EndGain);
+
+		// Writes InValues to OutValues with a ramped gain applied, in one pass instead of a copy followed by a fade.
+		MS_UTILS_API void FadeCopy(TArrayView<const float> InValues, TArrayView<float> OutValues, float StartGain, float EndGain);
+
+		// Sum of the squares of InValues
+		MS_UTILS_API float SumOfSquares(TArrayView<const float> InValues);
+	}
+}
@@ -0,0 +1,75 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//------------------------------------------------------------------------------------
+// FMSUtilsQuality
+//------------------------------------------------------------------------------------
+
+// Fidelity/CPU trade-offs for the MS_Utils nodes. au.MSUtils.Quality picks a tier, and the individual CVars
+// override single options. Operators read this once when they are created, so a change applies to new voices
+// without a restart.
+//
+// Per-platform defaults go in the [MSUtils.Quality] section of the Engine ini, as CVar=Value lines. The section is
+// read through the platform's config hierarchy when the module starts, so Config/Android/AndroidEngine.ini can
+// ship a lower tier than Config/DefaultEngine.ini. Device profiles and the console still take priority.
+namespace Metasound
+{
+	struct FMSUtilsQuality
+	{
+		// Use a cubic approximation of the equal-power curve instead of FMath::Cos
+		bool bApproximateGains = false;
+
+		// Jump to new gains at the block boundary instead of ramping them across the block
+		bool bPerBlockRamps = false;
+
+		// Vector Crossfade mixes only the two loudest of its four corners. A corner leaving the mix still fades out over
+		// one block before it is dropped. The other crossfades already mix at most two inputs, so they ignore this.
+		bool bTwoInputFallback = false;
+
+		// Reads the current CVar values
+		MS_UTILS_API static FMSUtilsQuality Get();
+
+		// Sets the CVars from the platform's [MSUtils.Quality] Engine ini section. Called on module startup.
+		MS_UTILS_API static void ApplyPlatformSettings();
+
+		// Equal-power gain of an input at crossfade position Alpha (0 = fully in, 1 = fully out): cos(Alpha * PI / 2),
+		// or the cubic 1 - 1.367 Alpha^2 + 0.367 Alpha^3 when approximating (max error 0.0044).
+		float EqualPowerGain(float Alpha) const
+		{
+			if (bApproximateGains)
+			{
+				const float ClampedAlpha = FMath::Clamp(Alpha, 0.f, 1.f);
+				const float AlphaSquared = ClampedAlpha * ClampedAlpha;
+				return FMath::Clamp(1.f - 1.367f * AlphaSquared + 0.367f * AlphaSquared * ClampedAlpha, 0.f, 1.f);
+			}
+			return FMath::Clamp(FMath::Cos(Alpha * HALF_PI), 0.f, 1.f);
+		}
+
+		// Equal-power gains of the two inputs either side of a position, Alpha being how far it is past the first
+		void GetPairGains(float Alpha, float& OutGainA, float& OutGainB) const
+		{
+			OutGainA = EqualPowerGain(Alpha);
+			OutGainB = EqualPowerGain(1.f - Alpha);
+		}
+
+		// Splits a crossfade position into the inputs either side of it, as EP Crossfade does: 2.25 across four inputs
+		// gives IndexA 2, IndexB 3 and Alpha 0.25. The position is clamped to the inputs, and at the last input IndexB
+		// is the same as IndexA.
+		static void SplitPosition(float Position, int32 NumInputs, int32& OutIndexA, int32& OutIndexB, float& OutAlpha)
+		{
+			const float ClampedPosition = FMath::Clamp(Position, 0.f, (float)FMath::Max(NumInputs - 1, 0));
+			OutIndexA = (int32)FMath::Floor(ClampedPosition);
+			OutIndexB = FMath::Min(OutIndexA + 1, FMath::Max(NumInputs - 1, 0));
+			OutAlpha = ClampedPosition - (float)OutIndexA;
+		}
+
+		// Gain a ramp should start from this block
+		float GetRampStartGain(float PrevGain, float NewGain) const
+		{
+			return bPerBlockRamps ? NewGain : PrevGain;
+		}
+	};
+}
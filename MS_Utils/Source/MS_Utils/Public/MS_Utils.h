@@ -4,6 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "Stats/Stats.h"
+
+// Per-node render cost and live operator counts. Use "stat MS_Utils" or Insights while spawning voices
+// to see how each node scales with voice count.
+DECLARE_STATS_GROUP(TEXT("MS_Utils"), STATGROUP_MSUtils, STATCAT_Advanced);
 
 class FMS_UtilsModule : public IModuleInterface
 {
@@ -0,0 +1,148 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MetasoundAudioBuffer.h"
+#include "MetasoundOperatorSettings.h"
+#include "MetasoundPrimitives.h"
+
+#include <atomic>
+
+//------------------------------------------------------------------------------------
+// FOperatorCapture
+//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// Records an operator's inputs block by block so real parameter traffic can be replayed offline. Enabled with
+	// au.MSUtils.Capture.Enabled. Controls are stored as floats (bools as 0/1) in the order the operator's replayer reads
+	// them back, followed by the input audio when au.MSUtils.Capture.Audio is set. Blocks are copied into a preallocated
+	// ring on the render thread and written to Saved/Captures by a background thread. A full ring drops the block, which
+	// shows up in replay as a gap in the block indices.
+	class MS_UTILS_API FOperatorCapture
+	{
+	public:
+		// Null unless capture is enabled. OperatorType must match an FOperatorCaptureReplay registration.
+		static TSharedPtr<FOperatorCapture, ESPMode::ThreadSafe> Open(FName OperatorType, const FString& InstanceName, const FOperatorSettings& InSettings, int32 InNumControls, int32 InNumAudioInputs);
+
+		// Writes out anything still queued and stops the writer thread
+		static void Shutdown();
+
+		FOperatorCapture(FName InOperatorType, const FString& InInstanceName, const FOperatorSettings& InSettings, int32 InNumControls, int32 InNumAudioInputs, bool bInCaptureAudio, int32 InNumSlots);
+
+		// Render thread only. Never blocks or allocates.
+		void WriteBlock(TArrayView<const float> Controls, TArrayView<const FAudioBufferReadRef> AudioInputs);
+
+	private:
+		friend class FOperatorCaptureWriter;
+
+		FName OperatorType;
+		FString InstanceName;
+		float SampleRate = 0.f;
+		int32 NumFramesPerBlock = 0;
+		int32 NumControls = 0;
+		int32 NumAudioInputs = 0;
+		bool bCaptureAudio = false;
+
+		// Ring of NumSlots blocks, each SlotSize floats, shared by one producer and one consumer
+		int32 NumSlots = 0;
+		int32 SlotSize = 0;
+		TArray<float> Slots;
+		TArray<uint64> SlotBlockIndices;
+		std::atomic<uint32> WriteIndex { 0 };
+		std::atomic<uint32> ReadIndex { 0 };
+
+		// Render thread state
+		uint64 NextBlockIndex = 0;
+	};
+
+	using FOperatorCapturePtr = TSharedPtr<FOperatorCapture, ESPMode::ThreadSafe>;
+
+	//------------------------------------------------------------------------------------
+	// FCaptureReplayContext
+	//------------------------------------------------------------------------------------
+
+	// Inputs handed to an operator under replay. Each Get call returns a reference that is updated from the matching
+	// captured control or audio input before every Execute.
+	class MS_UTILS_API FCaptureReplayContext
+	{
+	public:
+		FCaptureReplayContext(const FOperatorSettings& InSettings, int32 NumControls, int32 NumAudioInputs);
+
+		const FOperatorSettings& GetSettings() const
+		{
+			return Settings;
+		}
+
+		FFloatReadRef GetFloat(int32 ControlIndex);
+		FBoolReadRef GetBool(int32 ControlIndex);
+		FInt32ReadRef GetInt32(int32 ControlIndex);
+		FAudioBufferReadRef GetAudio(int32 AudioIndex);
+
+		// Audio may be null for captures made without audio, in which case the inputs stay silent
+		void SetBlock(const float* Controls, const float* Audio, int32 NumCapturedFrames);
+
+	private:
+		FOperatorSettings Settings;
+		TArray<TFunction<void(float)>> ControlSetters;
+		TArray<FAudioBufferWriteRef> AudioInputs;
+	};
+
+	//------------------------------------------------------------------------------------
+	// FOperatorCaptureReplay
+	//------------------------------------------------------------------------------------
+
+	class IReplayOperator
+	{
+	public:
+		virtual ~IReplayOperator() = default;
+		virtual void Execute() = 0;
+		virtual const FAudioBuffer& GetAudioOutput() const = 0;
+	};
+
+	// Wraps an operator built directly from its constructor, so replay calls Execute without a graph
+	template<typename OperatorType>
+	class TReplayOperator : public IReplayOperator
+	{
+	public:
+		template<typename... ArgTypes>
+		TReplayOperator(ArgTypes&&... Args)
+			: Operator(Forward<ArgTypes>(Args)...)
+		{
+		}
+
+		virtual void Execute() override
+		{
+			Operator.Execute();
+		}
+
+		virtual const FAudioBuffer& GetAudioOutput() const override
+		{
+			return Operator.GetAudioOutput();
+		}
+
+	private:
+		OperatorType Operator;
+	};
+
+	using FCreateReplayOperator = TFunction<TUniquePtr<IReplayOperator>(FCaptureReplayContext&)>;
+
+	// Declare one as a static next to each captured operator to make its captures replayable, with the same control and
+	// audio input counts the operator passes to FOperatorCapture::Open. Replay runs from the
+	// console or headless with -ExecCmds:
+	// au.MSUtils.Capture.Replay <CaptureFile> [Iterations] [-Out=<RawFloatFile>] [-Compare=<RawFloatFile>]
+	// It reports Execute timings and, with -Compare, the largest output difference from an earlier -Out run.
+	class MS_UTILS_API FOperatorCaptureReplay
+	{
+	public:
+		FOperatorCaptureReplay(FName OperatorType, int32 NumControls, int32 NumAudioInputs, FCreateReplayOperator&& InCreate);
+
+		static bool Replay(const FString& CaptureFilename, int32 NumIterations, const FString& OutputFilename, const FString& CompareFilename);
+
+		// Builds an operator of a registered type against Context, for tests and benchmarks that drive operators without
+		// a capture file. Null if OperatorType has no replayer, e.g. when its plugin isn't loaded.
+		static TUniquePtr<IReplayOperator> CreateOperator(FName OperatorType, FCaptureReplayContext& Context);
+	};
+}
@@ -0,0 +1,98 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MetasoundExecutableOperator.h"
+#include "Internationalization/Text.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundTime.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundStandardNodesNames.h" 
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h" 
+#include "MSUtilsQuality.h"
+
+
+//------------------------------------------------------------------------------------
+// FDuckerOperator
+//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	class FDuckerOperator : public TExecutableOperator<FDuckerOperator>
+	{
+	public:
+		FDuckerOperator(const FOperatorSettings& InSettings, 
+			const FAudioBufferReadRef& InAudio, 
+			const FAudioBufferReadRef& InSidechain, 
+			const FBoolReadRef& bUsePeakIn,
+			const FFloatReadRef& AttackMsIn,
+			const FFloatReadRef& ReleaseMsIn,
+			const FBoolReadRef& bUseEPCrossfadeIn,
+			const FFloatReadRef& FadeInStartIn,
+			const FFloatReadRef& FadeInEndIn,
+			const FFloatReadRef& FadeOutStartIn,
+			const FFloatReadRef& FadeOutEndIn);
+
+		//UFUNCTION()
+		//static functions exist across the class and not instances. They cannot access member instance variables or non-static members
+		//they can only access other static members (variables or methods) of the class.
+		static const FVertexInterface& DeclareVertexInterface();
+
+		//UFUNCTION()
+		static const FNodeClassMetadata& GetNodeInfo();
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override;
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override;
+
+		//UFUNCTION
+		// Used to instantiate a new runtime instance of your node
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors);
+
+		//UFUNCTION()
+		void Execute();
+
+	private:
+
+		// Maps the sidechain envelope through the fade ranges, like FCBPOperator maps its input value
+		float GetTargetGain() const;
+
+		FAudioBufferReadRef AudioInput;
+		FAudioBufferReadRef SidechainInput;
+		FBoolReadRef bUsePeak;
+		FFloatReadRef AttackMs;
+		FFloatReadRef ReleaseMs;
+		FBoolReadRef bUseEPCrossfade;
+		FFloatReadRef FadeInStart;
+		FFloatReadRef FadeInEnd;
+		FFloatReadRef FadeOutStart;
+		FFloatReadRef FadeOutEnd;
+		FAudioBufferWriteRef AudioOutput;
+		float SampleRate = 0.f;
+		float Envelope = 0.f;
+		float AttackCoeff = 0.f;
+		float ReleaseCoeff = 0.f;
+		float AttackMsPrev = -1.f;
+		float ReleaseMsPrev = -1.f;
+		float GainPrev = 1.f;
+		FMSUtilsQuality Quality;
+	};
+
+	//------------------------------------------------------------------------------------
+	// FDuckerNode
+	//------------------------------------------------------------------------------------
+
+	// Node Class - Inheriting from FNodeFacade is recommended for nodes that have a static FVertexInterface
+	class FDuckerNode : public FNodeFacade
+	{
+	public:
+		//MetaSound frontend constructor
+		FDuckerNode(const FNodeInitData& InitData) : FNodeFacade(InitData.InstanceName, InitData.InstanceID,
+			TFacadeOperatorClass<FDuckerOperator>())
+		{
+		}
+	};
+
+}
@@ -0,0 +1,22 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "Modules/ModuleManager.h"
+#include "RenderThreadGuard.h"
+
+class FMS_UtilsGuardModule : public IModuleInterface
+{
+public:
+
+	virtual void StartupModule() override
+	{
+		// Loads at PostConfigInit, before the task graph and audio threads exist, so GMalloc can be swapped safely
+		Metasound::FRenderThreadGuard::Install();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		Metasound::FRenderThreadGuard::Uninstall();
+	}
+};
+
+IMPLEMENT_MODULE(FMS_UtilsGuardModule, MS_UtilsGuard)
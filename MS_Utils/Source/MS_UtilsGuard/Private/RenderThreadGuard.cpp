@@ -0,0 +1,555 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "RenderThreadGuard.h"
+
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformStackWalk.h"
+#include "Misc/CommandLine.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/Parse.h"
+#include "Misc/ScopeLock.h"
+
+#include <atomic>
+
+DEFINE_LOG_CATEGORY_STATIC(LogMSUtilsRenderThreadGuard, Log, All);
+
+#if MSUTILS_RENDER_THREAD_GUARD
+
+static int32 MSUtilsRenderThreadGuardEnabled = 0;
+static FAutoConsoleVariableRef CVarMSUtilsRenderThreadGuardEnabled(
+	TEXT("au.MSUtils.RenderThreadGuard"),
+	MSUtilsRenderThreadGuardEnabled,
+	TEXT("Report allocations inside MS_Utils and MetaSoundsSPL operator Execute calls, with callstacks. 0: off (default), 1: on. Needs the guard installed at startup with -MSUtilsRenderThreadGuard or [MSUtils.RenderThreadGuard] Enabled=True. Not available in shipping builds."),
+	FConsoleVariableDelegate::CreateLambda([](IConsoleVariable*)
+		{
+			Metasound::FRenderThreadGuard::SetEnabled(MSUtilsRenderThreadGuardEnabled != 0);
+		}),
+	ECVF_Default);
+
+namespace Metasound
+{
+	namespace RenderThreadGuardPrivate
+	{
+		static constexpr int32 MaxCallstackDepth = 32;
+		static constexpr int32 MaxPending = 256;
+
+		enum class EKind : uint8
+		{
+			Malloc,
+			Realloc,
+			Free,
+			Lock
+		};
+
+		// A violation as recorded on the offending thread: raw program counters only, nothing that needs allocating
+		struct FPendingViolation
+		{
+			EKind Kind = EKind::Malloc;
+			const TCHAR* NodeName = nullptr;
+			const TCHAR* LockName = nullptr;
+			uint64 Size = 0;
+			uint32 Depth = 0;
+			uint64 BackTrace[MaxCallstackDepth];
+		};
+
+		// One slot of the pending queue. Sequence says whose turn it is: equal to a write position when free for
+		// that writer, one past it once written and ready for the reader.
+		struct FPendingSlot
+		{
+			std::atomic<uint64> Sequence { 0 };
+			FPendingViolation Violation;
+		};
+
+		static std::atomic<bool> bEnabled { false };
+		static thread_local const TCHAR* CurrentNodeName = nullptr;
+		static thread_local bool bRecording = false;
+
+		// Bounded multi-producer queue filled by Record and emptied by Drain. Record runs inside Execute, so it takes
+		// no lock: writers claim a slot by advancing WritePos and publish it through the slot's Sequence.
+		static FPendingSlot Pending[MaxPending];
+		static std::atomic<uint64> WritePos { 0 };
+		static uint64 ReadPos = 0;
+		static std::atomic<int32> NumDropped { 0 };
+		static FPendingViolation Draining[MaxPending];
+
+		struct FPendingInit
+		{
+			FPendingInit()
+			{
+				for (uint64 i = 0; i < MaxPending; ++i)
+				{
+					Pending[i].Sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+		};
+		static FPendingInit PendingInit;
+
+		// Consumer state, keyed by a hash of kind, node and callstack
+		static FCriticalSection ViolationsLock;
+		static TMap<uint32, FRenderThreadGuard::FViolation> Violations;
+		static TSet<uint32> LoggedKeys;
+
+		static FCriticalSection InstallLock;
+		static FTSTicker::FDelegateHandle TickerHandle;
+
+		void Record(EKind Kind, uint64 Size, const TCHAR* LockName = nullptr)
+		{
+			const TCHAR* NodeName = CurrentNodeName;
+			if (NodeName == nullptr || bRecording || !bEnabled.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+			TGuardValue<bool> RecordingGuard(bRecording, true);
+
+			// Claim a slot, or drop the violation if the queue is full
+			uint64 Pos = WritePos.load(std::memory_order_relaxed);
+			FPendingSlot* Slot = nullptr;
+			for (;;)
+			{
+				Slot = &Pending[Pos % MaxPending];
+				const int64 Turn = (int64)(Slot->Sequence.load(std::memory_order_acquire) - Pos);
+				if (Turn == 0)
+				{
+					if (WritePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (Turn < 0)
+				{
+					NumDropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				else
+				{
+					Pos = WritePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			FPendingViolation& Violation = Slot->Violation;
+			Violation.Kind = Kind;
+			Violation.NodeName = NodeName;
+			Violation.LockName = LockName;
+			Violation.Size = Size;
+			Violation.Depth = FPlatformStackWalk::CaptureStackBackTrace(Violation.BackTrace, MaxCallstackDepth);
+			Slot->Sequence.store(Pos + 1, std::memory_order_release);
+		}
+
+		FString Describe(const FPendingViolation& Violation)
+		{
+			switch (Violation.Kind)
+			{
+			case EKind::Malloc:
+				return FString::Printf(TEXT("Malloc %llu bytes"), Violation.Size);
+			case EKind::Realloc:
+				return FString::Printf(TEXT("Realloc to %llu bytes"), Violation.Size);
+			case EKind::Lock:
+				return FString::Printf(TEXT("Lock %s"), Violation.LockName);
+			default:
+				return TEXT("Free");
+			}
+		}
+
+		FString Symbolize(const FPendingViolation& Violation)
+		{
+			FString Callstack;
+			for (uint32 i = 0; i < Violation.Depth; ++i)
+			{
+				ANSICHAR Line[1024];
+				Line[0] = 0;
+				FPlatformStackWalk::ProgramCounterToHumanReadableString(i, Violation.BackTrace[i], Line, sizeof(Line));
+				Callstack += ANSI_TO_TCHAR(Line);
+				Callstack += TEXT("\n");
+			}
+			return Callstack;
+		}
+
+		// Moves pending violations into Violations, symbolizing each new callstack once. New ones are logged.
+		void Drain()
+		{
+			// Held throughout, so the ticker and ConsumeViolations can't share Draining
+			FScopeLock Lock(&ViolationsLock);
+
+			// Copy out every published slot and hand it back to the writers before the slow symbolizing below
+			int32 NumDraining = 0;
+			while (NumDraining < MaxPending)
+			{
+				FPendingSlot& Slot = Pending[ReadPos % MaxPending];
+				if (Slot.Sequence.load(std::memory_order_acquire) != ReadPos + 1)
+				{
+					break;
+				}
+				Draining[NumDraining++] = Slot.Violation;
+				Slot.Sequence.store(ReadPos + MaxPending, std::memory_order_release);
+				++ReadPos;
+			}
+			const int32 NumNewlyDropped = NumDropped.exchange(0, std::memory_order_relaxed);
+
+			if (NumNewlyDropped > 0)
+			{
+				UE_LOG(LogMSUtilsRenderThreadGuard, Warning, TEXT("%d render thread violations were dropped before they could be reported."), NumNewlyDropped);
+			}
+
+			for (int32 i = 0; i < NumDraining; ++i)
+			{
+				const FPendingViolation& Pended = Draining[i];
+				uint32 Key = FCrc::StrCrc32(Pended.NodeName, (uint32)Pended.Kind);
+				if (Pended.LockName)
+				{
+					Key = FCrc::StrCrc32(Pended.LockName, Key);
+				}
+				Key = FCrc::MemCrc32(Pended.BackTrace, Pended.Depth * sizeof(uint64), Key);
+
+				if (FRenderThreadGuard::FViolation* Existing = Violations.Find(Key))
+				{
+					++Existing->Count;
+					continue;
+				}
+
+				FRenderThreadGuard::FViolation& Violation = Violations.Add(Key);
+				Violation.NodeName = Pended.NodeName;
+				Violation.Description = Describe(Pended);
+				Violation.Callstack = Symbolize(Pended);
+				Violation.Count = 1;
+
+				if (!LoggedKeys.Contains(Key))
+				{
+					LoggedKeys.Add(Key);
+					UE_LOG(LogMSUtilsRenderThreadGuard, Error, TEXT("%s in %s Execute:\n%s"), *Violation.Description, *Violation.NodeName, *Violation.Callstack);
+				}
+			}
+		}
+
+		// Forwards everything to the allocator it wraps, recording calls made inside an Execute scope first
+		class FRenderThreadGuardMalloc : public FMalloc
+		{
+		public:
+			explicit FRenderThreadGuardMalloc(FMalloc* InInner)
+				: Inner(InInner)
+			{
+			}
+
+			FMalloc* GetInner() const
+			{
+				return Inner;
+			}
+
+			virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+			{
+				Record(EKind::Malloc, Count);
+				return Inner->Malloc(Count, Alignment);
+			}
+
+			virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+			{
+				Record(EKind::Malloc, Count);
+				return Inner->TryMalloc(Count, Alignment);
+			}
+
+			virtual void* MallocZeroed(SIZE_T Count, uint32 Alignment) override
+			{
+				Record(EKind::Malloc, Count);
+				return Inner->MallocZeroed(Count, Alignment);
+			}
+
+			virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+			{
+				Record(EKind::Realloc, Count);
+				return Inner->Realloc(Original, Count, Alignment);
+			}
+
+			virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+			{
+				Record(EKind::Realloc, Count);
+				return Inner->TryRealloc(Original, Count, Alignment);
+			}
+
+			virtual void Free(void* Original) override
+			{
+				if (Original)
+				{
+					Record(EKind::Free, 0);
+				}
+				Inner->Free(Original);
+			}
+
+			virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+			{
+				return Inner->QuantizeSize(Count, Alignment);
+			}
+
+			virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+			{
+				return Inner->GetAllocationSize(Original, SizeOut);
+			}
+
+			virtual void Trim(bool bTrimThreadCaches) override
+			{
+				Inner->Trim(bTrimThreadCaches);
+			}
+
+			virtual void SetupTLSCachesOnCurrentThread() override
+			{
+				Inner->SetupTLSCachesOnCurrentThread();
+			}
+
+			virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+			{
+				Inner->ClearAndDisableTLSCachesOnCurrentThread();
+			}
+
+			virtual void InitializeStatsMetadata() override
+			{
+				Inner->InitializeStatsMetadata();
+			}
+
+			virtual void UpdateStats() override
+			{
+				Inner->UpdateStats();
+			}
+
+			virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override
+			{
+				Inner->GetAllocatorStats(OutStats);
+			}
+
+			virtual void DumpAllocatorStats(FOutputDevice& Ar) override
+			{
+				Inner->DumpAllocatorStats(Ar);
+			}
+
+			virtual bool IsInternallyThreadSafe() const override
+			{
+				return Inner->IsInternallyThreadSafe();
+			}
+
+			virtual bool ValidateHeap() override
+			{
+				return Inner->ValidateHeap();
+			}
+
+			virtual const TCHAR* GetDescriptiveName() override
+			{
+				return Inner->GetDescriptiveName();
+			}
+
+			virtual void OnMallocInitialized() override
+			{
+				Inner->OnMallocInitialized();
+			}
+
+			virtual void OnPreFork() override
+			{
+				Inner->OnPreFork();
+			}
+
+			virtual void OnPostFork() override
+			{
+				Inner->OnPostFork();
+			}
+
+		private:
+			FMalloc* Inner = nullptr;
+		};
+
+		static FRenderThreadGuardMalloc* GuardMalloc = nullptr;
+	}
+
+	FRenderThreadGuard::FScope::FScope(const TCHAR* NodeName)
+	{
+		using namespace RenderThreadGuardPrivate;
+
+		if (bEnabled.load(std::memory_order_relaxed))
+		{
+			PrevNodeName = CurrentNodeName;
+			CurrentNodeName = NodeName;
+			bActive = true;
+		}
+	}
+
+	FRenderThreadGuard::FScope::~FScope()
+	{
+		if (bActive)
+		{
+			RenderThreadGuardPrivate::CurrentNodeName = PrevNodeName;
+		}
+	}
+
+	void FRenderThreadGuard::NoteLock(const TCHAR* LockName)
+	{
+		using namespace RenderThreadGuardPrivate;
+
+		Record(EKind::Lock, 0, LockName);
+	}
+
+	void FRenderThreadGuard::Install()
+	{
+		using namespace RenderThreadGuardPrivate;
+
+		// The proxy puts a virtual call in front of every allocation in the process, so it only goes in when asked for
+		bool bRequested = FParse::Param(FCommandLine::Get(), TEXT("MSUtilsRenderThreadGuard"));
+		if (!bRequested && GConfig)
+		{
+			GConfig->GetBool(TEXT("MSUtils.RenderThreadGuard"), TEXT("Enabled"), bRequested, GEngineIni);
+		}
+
+		if (!bRequested)
+		{
+			return;
+		}
+
+		{
+			FScopeLock Lock(&InstallLock);
+			if (GuardMalloc)
+			{
+				return;
+			}
+
+			// MS_UtilsGuard installs at PostConfigInit, before the task graph and audio threads start, so no other
+			// thread is allocating while the pointer changes
+			GuardMalloc = new FRenderThreadGuardMalloc(GMalloc);
+			GMalloc = GuardMalloc;
+		}
+
+		SetEnabled(true);
+	}
+
+	void FRenderThreadGuard::Uninstall()
+	{
+		using namespace RenderThreadGuardPrivate;
+
+		SetEnabled(false);
+
+		FScopeLock Lock(&InstallLock);
+		if (!GuardMalloc)
+		{
+			return;
+		}
+
+		if (GMalloc == GuardMalloc)
+		{
+			GMalloc = GuardMalloc->GetInner();
+		}
+		else
+		{
+			UE_LOG(LogMSUtilsRenderThreadGuard, Warning, TEXT("GMalloc was wrapped again after the render thread guard, so the guard's proxy can't be removed."));
+		}
+
+		// Leaked rather than deleted: another thread may still be returning from one of its calls
+		GuardMalloc = nullptr;
+	}
+
+	void FRenderThreadGuard::SetEnabled(bool bInEnabled)
+	{
+		using namespace RenderThreadGuardPrivate;
+
+		FScopeLock Lock(&InstallLock);
+		if (bInEnabled == bEnabled.load())
+		{
+			return;
+		}
+
+		if (bInEnabled)
+		{
+			if (!GuardMalloc)
+			{
+				UE_LOG(LogMSUtilsRenderThreadGuard, Warning, TEXT("The render thread guard isn't installed. Start with -MSUtilsRenderThreadGuard or set Enabled=True under [MSUtils.RenderThreadGuard] in the Engine ini."));
+				return;
+			}
+
+			TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float)
+				{
+					Drain();
+					return true;
+				}), 1.f);
+
+			bEnabled.store(true);
+			UE_LOG(LogMSUtilsRenderThreadGuard, Display, TEXT("Render thread guard enabled: allocations in operator Execute calls will be reported."));
+		}
+		else
+		{
+			bEnabled.store(false);
+			FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+			TickerHandle.Reset();
+			Drain();
+		}
+	}
+
+	bool FRenderThreadGuard::IsInstalled()
+	{
+		using namespace RenderThreadGuardPrivate;
+
+		FScopeLock Lock(&InstallLock);
+		return GuardMalloc != nullptr;
+	}
+
+	bool FRenderThreadGuard::IsEnabled()
+	{
+		return RenderThreadGuardPrivate::bEnabled.load(std::memory_order_relaxed);
+	}
+
+	TArray<FRenderThreadGuard::FViolation> FRenderThreadGuard::ConsumeViolations()
+	{
+		using namespace RenderThreadGuardPrivate;
+
+		Drain();
+
+		TArray<FViolation> Result;
+		FScopeLock Lock(&ViolationsLock);
+		Violations.GenerateValueArray(Result);
+		Violations.Reset();
+		return Result;
+	}
+}
+
+#else
+
+namespace Metasound
+{
+	FRenderThreadGuard::FScope::FScope(const TCHAR* NodeName)
+	{
+	}
+
+	FRenderThreadGuard::FScope::~FScope()
+	{
+	}
+
+	void FRenderThreadGuard::NoteLock(const TCHAR* LockName)
+	{
+	}
+
+	void FRenderThreadGuard::Install()
+	{
+	}
+
+	void FRenderThreadGuard::Uninstall()
+	{
+	}
+
+	void FRenderThreadGuard::SetEnabled(bool bInEnabled)
+	{
+		if (bInEnabled)
+		{
+			UE_LOG(LogMSUtilsRenderThreadGuard, Warning, TEXT("The render thread guard is not available in this build."));
+		}
+	}
+
+	bool FRenderThreadGuard::IsInstalled()
+	{
+		return false;
+	}
+
+	bool FRenderThreadGuard::IsEnabled()
+	{
+		return false;
+	}
+
+	TArray<FRenderThreadGuard::FViolation> FRenderThreadGuard::ConsumeViolations()
+	{
+		return {};
+	}
+}
+
+#endif
@@ -0,0 +1,87 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// The guard is compiled out of shipping builds, where the scope macro expands to nothing
+#ifndef MSUTILS_RENDER_THREAD_GUARD
+#define MSUTILS_RENDER_THREAD_GUARD !UE_BUILD_SHIPPING
+#endif
+
+//------------------------------------------------------------------------------------
+// FRenderThreadGuard
+//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// Debug check that operator Execute calls don't allocate. Start with -MSUtilsRenderThreadGuard, or set Enabled=True
+	// under [MSUtils.RenderThreadGuard] in the Engine ini, to have the MS_UtilsGuard module wrap GMalloc in a forwarding
+	// proxy at PostConfigInit. Without either, nothing is installed and allocations pay nothing. Once installed,
+	// au.MSUtils.RenderThreadGuard turns recording off and on by flipping a flag the proxy reads. Every allocation,
+	// reallocation or free made inside an MSUTILS_EXECUTE_SCOPE is recorded with its callstack and node name, and so is
+	// every lock taken after an MSUTILS_NOTE_LOCK. Recording never allocates or locks. Violations are symbolized and
+	// logged once per unique callstack about every second, and automation tests can drain them with ConsumeViolations
+	// to fail on regressions.
+	//
+	// Limits: the scope is per thread, so work an Execute hands to other threads isn't seen. Locks are only seen where
+	// MS_Utils and MetaSoundsSPL note them, next to each of their own FScopeLocks. Locks taken inside engine code, such
+	// as task graph waits or the allocator's own locks, can't be hooked from here.
+	class MS_UTILSGUARD_API FRenderThreadGuard
+	{
+	public:
+		struct FViolation
+		{
+			FString NodeName;
+
+			// What happened, e.g. "Malloc 256 bytes"
+			FString Description;
+
+			FString Callstack;
+
+			// Times this node hit this callstack
+			int32 Count = 0;
+		};
+
+		// Marks the current thread as inside NodeName's Execute for the lifetime of the scope
+		class MS_UTILSGUARD_API FScope
+		{
+		public:
+			FScope(const TCHAR* NodeName);
+			~FScope();
+
+		private:
+			const TCHAR* PrevNodeName = nullptr;
+			bool bActive = false;
+		};
+
+		// Records a lock taken inside an Execute scope. Call through MSUTILS_NOTE_LOCK just before taking the lock.
+		// LockName must outlive the guard, e.g. a string literal.
+		static void NoteLock(const TCHAR* LockName);
+
+		// Wraps GMalloc in the recording proxy and enables it, if the command line or Engine ini asks for the guard.
+		// Called once by the MS_UtilsGuard module at PostConfigInit, before other threads start. Uninstall puts the
+		// original allocator back on shutdown, while the proxy's code is still loaded.
+		static void Install();
+		static void Uninstall();
+
+		static bool IsInstalled();
+
+		// Starts or stops recording. Only toggles a flag, so it is safe from any thread at any time. Enabling does
+		// nothing but warn if the guard wasn't installed at startup.
+		static void SetEnabled(bool bEnabled);
+
+		static bool IsEnabled();
+
+		// Returns every violation recorded since the last call, merged by node and callstack, and clears them
+		static TArray<FViolation> ConsumeViolations();
+	};
+}
+
+#if MSUTILS_RENDER_THREAD_GUARD
+#define MSUTILS_EXECUTE_SCOPE(NodeName) Metasound::FRenderThreadGuard::FScope PREPROCESSOR_JOIN(RenderThreadGuardScope, __LINE__)(NodeName)
+#define MSUTILS_NOTE_LOCK(LockName) Metasound::FRenderThreadGuard::NoteLock(LockName)
+#else
+#define MSUTILS_EXECUTE_SCOPE(NodeName)
+#define MSUTILS_NOTE_LOCK(LockName)
+#endif
@@ -0,0 +1,25 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class MS_UtilsTests : ModuleRules
+{
+	public MS_UtilsTests(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+				"CoreUObject",
+				"Engine",
+				"MetasoundGraphCore",
+				"MetasoundFrontend",
+				"MS_Utils",
+				"MS_UtilsGuard"
+				// ... add private dependencies that you statically link with here ...	
+			}
+			);
+	}
+}
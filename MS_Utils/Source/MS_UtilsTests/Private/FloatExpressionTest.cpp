@@ -0,0 +1,103 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "CoreMinimal.h"
+
+#include "FloatExpression.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace Metasound
+{
+	namespace FloatExpressionTestPrivate
+	{
+		// Inputs a to h
+		static const float Inputs[FloatExpression::NumInputs] = { 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f };
+
+		static bool TestValue(FAutomationTestBase& Test, const TCHAR* Formula, float Expected)
+		{
+			TArray<FloatExpression::FInstruction> Instructions;
+			FString Error;
+			const bool bCompiled = FloatExpression::Compile(Formula, Instructions, Error);
+			if (!Test.TestTrue(FString::Printf(TEXT("'%s' compiles (%s)"), Formula, *Error), bCompiled))
+			{
+				return false;
+			}
+
+			const float Result = FloatExpression::Evaluate(Instructions, Inputs);
+			return Test.TestEqual(FString::Printf(TEXT("'%s'"), Formula), Result, Expected, KINDA_SMALL_NUMBER);
+		}
+
+		// Checks Formula fails to compile with an error containing ExpectedError
+		static bool TestError(FAutomationTestBase& Test, const TCHAR* Formula, const TCHAR* ExpectedError)
+		{
+			TArray<FloatExpression::FInstruction> Instructions;
+			FString Error;
+			if (!Test.TestFalse(FString::Printf(TEXT("'%s' compiles"), Formula), FloatExpression::Compile(Formula, Instructions, Error)))
+			{
+				return false;
+			}
+
+			return Test.TestTrue(FString::Printf(TEXT("'%s' error '%s' contains '%s'"), Formula, *Error, ExpectedError), Error.Contains(ExpectedError));
+		}
+	}
+
+	// Compiles and evaluates formulas covering operator precedence, unary minus, malformed input and unknown names
+	IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMSUtilsFloatExpressionTest, "MSUtils.FloatExpression",
+		EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+	bool FMSUtilsFloatExpressionTest::RunTest(const FString& Parameters)
+	{
+		using namespace FloatExpressionTestPrivate;
+
+		// Precedence and associativity
+		TestValue(*this, TEXT("1 + 2 * 3"), 7.f);
+		TestValue(*this, TEXT("(1 + 2) * 3"), 9.f);
+		TestValue(*this, TEXT("10 - 4 - 3"), 3.f);
+		TestValue(*this, TEXT("8 / 4 / 2"), 1.f);
+		TestValue(*this, TEXT("2 * 3 ^ 2"), 18.f);
+		TestValue(*this, TEXT("2 ^ 3 ^ 2"), 512.f);
+		TestValue(*this, TEXT("a + b * c"), 14.f);
+		TestValue(*this, TEXT("A * H"), 18.f);
+		TestValue(*this, TEXT("clamp(h, a, d) + min(b, c) * max(b, c)"), 17.f);
+		TestValue(*this, TEXT("2 * pi"), 2.f * PI);
+
+		// Unary minus binds looser than ^ and tighter than * and /
+		TestValue(*this, TEXT("-2 ^ 2"), -4.f);
+		TestValue(*this, TEXT("2 ^ -1"), 0.5f);
+		TestValue(*this, TEXT("--1"), 1.f);
+		TestValue(*this, TEXT("a * -b"), -6.f);
+		TestValue(*this, TEXT("-a - -b"), 1.f);
+		TestValue(*this, TEXT("abs(-(a + b))"), 5.f);
+
+		// Results that would be inf or nan are 0
+		TestValue(*this, TEXT("a / 0"), 0.f);
+		TestValue(*this, TEXT("(-1) ^ 0.5"), 0.f);
+		TestValue(*this, TEXT("pow(-8, 1 / 3)"), 0.f);
+		TestValue(*this, TEXT("10 ^ 100"), 0.f);
+		TestValue(*this, TEXT("a ^ 100 * a ^ 100"), 0.f);
+		TestValue(*this, TEXT("sqrt(-1)"), 0.f);
+
+		// Malformed input
+		TestError(*this, TEXT(""), TEXT("Formula is empty"));
+		TestError(*this, TEXT("   "), TEXT("Formula is empty"));
+		TestError(*this, TEXT("1 +"), TEXT("Unexpected end of formula"));
+		TestError(*this, TEXT("(1 + 2"), TEXT("Expected ')'"));
+		TestError(*this, TEXT("1 + 2)"), TEXT("Unexpected ')'"));
+		TestError(*this, TEXT("1.2.3"), TEXT("Malformed number '1.2.3'"));
+		TestError(*this, TEXT("1."), TEXT("Expected a digit after '.'"));
+		TestError(*this, TEXT("2pi"), TEXT("Malformed number"));
+		TestError(*this, TEXT("a $ b"), TEXT("Unexpected '$'"));
+		TestError(*this, TEXT("min(a)"), TEXT("min takes 2 arguments"));
+		TestError(*this, TEXT("sin a"), TEXT("Expected '(' after sin"));
+
+		// Unknown identifiers
+		TestError(*this, TEXT("i"), TEXT("Unknown name 'i'"));
+		TestError(*this, TEXT("foo + a"), TEXT("Unknown name 'foo'"));
+		TestError(*this, TEXT("tan(a)"), TEXT("Unknown name 'tan'"));
+
+		return !HasAnyErrors();
+	}
+}
+
+#endif
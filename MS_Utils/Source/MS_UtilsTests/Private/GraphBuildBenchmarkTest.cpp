@@ -0,0 +1,117 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "CoreMinimal.h"
+
+#include "EqualPowerCrossfade.h"
+#include "HAL/IConsoleManager.h"
+#include "MetasoundDataReferenceCollection.h"
+#include "MetasoundEnvironment.h"
+#include "MetasoundOperatorInterface.h"
+#include "MetasoundVertexData.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static int32 MSUtilsBenchmarkGraphs = 1000;
+static FAutoConsoleVariableRef CVarMSUtilsBenchmarkGraphs(
+	TEXT("au.MSUtils.Benchmark.Graphs"),
+	MSUtilsBenchmarkGraphs,
+	TEXT("Graphs the graph build benchmark builds."),
+	ECVF_Default);
+
+namespace Metasound
+{
+	namespace GraphBuildBenchmarkPrivate
+	{
+		static constexpr float SampleRate = 48000.f;
+		static constexpr float BlockRate = 100.f;
+
+		// Each benchmark graph holds one EP Crossfade of every registered size
+		static constexpr int32 MinNumInputs = 2;
+		static constexpr int32 MaxNumInputs = 8;
+
+		// Builds one operator the way the graph builder does: the node's operator factory creates it from its input
+		// references, then its inputs and outputs are bound against the node interface. With no references every input
+		// takes its vertex default, as on an unconnected node. Returns its number of input vertices, 0 on failure.
+		static int32 BuildOperator(const FOperatorSettings& Settings, const INode& Node)
+		{
+			const FDataReferenceCollection InputDataReferences;
+			const FMetasoundEnvironment Environment;
+			const FCreateOperatorParams Params { Node, Settings, InputDataReferences, Environment };
+
+			FBuildErrorArray Errors;
+			TUniquePtr<IOperator> Operator = Node.GetDefaultOperatorClass()->GetOperatorFactory()->CreateOperator(Params, Errors);
+			if (!Operator || Errors.Num() > 0)
+			{
+				return 0;
+			}
+
+			const FVertexInterface& Interface = Node.GetVertexInterface();
+			FInputVertexInterfaceData InputData(Interface.GetInputInterface());
+			FOutputVertexInterfaceData OutputData(Interface.GetOutputInterface());
+			Operator->BindInputs(InputData);
+			Operator->BindOutputs(OutputData);
+			return Interface.GetInputInterface().Num();
+		}
+	}
+
+	// Builds the operators of au.MSUtils.Benchmark.Graphs graphs of EP Crossfades, one of each size from 2 to 8
+	// inputs, and reports the time per graph. The first, cold build is reported on its own: it also creates the
+	// static interfaces and vertex name tables, which a running game has paid for before its first sound starts.
+	IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMSUtilsGraphBuildBenchmarkTest, "MSUtils.Benchmark.GraphBuild",
+		EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+	bool FMSUtilsGraphBuildBenchmarkTest::RunTest(const FString& Parameters)
+	{
+		using namespace GraphBuildBenchmarkPrivate;
+
+		const FOperatorSettings Settings(SampleRate, BlockRate);
+		const int32 NumGraphs = FMath::Max(MSUtilsBenchmarkGraphs, 1);
+
+		// Nodes belong to the graph, which is built once per asset, so only the operators are timed
+		TArray<TUniquePtr<INode>> Nodes;
+		for (int32 NumInputs = MinNumInputs; NumInputs <= MaxNumInputs; ++NumInputs)
+		{
+			const FNodeInitData InitData { *FString::Printf(TEXT("EPCrossfade%d"), NumInputs), FGuid::NewGuid() };
+			Nodes.Add(CreateEPCrossfadeNode(NumInputs, InitData));
+			if (!TestNotNull(FString::Printf(TEXT("EP Crossfade %d node"), NumInputs), Nodes.Last().Get()))
+			{
+				return false;
+			}
+		}
+
+		const uint64 ColdStartCycles = FPlatformTime::Cycles64();
+		for (const TUniquePtr<INode>& Node : Nodes)
+		{
+			if (!TestTrue(FString::Printf(TEXT("%s builds"), *Node->GetInstanceName().ToString()), BuildOperator(Settings, *Node) > 0))
+			{
+				return false;
+			}
+		}
+		const uint64 ColdCycles = FPlatformTime::Cycles64() - ColdStartCycles;
+
+		uint64 TotalCycles = 0;
+		uint64 MaxCycles = 0;
+		int32 NumBound = 0;
+		for (int32 Graph = 0; Graph < NumGraphs; ++Graph)
+		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (const TUniquePtr<INode>& Node : Nodes)
+			{
+				NumBound += BuildOperator(Settings, *Node);
+			}
+			const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+			TotalCycles += Cycles;
+			MaxCycles = FMath::Max(MaxCycles, Cycles);
+		}
+
+		const double MeanUs = 1000.0 * FPlatformTime::ToMilliseconds64(TotalCycles) / NumGraphs;
+		AddInfo(FString::Printf(TEXT("Built %d graphs of %d EP Crossfades, %d input vertices: mean %.2f us, max %.2f us per graph."),
+			NumGraphs, Nodes.Num(), NumBound, MeanUs, 1000.0 * FPlatformTime::ToMilliseconds64(MaxCycles)));
+		AddInfo(FString::Printf(TEXT("First (cold) graph: %.2f us."), 1000.0 * FPlatformTime::ToMilliseconds64(ColdCycles)));
+
+		return true;
+	}
+}
+
+#endif
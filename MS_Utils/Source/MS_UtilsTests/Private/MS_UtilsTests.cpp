@@ -0,0 +1,6 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "Modules/ModuleManager.h"
+
+// Automation tests and benchmarks for the MS_Utils nodes. Nothing here ships.
+IMPLEMENT_MODULE(FDefaultModuleImpl, MS_UtilsTests)
@@ -0,0 +1,301 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#include "CoreMinimal.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ScopeExit.h"
+#include "Modules/ModuleManager.h"
+#include "OperatorCapture.h"
+#include "RenderThreadGuard.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static int32 MSUtilsBenchmarkMinVoices = 16;
+static FAutoConsoleVariableRef CVarMSUtilsBenchmarkMinVoices(
+	TEXT("au.MSUtils.Benchmark.MinVoices"),
+	MSUtilsBenchmarkMinVoices,
+	TEXT("The voice benchmark fails if a node type sustains fewer voices than this."),
+	ECVF_Default);
+
+static int32 MSUtilsBenchmarkMaxVoices = 1024;
+static FAutoConsoleVariableRef CVarMSUtilsBenchmarkMaxVoices(
+	TEXT("au.MSUtils.Benchmark.MaxVoices"),
+	MSUtilsBenchmarkMaxVoices,
+	TEXT("Voice count the voice benchmark stops doubling at."),
+	ECVF_Default);
+
+static int32 MSUtilsBenchmarkBlocks = 200;
+static FAutoConsoleVariableRef CVarMSUtilsBenchmarkBlocks(
+	TEXT("au.MSUtils.Benchmark.Blocks"),
+	MSUtilsBenchmarkBlocks,
+	TEXT("Blocks the voice benchmark renders at each voice count."),
+	ECVF_Default);
+
+static float MSUtilsBenchmarkBudget = 0.5f;
+static FAutoConsoleVariableRef CVarMSUtilsBenchmarkBudget(
+	TEXT("au.MSUtils.Benchmark.Budget"),
+	MSUtilsBenchmarkBudget,
+	TEXT("Fraction of the block period the benchmarked voices may take before the block counts as an underrun. The rest is left for the mixer and other sources."),
+	ECVF_Default);
+
+namespace Metasound
+{
+	namespace VoiceBenchmarkPrivate
+	{
+		// MetaSound's default block rate at a 48 kHz mixer
+		static constexpr float SampleRate = 48000.f;
+		static constexpr float BlockRate = 100.f;
+
+		// Noise blocks the voices cycle through, so inputs differ between voices and blocks without generating noise per block
+		static constexpr int32 NumNoiseBlocks = 16;
+
+		static constexpr int32 RandomSeed = 0x4D53;
+
+		struct FBenchmarkNode
+		{
+			FName OperatorType;
+			int32 NumControls = 0;
+			int32 NumAudioInputs = 0;
+
+			// Fills one voice's controls for the next block, in the order the operator's replayer reads them
+			TFunction<void(FRandomStream&, TArrayView<float>)> RandomizeControls;
+		};
+
+		struct FVoiceCountResult
+		{
+			int32 NumVoices = 0;
+			double MeanMs = 0.0;
+			double MaxMs = 0.0;
+			int32 NumUnderruns = 0;
+		};
+
+		static TArray<FBenchmarkNode> GetBenchmarkNodes()
+		{
+			TArray<FBenchmarkNode> Nodes;
+
+			// Crossfade Value, Master Gain, the trims, then Loudness Compensation
+			for (int32 NumInputs = 2; NumInputs <= 8; ++NumInputs)
+			{
+				Nodes.Add({ *FString::Printf(TEXT("EPCrossfade%d"), NumInputs), 3 + NumInputs, NumInputs,
+					[NumInputs](FRandomStream& Random, TArrayView<float> Controls)
+					{
+						Controls[0] = Random.FRandRange(0.f, (float)(NumInputs - 1));
+						Controls[1] = Random.FRand();
+						for (int32 i = 0; i < NumInputs; ++i)
+						{
+							Controls[2 + i] = Random.FRand();
+						}
+						Controls[2 + NumInputs] = Random.RandRange(0, 1);
+					} });
+			}
+
+			// Crossfade Value, Trim 1, Trim 2, Master Gain
+			Nodes.Add({ TEXT("EPLight"), 4, 2,
+				[](FRandomStream& Random, TArrayView<float> Controls)
+				{
+					for (float& Control : Controls)
+					{
+						Control = Random.FRand();
+					}
+				} });
+
+			// Input Value, Use EP Crossfade, then the fade in and fade out zones in order
+			Nodes.Add({ TEXT("CrossfadeByParam"), 6, 1,
+				[](FRandomStream& Random, TArrayView<float> Controls)
+				{
+					Controls[0] = Random.FRand();
+					Controls[1] = Random.RandRange(0, 1);
+					Controls[2] = Random.FRandRange(0.f, 0.25f);
+					Controls[3] = Random.FRandRange(0.25f, 0.5f);
+					Controls[4] = Random.FRandRange(0.5f, 0.75f);
+					Controls[5] = Random.FRandRange(0.75f, 1.f);
+				} });
+
+			// Percentile Window
+			Nodes.Add({ TEXT("SPLMeter"), 1, 1,
+				[](FRandomStream& Random, TArrayView<float> Controls)
+				{
+					Controls[0] = Random.FRandRange(1.f, 10.f);
+				} });
+
+			return Nodes;
+		}
+
+		// Renders NumVoices voices of Node for NumBlocks blocks and times the Execute calls of each block together, as
+		// the audio render thread would see them. Returns false if a voice couldn't be created or produced a non-finite
+		// sample.
+		static bool RenderVoices(FAutomationTestBase& Test, const FBenchmarkNode& Node, int32 NumVoices, int32 NumBlocks, const TArray<float>& Noise, FRandomStream& Random, FVoiceCountResult& OutResult)
+		{
+			const FOperatorSettings Settings(SampleRate, BlockRate);
+			const int32 NumFrames = Settings.GetNumFramesPerBlock();
+			const double BudgetMs = 1000.0 * FMath::Clamp(MSUtilsBenchmarkBudget, 0.01f, 1.f) / BlockRate;
+
+			TArray<TUniquePtr<FCaptureReplayContext>> Contexts;
+			TArray<TUniquePtr<IReplayOperator>> Voices;
+			Contexts.Reserve(NumVoices);
+			Voices.Reserve(NumVoices);
+			for (int32 Voice = 0; Voice < NumVoices; ++Voice)
+			{
+				FCaptureReplayContext& Context = *Contexts.Add_GetRef(MakeUnique<FCaptureReplayContext>(Settings, Node.NumControls, Node.NumAudioInputs));
+				Voices.Add(FOperatorCaptureReplay::CreateOperator(Node.OperatorType, Context));
+				if (!Voices.Last())
+				{
+					Test.AddError(FString::Printf(TEXT("Could not create a %s operator."), *Node.OperatorType.ToString()));
+					return false;
+				}
+			}
+
+			TArray<float> Controls;
+			Controls.SetNumZeroed(Node.NumControls);
+
+			OutResult = FVoiceCountResult();
+			OutResult.NumVoices = NumVoices;
+			uint64 TotalCycles = 0;
+			uint64 MaxCycles = 0;
+			for (int32 Block = 0; Block < NumBlocks; ++Block)
+			{
+				// Parameters change every block, the worst case for the gain and ramp paths
+				for (int32 Voice = 0; Voice < NumVoices; ++Voice)
+				{
+					Node.RandomizeControls(Random, Controls);
+					const float* Audio = &Noise[((Block + Voice) % NumNoiseBlocks) * Node.NumAudioInputs * NumFrames];
+					Contexts[Voice]->SetBlock(Controls.GetData(), Audio, NumFrames);
+				}
+
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				for (const TUniquePtr<IReplayOperator>& Voice : Voices)
+				{
+					Voice->Execute();
+				}
+				const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+				TotalCycles += Cycles;
+				MaxCycles = FMath::Max(MaxCycles, Cycles);
+				if (FPlatformTime::ToMilliseconds64(Cycles) > BudgetMs)
+				{
+					++OutResult.NumUnderruns;
+				}
+
+				// NaN and Inf carry through a sum, so one pass per voice catches either
+				for (const TUniquePtr<IReplayOperator>& Voice : Voices)
+				{
+					const FAudioBuffer& Output = Voice->GetAudioOutput();
+					float Sum = 0.f;
+					for (int32 i = 0; i < Output.Num(); ++i)
+					{
+						Sum += Output.GetData()[i];
+					}
+
+					if (!FMath::IsFinite(Sum))
+					{
+						Test.AddError(FString::Printf(TEXT("%s produced a non-finite sample at %d voices, block %d."), *Node.OperatorType.ToString(), NumVoices, Block));
+						return false;
+					}
+				}
+			}
+
+			OutResult.MeanMs = FPlatformTime::ToMilliseconds64(TotalCycles) / FMath::Max(NumBlocks, 1);
+			OutResult.MaxMs = FPlatformTime::ToMilliseconds64(MaxCycles);
+			return true;
+		}
+	}
+
+	// Doubles the voice count of each node type until a block overruns its share of the block period, with randomised
+	// parameters and noise inputs. Voices are rendered on the test's thread through the replay factories, not through
+	// an audio device, so it runs the same on the null device, with -nosound or on a build machine. On Linux:
+	// UnrealEditor-Cmd <Project>.uproject -nullrhi -nosound -unattended -MSUtilsRenderThreadGuard -ExecCmds="Automation RunTests MSUtils.Benchmark; Quit"
+	// Reports render time and underruns per voice count. Fails if a node type can't sustain au.MSUtils.Benchmark.MinVoices
+	// or, with the render thread guard installed, allocates in Execute.
+	IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMSUtilsVoiceBenchmarkTest, "MSUtils.Benchmark.VoiceScaling",
+		EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+	bool FMSUtilsVoiceBenchmarkTest::RunTest(const FString& Parameters)
+	{
+		using namespace VoiceBenchmarkPrivate;
+
+		// The SPL Meter registers its replayer from MetaSoundsSPL, which is optional
+		if (FModuleManager::Get().ModuleExists(TEXT("MetaSoundsSPL")))
+		{
+			FModuleManager::Get().LoadModule(TEXT("MetaSoundsSPL"));
+		}
+
+		// With the render thread guard installed, every Execute runs under it and an allocation in any node fails the
+		// test. Violations recorded before the test started aren't ours and are dropped.
+		const bool bGuardWasEnabled = FRenderThreadGuard::IsEnabled();
+		if (FRenderThreadGuard::IsInstalled())
+		{
+			FRenderThreadGuard::ConsumeViolations();
+			FRenderThreadGuard::SetEnabled(true);
+		}
+		else
+		{
+			AddInfo(TEXT("Execute allocations aren't checked. Run with -MSUtilsRenderThreadGuard to check them."));
+		}
+		ON_SCOPE_EXIT
+		{
+			FRenderThreadGuard::SetEnabled(bGuardWasEnabled);
+		};
+
+		const int32 NumFrames = FOperatorSettings(SampleRate, BlockRate).GetNumFramesPerBlock();
+		const int32 NumBlocks = FMath::Max(MSUtilsBenchmarkBlocks, 1);
+		const int32 MaxVoices = FMath::Max(MSUtilsBenchmarkMaxVoices, 1);
+
+		FRandomStream Random(RandomSeed);
+		TArray<float> Noise;
+		Noise.SetNumUninitialized(NumNoiseBlocks * 8 * NumFrames);
+		for (float& Sample : Noise)
+		{
+			Sample = Random.FRandRange(-1.f, 1.f);
+		}
+
+		AddInfo(FString::Printf(TEXT("%d frames per block, %.3f ms budget per block, %d blocks per voice count, seed %d."),
+			NumFrames, 1000.f * MSUtilsBenchmarkBudget / BlockRate, NumBlocks, RandomSeed));
+
+		for (const FBenchmarkNode& Node : GetBenchmarkNodes())
+		{
+			FCaptureReplayContext ProbeContext(FOperatorSettings(SampleRate, BlockRate), Node.NumControls, Node.NumAudioInputs);
+			if (!FOperatorCaptureReplay::CreateOperator(Node.OperatorType, ProbeContext))
+			{
+				AddWarning(FString::Printf(TEXT("Skipping %s, its plugin isn't loaded."), *Node.OperatorType.ToString()));
+				continue;
+			}
+
+			int32 MaxSustainedVoices = 0;
+			for (int32 NumVoices = 1; NumVoices <= MaxVoices; NumVoices *= 2)
+			{
+				FVoiceCountResult Result;
+				if (!RenderVoices(*this, Node, NumVoices, NumBlocks, Noise, Random, Result))
+				{
+					return false;
+				}
+
+				AddInfo(FString::Printf(TEXT("%s x %d: mean %.3f ms, max %.3f ms, %d underruns."),
+					*Node.OperatorType.ToString(), NumVoices, Result.MeanMs, Result.MaxMs, Result.NumUnderruns));
+
+				// Drained per voice count so the guard's pending queue can't fill up on long runs
+				for (const FRenderThreadGuard::FViolation& Violation : FRenderThreadGuard::ConsumeViolations())
+				{
+					AddError(FString::Printf(TEXT("%s in %s Execute, %d times at %d voices:\n%s"),
+						*Violation.Description, *Violation.NodeName, Violation.Count, NumVoices, *Violation.Callstack));
+				}
+
+				if (Result.NumUnderruns > 0)
+				{
+					break;
+				}
+				MaxSustainedVoices = NumVoices;
+			}
+
+			AddInfo(FString::Printf(TEXT("%s sustains %s%d voices."), *Node.OperatorType.ToString(),
+				MaxSustainedVoices * 2 > MaxVoices ? TEXT("at least ") : TEXT(""), MaxSustainedVoices));
+			TestTrue(FString::Printf(TEXT("%s sustains au.MSUtils.Benchmark.MinVoices (%d)"), *Node.OperatorType.ToString(), MSUtilsBenchmarkMinVoices),
+				MaxSustainedVoices >= MSUtilsBenchmarkMinVoices);
+		}
+
+		return true;
+	}
+}
+
+#endif
@@ -1,5 +1,6 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class MetaSoundsSPL : ModuleRules
@@ -7,6 +8,17 @@ public class MetaSoundsSPL : ModuleRules
 	public MetaSoundsSPL(ReadOnlyTargetRules Target) : base(Target)
 	{
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// MS_Utils is optional. When it sits next to this plugin, the SPL meter supports operator capture/replay and
+		// the render thread guard, and measures levels with the MSUtilsKernels ISPC kernels. Without it, WITH_MS_UTILS
+		// is 0 and those hooks compile out.
+		bool bWithMSUtils = File.Exists(Path.Combine(PluginDirectory, "..", "MS_Utils", "MS_Utils.uplugin"));
+		PublicDefinitions.Add("WITH_MS_UTILS=" + (bWithMSUtils ? "1" : "0"));
+		if (bWithMSUtils)
+		{
+			PublicDependencyModuleNames.Add("MS_Utils");
+			PublicDependencyModuleNames.Add("MS_UtilsGuard");
+		}
 		
 		PublicIncludePaths.AddRange(
 			new string[] {
@@ -26,6 +38,8 @@ public class MetaSoundsSPL : ModuleRules
 			new string[]
 			{
 				"Core",
+				"CoreUObject",
+				"Engine",
                 "MetasoundGraphCore",
                 "MetasoundEngine",
                 "MetasoundFrontend",
@@ -38,13 +52,14 @@ public class MetaSoundsSPL : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"CoreUObject",
-				"Engine",
 				"Slate",
 				"SlateCore",
                 "MetasoundGraphCore",
                 "MetasoundEngine",
                 "MetasoundFrontend",
+				"SignalProcessing",
+				"AssetRegistry",
+				"Json",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
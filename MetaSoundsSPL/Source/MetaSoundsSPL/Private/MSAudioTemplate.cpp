@@ -2,9 +2,42 @@
 
 
 #include "MSAudioTemplate.h"
+#include "MetaSoundsSPL.h"
+
+#include "HAL/IConsoleManager.h"
 
 #define LOCTEXT_NAMESPACE "MetasoundStandardNodes_MetaSoundSPLMeter"
 
+DECLARE_CYCLE_STAT(TEXT("SPL Meter Execute"), STAT_MetaSoundsSPL_SPLMeterExecute, STATGROUP_MetaSoundsSPL);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("SPL Meter Operators"), STAT_MetaSoundsSPL_SPLMeterOperators, STATGROUP_MetaSoundsSPL);
+DECLARE_DWORD_COUNTER_STAT(TEXT("SPL Meter Fallback Blocks"), STAT_MetaSoundsSPL_SPLMeterFallbackBlocks, STATGROUP_MetaSoundsSPL);
+DECLARE_DWORD_COUNTER_STAT(TEXT("SPL Meter Fallback Levels Dropped"), STAT_MetaSoundsSPL_SPLMeterFallbackLevelsDropped, STATGROUP_MetaSoundsSPL);
+
+// Quality options, read when a meter is created. Per-platform defaults go in the [MetaSoundsSPL.Quality] section of the
+// Engine ini, which the module applies on startup (see FMetaSoundsSPLModule::StartupModule).
+// 0 = low, 1 = medium, 2 = high
+static int32 SPLMeterQualityTier = 2;
+static FAutoConsoleVariableRef CVarSPLMeterQualityTier(
+	TEXT("au.MetaSoundsSPL.Quality"),
+	SPLMeterQualityTier,
+	TEXT("Quality tier for SPL meters created from now on. 0: unweighted, 100 ms updates. 1: order 2 weighting, 50 ms updates. 2: full A-weighting, per-block updates (default)."),
+	ECVF_Scalability);
+
+// Per-option overrides. Negative values follow au.MetaSoundsSPL.Quality.
+static float SPLMeterUpdateIntervalMs = -1.f;
+static FAutoConsoleVariableRef CVarSPLMeterUpdateIntervalMs(
+	TEXT("au.MetaSoundsSPL.MeterUpdateIntervalMs"),
+	SPLMeterUpdateIntervalMs,
+	TEXT("Milliseconds between SPL meter level updates. 0 updates every block. -1 follows au.MetaSoundsSPL.Quality."),
+	ECVF_Scalability);
+
+static int32 SPLMeterWeightingOrder = -1;
+static FAutoConsoleVariableRef CVarSPLMeterWeightingOrder(
+	TEXT("au.MetaSoundsSPL.WeightingOrder"),
+	SPLMeterWeightingOrder,
+	TEXT("Order of the SPL meter's A-weighting filter, 0 (unweighted) to 6 (full). -1 follows au.MetaSoundsSPL.Quality."),
+	ECVF_Scalability);
+
 namespace Metasound
 {
 	//the below stores name and tooltip information for each input/output pin.
@@ -13,20 +46,116 @@ namespace Metasound
 	namespace SPLNodeNames
 	{
 		METASOUND_PARAM(InAudioParam, "In", "Input Audio");
+		METASOUND_PARAM(InPercentileWindowParam, "Percentile Window", "Seconds of level history behind the L10, L50 and L90 outputs");
 		METASOUND_PARAM(OutAudioParam, "Out", "Output Audio");
+		METASOUND_PARAM(OutLevelParam, "Level", "Input level in dB relative to full scale, averaged over the meter update interval");
+		METASOUND_PARAM(OutL10Param, "L10", "Level exceeded 10% of the time over the last percentile window, in 0.1 dB steps");
+		METASOUND_PARAM(OutL50Param, "L50", "Level exceeded 50% of the time over the last percentile window, in 0.1 dB steps");
+		METASOUND_PARAM(OutL90Param, "L90", "Level exceeded 90% of the time over the last percentile window, in 0.1 dB steps");
+	}
+
+	FSPLMeterSettings FSPLMeterSettings::Get()
+	{
+		static const float TierUpdateIntervalMs[] = { 100.f, 50.f, 0.f };
+		static const int32 TierWeightingOrder[] = { 0, 2, FSPLWeightingFilter::MaxOrder };
+		const int32 Tier = FMath::Clamp(SPLMeterQualityTier, 0, 2);
+
+		FSPLMeterSettings Settings;
+		Settings.UpdateIntervalMs = SPLMeterUpdateIntervalMs < 0.f ? TierUpdateIntervalMs[Tier] : SPLMeterUpdateIntervalMs;
+		Settings.WeightingOrder = SPLMeterWeightingOrder < 0 ? TierWeightingOrder[Tier] : SPLMeterWeightingOrder;
+		return Settings;
 	}
 
 	FSPLOperator::FSPLOperator(const FOperatorSettings& InSettings,
-		const FAudioBufferReadRef& InAudio)
+		const FAudioBufferReadRef& InAudio,
+		const FFloatReadRef& InPercentileWindow,
+		const FSPLMeterSettings& InMeterSettings,
+		const FSPLMeterLogChannelPtr& InLogChannel,
+		const FSPLAnalysisChannelPtr& InAnalysisChannel,
+		const FOperatorCapturePtr& InCapture)
 		: AudioInput(InAudio),
-		AudioOutput(FAudioBufferWriteRef::CreateNew(InSettings))
+		PercentileWindow(InPercentileWindow),
+		AudioOutput(FAudioBufferWriteRef::CreateNew(InSettings)),
+		LevelOutput(FFloatWriteRef::CreateNew(FSPLLevelHistogram::MinDb)),
+		L10Output(FFloatWriteRef::CreateNew(FSPLLevelHistogram::MinDb)),
+		L50Output(FFloatWriteRef::CreateNew(FSPLLevelHistogram::MinDb)),
+		L90Output(FFloatWriteRef::CreateNew(FSPLLevelHistogram::MinDb)),
+		SampleRate(InSettings.GetSampleRate()),
+		AnalysisChannel(InAnalysisChannel),
+		LogChannel(InLogChannel),
+		Capture(InCapture)
 	{
-	
+		INC_DWORD_STAT(STAT_MetaSoundsSPL_SPLMeterOperators);
+
+		// With the analysis offloaded, the local analyzer is only the overflow fallback and runs at reduced quality
+		const int32 WeightingOrder = AnalysisChannel ? FSPLAnalysisPipeline::GetFallbackWeightingOrder(InMeterSettings.WeightingOrder) : InMeterSettings.WeightingOrder;
+		Analyzer.Init(InSettings.GetSampleRate(), InSettings.GetNumFramesPerBlock(), InMeterSettings.UpdateIntervalMs, WeightingOrder);
 	};
 
+	FSPLOperator::~FSPLOperator()
+	{
+		DEC_DWORD_STAT(STAT_MetaSoundsSPL_SPLMeterOperators);
+	}
+
 	void FSPLOperator::Execute()
 	{
-		*AudioOutput = *AudioInput;
+		SCOPE_CYCLE_COUNTER(STAT_MetaSoundsSPL_SPLMeterExecute);
+		MSUTILS_EXECUTE_SCOPE(TEXT("SPL Meter"));
+
+#if WITH_MS_UTILS
+		if (Capture)
+		{
+			Capture->WriteBlock(MakeArrayView(&*PercentileWindow, 1), MakeArrayView(&AudioInput, 1));
+		}
+#endif
+
+		const int32 NumFrames = AudioInput->Num();
+		const float* Samples = AudioInput->GetData();
+
+		// A plain copy, as FAudioBuffer assignment goes through TArray and may reallocate
+		FMemory::Memcpy(AudioOutput->GetData(), Samples, FMath::Min(NumFrames, AudioOutput->Num()) * sizeof(float));
+
+		if (AnalysisChannel)
+		{
+			// Go back to offloading once the worker has caught up with the blocks queued before the overflow
+			if (bAnalysisFallback && AnalysisChannel->IsEmpty())
+			{
+				bAnalysisFallback = false;
+			}
+
+			if (!bAnalysisFallback && AnalysisChannel->Push(Samples, NumFrames, *PercentileWindow, FramesProcessed))
+			{
+				Results = AnalysisChannel->GetResults();
+			}
+			else
+			{
+				if (!bAnalysisFallback)
+				{
+					bAnalysisFallback = true;
+					Analyzer.Reset();
+				}
+				INC_DWORD_STAT(STAT_MetaSoundsSPL_SPLMeterFallbackBlocks);
+
+				// Not logged, as the worker may still be pushing to the log channel, but handed to the worker's
+				// percentile window so the blocks measured here still count towards L10/L50/L90
+				if (Analyzer.ProcessBlock(Samples, NumFrames, *PercentileWindow, Results)
+					&& !AnalysisChannel->PushFallbackLevel(Results.LevelDb, Analyzer.GetLastUpdateFrames(), *PercentileWindow))
+				{
+					INC_DWORD_STAT(STAT_MetaSoundsSPL_SPLMeterFallbackLevelsDropped);
+				}
+			}
+		}
+		else if (Analyzer.ProcessBlock(Samples, NumFrames, *PercentileWindow, Results) && LogChannel)
+		{
+			LogChannel->Push({ (float)((FramesProcessed + NumFrames) / SampleRate), Results.LevelDb, Results.L10Db, Results.L50Db, Results.L90Db });
+		}
+
+		FramesProcessed += NumFrames;
+
+		*LevelOutput = Results.LevelDb;
+		*L10Output = Results.L10Db;
+		*L50Output = Results.L50Db;
+		*L90Output = Results.L90Db;
 	}
 
 	const FVertexInterface& FSPLOperator::DeclareVertexInterface()
@@ -35,10 +164,15 @@ namespace Metasound
 
 		static const FVertexInterface Interface(
 			FInputVertexInterface(
-				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam))
+				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam)),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InPercentileWindowParam), 10.f)
 			),
 			FOutputVertexInterface(
-				TOutputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutAudioParam))
+				TOutputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutAudioParam)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutLevelParam)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutL10Param)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutL50Param)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutL90Param))
 			)
 		);
 
@@ -58,7 +192,7 @@ namespace Metasound
 						//	 StandardNodes::AudioVariant },
 						{ TEXT("UE"), TEXT("SPL Node"), TEXT("Audio") },
 						1, // Major Version
-						0, // Minor Version
+						2, // Minor Version
 						METASOUND_LOCTEXT("SPLMeterDisplayName", "SPL Meter"),
 						METASOUND_LOCTEXT("SPLMeterNodeDesc", "A node that returns the loudness of incoming sound"),
 						PluginAuthor,
@@ -108,12 +242,17 @@ namespace Metasound
 	{
 		using namespace SPLNodeNames;
 		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InAudioParam), AudioInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InPercentileWindowParam), PercentileWindow);
 	}
 
 	void FSPLOperator::BindOutputs(FOutputVertexInterfaceData& InOutVertexData)
 	{
 		using namespace SPLNodeNames;
 		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutAudioParam), AudioOutput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutLevelParam), LevelOutput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutL10Param), L10Output);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutL50Param), L50Output);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutL90Param), L90Output);
 	}
 
 	TUniquePtr<IOperator> FSPLOperator::CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors)
@@ -124,11 +263,29 @@ namespace Metasound
 		const Metasound::FInputVertexInterface& InputInterface = DeclareVertexInterface().GetInputInterface();
 
 		FAudioBufferReadRef AudioIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InAudioParam), InParams.OperatorSettings);
+		FFloatReadRef PercentileWindowIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InPercentileWindowParam), InParams.OperatorSettings);
+
+		const FSPLMeterSettings MeterSettings = FSPLMeterSettings::Get();
+		FSPLMeterLogChannelPtr LogChannel = FSPLMeterLog::OpenChannel(InParams.Node.GetInstanceName().ToString());
+		FSPLAnalysisChannelPtr AnalysisChannel = FSPLAnalysisPipeline::OpenChannel(InParams.OperatorSettings.GetSampleRate(), InParams.OperatorSettings.GetNumFramesPerBlock(), MeterSettings, LogChannel);
+#if WITH_MS_UTILS
+		FOperatorCapturePtr Capture = FOperatorCapture::Open(TEXT("SPLMeter"), InParams.Node.GetInstanceName().ToString(), InParams.OperatorSettings, 1, 1);
+#else
+		FOperatorCapturePtr Capture;
+#endif
 
 		//this class is FSPLOperator, which inherits from TExecutableOperator, which inherits from IOperator. IOperator type is returned
-		return MakeUnique<FSPLOperator>(InParams.OperatorSettings, AudioIn);
+		return MakeUnique<FSPLOperator>(InParams.OperatorSettings, AudioIn, PercentileWindowIn, MeterSettings, LogChannel, AnalysisChannel, Capture);
 	}
 
+#if WITH_MS_UTILS
+	// Replays with the current CVar settings, on the calling thread and without logging
+	static FOperatorCaptureReplay SPLMeterReplay(TEXT("SPLMeter"), 1, 1, [](FCaptureReplayContext& Context) -> TUniquePtr<IReplayOperator>
+		{
+			return MakeUnique<TReplayOperator<FSPLOperator>>(Context.GetSettings(), Context.GetAudio(0), Context.GetFloat(0), FSPLMeterSettings::Get(), nullptr, nullptr, nullptr);
+		});
+#endif
+
 	// Register node
 	METASOUND_REGISTER_NODE(FSPLNode);
 }
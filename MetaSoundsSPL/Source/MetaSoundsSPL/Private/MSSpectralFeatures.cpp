@@ -0,0 +1,378 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+
+#include "MSSpectralFeatures.h"
+#include "MetaSoundsSPL.h"
+
+#include "DSP/FFTAlgorithm.h"
+#include "DSP/FloatArrayMath.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_MetaSoundSpectralFeatures"
+
+DECLARE_CYCLE_STAT(TEXT("Spectral Features Execute"), STAT_MetaSoundsSPL_SpectralFeaturesExecute, STATGROUP_MetaSoundsSPL);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spectral Features Skipped Blocks"), STAT_MetaSoundsSPL_SpectralFeaturesSkippedBlocks, STATGROUP_MetaSoundsSPL);
+
+namespace Metasound
+{
+	//the below stores name and tooltip information for each input/output pin.
+	//this is then retrieved with METASOUND_GET_PARAM_NAME_AND_METADATA.
+	namespace SpectralFeaturesNodeNames
+	{
+		METASOUND_PARAM(InAudioParam, "In", "Input Audio");
+		METASOUND_PARAM(InFFTSizeParam, "FFT Size", "Analysis frame length in samples, rounded to a power of two between 256 and 8192. Read when the node is created.");
+		METASOUND_PARAM(InHopSizeParam, "Hop Size", "Samples between analysis frames, up to the FFT size. Read when the node is created.");
+		METASOUND_PARAM(InRolloffPercentParam, "Rolloff Percent", "Fraction of spectral energy below the rolloff frequency");
+		METASOUND_PARAM(OutCentroidParam, "Centroid", "Spectral centroid in Hz");
+		METASOUND_PARAM(OutFluxParam, "Flux", "Spectral flux: rectified change in normalised magnitude since the previous frame");
+		METASOUND_PARAM(OutRolloffParam, "Rolloff", "Frequency in Hz below which the rolloff percent of the energy lies");
+		METASOUND_PARAM(OutFlatnessParam, "Flatness", "Spectral flatness, 0 for a pure tone to 1 for white noise");
+	}
+
+	FSpectralFeaturesAnalyzer::FSpectralFeaturesAnalyzer(float SampleRate, int32 InFFTSize, int32 InHopSize)
+	{
+		const int32 Log2FFTSize = FMath::Clamp(FMath::CeilLogTwo(FMath::Max(InFFTSize, 1)), 8, 13);
+		FFTSize = 1 << Log2FFTSize;
+		HopSize = FMath::Clamp(InHopSize, 1, FFTSize);
+		FramesUntilHop = HopSize;
+		BinWidthHz = SampleRate / FFTSize;
+
+		// FFT plan, window and scratch buffers are all set up here so ProcessBlock never allocates
+		Audio::FFFTSettings FFTSettings;
+		FFTSettings.Log2Size = Log2FFTSize;
+		FFTSettings.bArrays128BitAligned = false;
+		FFTSettings.bEnableHardwareAcceleration = true;
+		FFT = Audio::FFFTFactory::NewFFTAlgorithm(FFTSettings);
+
+		// Periodic Hann window
+		Window.SetNumUninitialized(FFTSize);
+		for (int32 i = 0; i < FFTSize; ++i)
+		{
+			Window[i] = 0.5f - 0.5f * FMath::Cos(2.f * PI * i / FFTSize);
+		}
+
+		const int32 NumBins = FFTSize / 2 + 1;
+		History.AddZeroed(FFTSize);
+		FrameBuffer.AddZeroed(FFTSize);
+		ComplexBuffer.AddZeroed(FFT.IsValid() ? FFT->NumOutputFloats() : NumBins * 2);
+		PowerSpectrum.AddZeroed(NumBins);
+		Magnitudes.AddZeroed(NumBins);
+		PrevMagnitudes.AddZeroed(NumBins);
+	}
+
+	FSpectralFeaturesAnalyzer::~FSpectralFeaturesAnalyzer() = default;
+
+	bool FSpectralFeaturesAnalyzer::ProcessBlock(const float* Samples, int32 NumFrames, float RolloffPercent, FSpectralFeatures& Features)
+	{
+		bool bUpdated = false;
+
+		// Copy into the history ring, analysing only when a hop boundary is crossed
+		int32 Frame = 0;
+		while (Frame < NumFrames)
+		{
+			const int32 NumToCopy = FMath::Min3(NumFrames - Frame, FramesUntilHop, FFTSize - HistoryWritePos);
+			FMemory::Memcpy(History.GetData() + HistoryWritePos, Samples + Frame, NumToCopy * sizeof(float));
+
+			Frame += NumToCopy;
+			HistoryWritePos = (HistoryWritePos + NumToCopy) % FFTSize;
+			FramesUntilHop -= NumToCopy;
+
+			if (FramesUntilHop == 0)
+			{
+				AnalyzeFrame(RolloffPercent, Features);
+				FramesUntilHop = HopSize;
+				bUpdated = true;
+			}
+		}
+		return bUpdated;
+	}
+
+	void FSpectralFeaturesAnalyzer::Reset()
+	{
+		FMemory::Memzero(History.GetData(), History.Num() * sizeof(float));
+		FMemory::Memzero(PrevMagnitudes.GetData(), PrevMagnitudes.Num() * sizeof(float));
+		HistoryWritePos = 0;
+		FramesUntilHop = HopSize;
+	}
+
+	void FSpectralFeaturesAnalyzer::AnalyzeFrame(float RolloffPercent, FSpectralFeatures& Features)
+	{
+		if (!FFT.IsValid())
+		{
+			return;
+		}
+
+		// Unroll the ring oldest-first while applying the window
+		const int32 NumTail = FFTSize - HistoryWritePos;
+		for (int32 i = 0; i < NumTail; ++i)
+		{
+			FrameBuffer[i] = History[HistoryWritePos + i] * Window[i];
+		}
+		for (int32 i = 0; i < HistoryWritePos; ++i)
+		{
+			FrameBuffer[NumTail + i] = History[i] * Window[NumTail + i];
+		}
+
+		FFT->ForwardRealToComplex(FrameBuffer.GetData(), ComplexBuffer.GetData());
+		Audio::ArrayComplexToPowerInterleaved(ComplexBuffer, PowerSpectrum);
+
+		const int32 NumBins = PowerSpectrum.Num();
+		float PowerSum = 0.f;
+		float MagnitudeSum = 0.f;
+		float WeightedFrequencySum = 0.f;
+		float LogPowerSum = 0.f;
+		for (int32 Bin = 0; Bin < NumBins; ++Bin)
+		{
+			const float Power = PowerSpectrum[Bin];
+			const float Magnitude = FMath::Sqrt(Power);
+			Magnitudes[Bin] = Magnitude;
+			PowerSum += Power;
+			MagnitudeSum += Magnitude;
+			WeightedFrequencySum += Bin * BinWidthHz * Magnitude;
+			LogPowerSum += FMath::Loge(Power + 1e-20f);
+		}
+
+		if (MagnitudeSum <= UE_SMALL_NUMBER)
+		{
+			// Silence: report a flat, static spectrum at 0 Hz
+			Features = FSpectralFeatures();
+			FMemory::Memzero(PrevMagnitudes.GetData(), PrevMagnitudes.Num() * sizeof(float));
+			return;
+		}
+
+		Features.CentroidHz = WeightedFrequencySum / MagnitudeSum;
+
+		// Geometric over arithmetic mean of the power spectrum
+		const float PowerMean = PowerSum / NumBins;
+		Features.Flatness = FMath::Clamp(FMath::Exp(LogPowerSum / NumBins) / PowerMean, 0.f, 1.f);
+
+		// Flux on magnitudes normalised by their sum, so it follows timbre rather than level
+		const float InvMagnitudeSum = 1.f / MagnitudeSum;
+		float Flux = 0.f;
+		for (int32 Bin = 0; Bin < NumBins; ++Bin)
+		{
+			const float Normalized = Magnitudes[Bin] * InvMagnitudeSum;
+			const float Rise = Normalized - PrevMagnitudes[Bin];
+			Flux += Rise > 0.f ? Rise * Rise : 0.f;
+			PrevMagnitudes[Bin] = Normalized;
+		}
+		Features.Flux = FMath::Sqrt(Flux);
+
+		const float RolloffEnergy = FMath::Clamp(RolloffPercent, 0.f, 1.f) * PowerSum;
+		float CumulativeEnergy = 0.f;
+		int32 RolloffBin = NumBins - 1;
+		for (int32 Bin = 0; Bin < NumBins; ++Bin)
+		{
+			CumulativeEnergy += PowerSpectrum[Bin];
+			if (CumulativeEnergy >= RolloffEnergy)
+			{
+				RolloffBin = Bin;
+				break;
+			}
+		}
+		Features.RolloffHz = RolloffBin * BinWidthHz;
+	}
+
+	FSpectralFeaturesChannel::FSpectralFeaturesChannel(float SampleRate, int32 FramesPerBlock, uint32 NumBlocks, int32 FFTSize, int32 HopSize)
+		: Blocks(FramesPerBlock, NumBlocks),
+		Analyzer(SampleRate, FFTSize, HopSize)
+	{
+	}
+
+	void FSpectralFeaturesChannel::Reset()
+	{
+		bResetPending = true;
+		CentroidHz.store(0.f, std::memory_order_relaxed);
+		Flux.store(0.f, std::memory_order_relaxed);
+		RolloffHz.store(0.f, std::memory_order_relaxed);
+		Flatness.store(0.f, std::memory_order_relaxed);
+	}
+
+	void FSpectralFeaturesChannel::ProcessQueued()
+	{
+		bool bUpdated = false;
+		Blocks.Consume([this, &bUpdated](const float* Samples, int32 NumFrames, const FBlockInfo& Block)
+			{
+				if (Block.bReset)
+				{
+					Analyzer.Reset();
+					Features = FSpectralFeatures();
+				}
+				bUpdated |= Analyzer.ProcessBlock(Samples, NumFrames, Block.RolloffPercent, Features);
+			});
+
+		if (bUpdated)
+		{
+			CentroidHz.store(Features.CentroidHz, std::memory_order_relaxed);
+			Flux.store(Features.Flux, std::memory_order_relaxed);
+			RolloffHz.store(Features.RolloffHz, std::memory_order_relaxed);
+			Flatness.store(Features.Flatness, std::memory_order_relaxed);
+		}
+	}
+
+	FSpectralFeaturesOperator::FSpectralFeaturesOperator(const FOperatorSettings& InSettings,
+		const FAudioBufferReadRef& InAudio,
+		const FInt32ReadRef& InFFTSize,
+		const FInt32ReadRef& InHopSize,
+		const FFloatReadRef& InRolloffPercent,
+		const FSpectralFeaturesChannelPtr& InAnalysisChannel)
+		: AudioInput(InAudio),
+		FFTSizeInput(InFFTSize),
+		HopSizeInput(InHopSize),
+		RolloffPercent(InRolloffPercent),
+		CentroidOutput(FFloatWriteRef::CreateNew(0.f)),
+		FluxOutput(FFloatWriteRef::CreateNew(0.f)),
+		RolloffOutput(FFloatWriteRef::CreateNew(0.f)),
+		FlatnessOutput(FFloatWriteRef::CreateNew(0.f)),
+		AnalysisChannel(InAnalysisChannel)
+	{
+		if (!AnalysisChannel)
+		{
+			Analyzer = MakeUnique<FSpectralFeaturesAnalyzer>(InSettings.GetSampleRate(), *FFTSizeInput, *HopSizeInput);
+		}
+	};
+
+	FSpectralFeaturesOperator::~FSpectralFeaturesOperator() = default;
+
+	void FSpectralFeaturesOperator::Execute()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_MetaSoundsSPL_SpectralFeaturesExecute);
+		MSUTILS_EXECUTE_SCOPE(TEXT("Spectral Features"));
+
+		const float* InData = AudioInput->GetData();
+		const int32 NumFrames = AudioInput->Num();
+
+		if (AnalysisChannel)
+		{
+			// The FFT runs on the analysis worker. A block that doesn't fit is skipped, leaving a gap in the history.
+			if (!AnalysisChannel->Push(InData, NumFrames, *RolloffPercent))
+			{
+				INC_DWORD_STAT(STAT_MetaSoundsSPL_SpectralFeaturesSkippedBlocks);
+			}
+			Features = AnalysisChannel->GetFeatures();
+		}
+		else
+		{
+			Analyzer->ProcessBlock(InData, NumFrames, *RolloffPercent, Features);
+		}
+
+		*CentroidOutput = Features.CentroidHz;
+		*FluxOutput = Features.Flux;
+		*RolloffOutput = Features.RolloffHz;
+		*FlatnessOutput = Features.Flatness;
+	}
+
+	void FSpectralFeaturesOperator::Reset(const IOperator::FResetParams& InParams)
+	{
+		if (AnalysisChannel)
+		{
+			AnalysisChannel->Reset();
+		}
+		else
+		{
+			Analyzer->Reset();
+		}
+
+		Features = FSpectralFeatures();
+		*CentroidOutput = 0.f;
+		*FluxOutput = 0.f;
+		*RolloffOutput = 0.f;
+		*FlatnessOutput = 0.f;
+	}
+
+	const FVertexInterface& FSpectralFeaturesOperator::DeclareVertexInterface()
+	{
+		using namespace SpectralFeaturesNodeNames;
+
+		static const FVertexInterface Interface(
+			FInputVertexInterface(
+				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InAudioParam)),
+				TInputDataVertexModel<int32>(METASOUND_GET_PARAM_NAME_AND_METADATA(InFFTSizeParam), 1024),
+				TInputDataVertexModel<int32>(METASOUND_GET_PARAM_NAME_AND_METADATA(InHopSizeParam), 512),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InRolloffPercentParam), 0.85f)
+			),
+			FOutputVertexInterface(
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutCentroidParam)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutFluxParam)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutRolloffParam)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutFlatnessParam))
+			)
+		);
+
+		return Interface;
+	};
+
+	const FNodeClassMetadata& FSpectralFeaturesOperator::GetNodeInfo()
+	{
+		auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+			{
+				FVertexInterface NodeInterface = DeclareVertexInterface();
+
+				FNodeClassMetadata Metadata
+				{
+						{ TEXT("MetaSoundsSPL"), TEXT("Spectral Features"), TEXT("Audio") },
+						1, // Major Version
+						0, // Minor Version
+						METASOUND_LOCTEXT("SpectralFeaturesDisplayName", "Spectral Features"),
+						METASOUND_LOCTEXT("SpectralFeaturesNodeDesc", "Returns the spectral centroid, flux, rolloff and flatness of incoming sound, updated every hop"),
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ },
+						{ },
+						FNodeDisplayStyle{}
+				};
+
+				return Metadata;
+			};
+
+		static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+		return Metadata;
+	};
+
+	void FSpectralFeaturesOperator::BindInputs(FInputVertexInterfaceData& InOutVertexData)
+	{
+		using namespace SpectralFeaturesNodeNames;
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InAudioParam), AudioInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InFFTSizeParam), FFTSizeInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InHopSizeParam), HopSizeInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InRolloffPercentParam), RolloffPercent);
+	}
+
+	void FSpectralFeaturesOperator::BindOutputs(FOutputVertexInterfaceData& InOutVertexData)
+	{
+		using namespace SpectralFeaturesNodeNames;
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutCentroidParam), CentroidOutput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutFluxParam), FluxOutput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutRolloffParam), RolloffOutput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutFlatnessParam), FlatnessOutput);
+	}
+
+	TUniquePtr<IOperator> FSpectralFeaturesOperator::CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors)
+	{
+		using namespace SpectralFeaturesNodeNames;
+
+		const Metasound::FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+		const Metasound::FInputVertexInterface& InputInterface = DeclareVertexInterface().GetInputInterface();
+
+		FAudioBufferReadRef AudioIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InAudioParam), InParams.OperatorSettings);
+		FInt32ReadRef FFTSizeIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<int32>(InputInterface, METASOUND_GET_PARAM_NAME(InFFTSizeParam), InParams.OperatorSettings);
+		FInt32ReadRef HopSizeIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<int32>(InputInterface, METASOUND_GET_PARAM_NAME(InHopSizeParam), InParams.OperatorSettings);
+		FFloatReadRef RolloffPercentIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InRolloffPercentParam), InParams.OperatorSettings);
+
+		FSpectralFeaturesChannelPtr AnalysisChannel;
+		if (FSPLAnalysisPipeline::IsEnabled())
+		{
+			AnalysisChannel = MakeShared<FSpectralFeaturesChannel, ESPMode::ThreadSafe>(InParams.OperatorSettings.GetSampleRate(), InParams.OperatorSettings.GetNumFramesPerBlock(),
+				FSPLAnalysisPipeline::GetQueueBlocks(), *FFTSizeIn, *HopSizeIn);
+			FSPLAnalysisPipeline::AddChannel(AnalysisChannel);
+		}
+
+		//this class is FSpectralFeaturesOperator, which inherits from TExecutableOperator, which inherits from IOperator. IOperator type is returned
+		return MakeUnique<FSpectralFeaturesOperator>(InParams.OperatorSettings, AudioIn, FFTSizeIn, HopSizeIn, RolloffPercentIn, AnalysisChannel);
+	}
+
+	// Register node
+	METASOUND_REGISTER_NODE(FSpectralFeaturesNode);
+}
+
+#undef LOCTEXT_NAMESPACE
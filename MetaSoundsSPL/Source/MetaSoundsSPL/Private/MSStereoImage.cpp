@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MSStereoImage.h"
+#include "MetaSoundsSPL.h"
+
+#include "Math/VectorRegister.h"
+
+#define LOCTEXT_NAMESPACE "MetasoundStandardNodes_MetaSoundStereoImage"
+
+DECLARE_CYCLE_STAT(TEXT("Stereo Image Execute"), STAT_MetaSoundsSPL_StereoImageExecute, STATGROUP_MetaSoundsSPL);
+
+namespace Metasound
+{
+	//the below stores name and tooltip information for each input/output pin.
+	//this is then retrieved with METASOUND_GET_PARAM_NAME_AND_METADATA.
+	namespace StereoImageNodeNames
+	{
+		METASOUND_PARAM(InLeftParam, "In Left", "Left channel");
+		METASOUND_PARAM(InRightParam, "In Right", "Right channel");
+		METASOUND_PARAM(InIntegrationTimeParam, "Integration Time", "Seconds of audio the outputs are measured over, like a meter's time weighting. 0.125 matches Fast and 1 matches Slow. Read when the node is created.");
+		METASOUND_PARAM(OutCorrelationParam, "Correlation", "Phase correlation from -1 (out of phase) through 0 (unrelated) to 1 (mono). 0 while either channel is silent.");
+		METASOUND_PARAM(OutBalanceParam, "Balance", "Energy balance from -1 (left only) to 1 (right only). 0 when centred or silent.");
+		METASOUND_PARAM(OutMidSideRatioParam, "Mid Side Ratio", "Mid energy over side energy in dB, limited to +/-60 dB. Negative values lose level when summed to mono. 0 when silent.");
+	}
+
+	namespace StereoImagePrivate
+	{
+		// Channels below -100 dBFS are treated as silent
+		static constexpr double MinMeanSquare = 1e-10;
+
+		// Keeps Mid Side Ratio finite for pure mono or pure side signals
+		static constexpr double MaxRatio = 1e6;
+
+		// L*L, R*R and L*R over a block in one pass, four frames at a time
+		static void AccumulateProducts(const float* Left, const float* Right, int32 NumFrames, float& OutLL, float& OutRR, float& OutLR)
+		{
+			VectorRegister4Float LL = VectorZeroFloat();
+			VectorRegister4Float RR = VectorZeroFloat();
+			VectorRegister4Float LR = VectorZeroFloat();
+
+			const int32 NumVectorFrames = NumFrames & ~3;
+			for (int32 i = 0; i < NumVectorFrames; i += 4)
+			{
+				const VectorRegister4Float L = VectorLoad(Left + i);
+				const VectorRegister4Float R = VectorLoad(Right + i);
+				LL = VectorMultiplyAdd(L, L, LL);
+				RR = VectorMultiplyAdd(R, R, RR);
+				LR = VectorMultiplyAdd(L, R, LR);
+			}
+
+			alignas(16) float Lanes[3][4];
+			VectorStoreAligned(LL, Lanes[0]);
+			VectorStoreAligned(RR, Lanes[1]);
+			VectorStoreAligned(LR, Lanes[2]);
+			OutLL = Lanes[0][0] + Lanes[0][1] + Lanes[0][2] + Lanes[0][3];
+			OutRR = Lanes[1][0] + Lanes[1][1] + Lanes[1][2] + Lanes[1][3];
+			OutLR = Lanes[2][0] + Lanes[2][1] + Lanes[2][2] + Lanes[2][3];
+
+			for (int32 i = NumVectorFrames; i < NumFrames; ++i)
+			{
+				OutLL += Left[i] * Left[i];
+				OutRR += Right[i] * Right[i];
+				OutLR += Left[i] * Right[i];
+			}
+		}
+	}
+
+	FStereoImageOperator::FStereoImageOperator(const FOperatorSettings& InSettings,
+		const FAudioBufferReadRef& InLeft,
+		const FAudioBufferReadRef& InRight,
+		const FFloatReadRef& InIntegrationTime)
+		: LeftInput(InLeft),
+		RightInput(InRight),
+		IntegrationTime(InIntegrationTime),
+		CorrelationOutput(FFloatWriteRef::CreateNew(0.f)),
+		BalanceOutput(FFloatWriteRef::CreateNew(0.f)),
+		MidSideRatioOutput(FFloatWriteRef::CreateNew(0.f)),
+		NumFramesPerBlock(InSettings.GetNumFramesPerBlock())
+	{
+		// The window holds whole blocks, so it is at least one block long
+		const float IntegrationSeconds = FMath::Clamp(*IntegrationTime, 0.f, 10.f);
+		NumWindowBlocks = FMath::Max(FMath::RoundToInt(IntegrationSeconds * InSettings.GetSampleRate() / FMath::Max(NumFramesPerBlock, 1)), 1);
+		Window.AddDefaulted(NumWindowBlocks);
+	};
+
+	FStereoImageOperator::~FStereoImageOperator() = default;
+
+	void FStereoImageOperator::Execute()
+	{
+		using namespace StereoImagePrivate;
+
+		SCOPE_CYCLE_COUNTER(STAT_MetaSoundsSPL_StereoImageExecute);
+		MSUTILS_EXECUTE_SCOPE(TEXT("Stereo Image"));
+
+		FBlockSums Block;
+		AccumulateProducts(LeftInput->GetData(), RightInput->GetData(), FMath::Min(LeftInput->Num(), RightInput->Num()), Block.LL, Block.RR, Block.LR);
+
+		// Swap the oldest block for the new one
+		FBlockSums& Slot = Window[WindowWritePos];
+		if (NumFilledBlocks == NumWindowBlocks)
+		{
+			SumLL -= Slot.LL;
+			SumRR -= Slot.RR;
+			SumLR -= Slot.LR;
+		}
+		else
+		{
+			++NumFilledBlocks;
+		}
+		Slot = Block;
+		SumLL += Block.LL;
+		SumRR += Block.RR;
+		SumLR += Block.LR;
+
+		if (++WindowWritePos == NumWindowBlocks)
+		{
+			WindowWritePos = 0;
+
+			// Once per window, so still constant cost per block
+			SumLL = SumRR = SumLR = 0.0;
+			for (const FBlockSums& Sums : Window)
+			{
+				SumLL += Sums.LL;
+				SumRR += Sums.RR;
+				SumLR += Sums.LR;
+			}
+		}
+
+		UpdateOutputs();
+	}
+
+	void FStereoImageOperator::UpdateOutputs()
+	{
+		using namespace StereoImagePrivate;
+
+		const double MinSum = MinMeanSquare * NumFilledBlocks * NumFramesPerBlock;
+		const double Energy = SumLL + SumRR;
+		if (Energy < MinSum)
+		{
+			*CorrelationOutput = 0.f;
+			*BalanceOutput = 0.f;
+			*MidSideRatioOutput = 0.f;
+			return;
+		}
+
+		*CorrelationOutput = (SumLL < MinSum || SumRR < MinSum) ? 0.f : (float)FMath::Clamp(SumLR / FMath::Sqrt(SumLL * SumRR), -1.0, 1.0);
+		*BalanceOutput = (float)FMath::Clamp((SumRR - SumLL) / Energy, -1.0, 1.0);
+
+		// Mid and side are (L + R) / 2 and (L - R) / 2. Their energies come from the same three sums, and the
+		// common factor of 1/4 cancels in the ratio.
+		const double MidEnergy = FMath::Max(Energy + 2.0 * SumLR, Energy / MaxRatio);
+		const double SideEnergy = FMath::Max(Energy - 2.0 * SumLR, Energy / MaxRatio);
+		*MidSideRatioOutput = (float)(10.0 * FMath::LogX(10.0, MidEnergy / SideEnergy));
+	}
+
+	const FVertexInterface& FStereoImageOperator::DeclareVertexInterface()
+	{
+		using namespace StereoImageNodeNames;
+
+		static const FVertexInterface Interface(
+			FInputVertexInterface(
+				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InLeftParam)),
+				TInputDataVertexModel<FAudioBuffer>(METASOUND_GET_PARAM_NAME_AND_METADATA(InRightParam)),
+				TInputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(InIntegrationTimeParam), 1.f)
+			),
+			FOutputVertexInterface(
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutCorrelationParam)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutBalanceParam)),
+				TOutputDataVertexModel<float>(METASOUND_GET_PARAM_NAME_AND_METADATA(OutMidSideRatioParam))
+			)
+		);
+
+		return Interface;
+	};
+
+	const FNodeClassMetadata& FStereoImageOperator::GetNodeInfo()
+	{
+		auto CreateNodeClassMetadata = []() -> FNodeClassMetadata
+			{
+				FVertexInterface NodeInterface = DeclareVertexInterface();
+
+				FNodeClassMetadata Metadata
+				{
+						{ TEXT("UE"), TEXT("Stereo Image Meter"), TEXT("Audio") },
+						1, // Major Version
+						0, // Minor Version
+						METASOUND_LOCTEXT("StereoImageDisplayName", "Stereo Image Meter"),
+						METASOUND_LOCTEXT("StereoImageNodeDesc", "Returns the phase correlation, balance and mid/side ratio of a stereo pair over a sliding window, for checking mono compatibility"),
+						PluginAuthor,
+						PluginNodeMissingPrompt,
+						NodeInterface,
+						{ },
+						{ },
+						FNodeDisplayStyle{}
+				};
+
+				return Metadata;
+			};
+
+		static const FNodeClassMetadata Metadata = CreateNodeClassMetadata();
+		return Metadata;
+	};
+
+	void FStereoImageOperator::BindInputs(FInputVertexInterfaceData& InOutVertexData)
+	{
+		using namespace StereoImageNodeNames;
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InLeftParam), LeftInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InRightParam), RightInput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(InIntegrationTimeParam), IntegrationTime);
+	}
+
+	void FStereoImageOperator::BindOutputs(FOutputVertexInterfaceData& InOutVertexData)
+	{
+		using namespace StereoImageNodeNames;
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutCorrelationParam), CorrelationOutput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutBalanceParam), BalanceOutput);
+		InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(OutMidSideRatioParam), MidSideRatioOutput);
+	}
+
+	TUniquePtr<IOperator> FStereoImageOperator::CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors)
+	{
+		using namespace StereoImageNodeNames;
+
+		const Metasound::FDataReferenceCollection& InputCollection = InParams.InputDataReferences;
+		const Metasound::FInputVertexInterface& InputInterface = DeclareVertexInterface().GetInputInterface();
+
+		FAudioBufferReadRef LeftIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InLeftParam), InParams.OperatorSettings);
+		FAudioBufferReadRef RightIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<FAudioBuffer>(InputInterface, METASOUND_GET_PARAM_NAME(InRightParam), InParams.OperatorSettings);
+		FFloatReadRef IntegrationTimeIn = InputCollection.GetDataReadReferenceOrConstructWithVertexDefault<float>(InputInterface, METASOUND_GET_PARAM_NAME(InIntegrationTimeParam), InParams.OperatorSettings);
+
+		//this class is FStereoImageOperator, which inherits from TExecutableOperator, which inherits from IOperator. IOperator type is returned
+		return MakeUnique<FStereoImageOperator>(InParams.OperatorSettings, LeftIn, RightIn, IntegrationTimeIn);
+	}
+
+	// Register node
+	METASOUND_REGISTER_NODE(FStereoImageNode);
+}
+
+#undef LOCTEXT_NAMESPACE
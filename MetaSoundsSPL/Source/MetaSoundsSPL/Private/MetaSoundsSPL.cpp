@@ -6,6 +6,10 @@
 #include "MetasoundPrimitives.h"
 #include "MetasoundTime.h"
 #include "MetasoundNodeRegistrationMacro.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/ConfigUtilities.h"
+#include "SPLAnalysisPipeline.h"
+#include "SPLMeterLog.h"
 
 
 #define LOCTEXT_NAMESPACE "FMetaSoundsSPLModule"
@@ -14,12 +18,19 @@ void FMetaSoundsSPLModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
 	FMetasoundFrontendRegistryContainer::Get()->RegisterPendingNodes();
+
+	// Per-platform meter quality. GEngineIni is layered per platform, so Config/<Platform>/<Platform>Engine.ini can
+	// override the project's [MetaSoundsSPL.Quality] values. Device profiles and the console still take priority.
+	UE::ConfigUtilities::ApplyCVarSettingsFromIni(TEXT("MetaSoundsSPL.Quality"), *GEngineIni, ECVF_SetByProjectSetting);
 }
 
 void FMetaSoundsSPLModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	// The analysis worker pushes log readings, so it finishes first
+	Metasound::FSPLAnalysisPipeline::Shutdown();
+	Metasound::FSPLMeterLog::Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
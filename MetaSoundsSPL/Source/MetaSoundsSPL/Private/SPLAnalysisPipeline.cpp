@@ -0,0 +1,279 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SPLAnalysisPipeline.h"
+#include "MetaSoundsSPL.h"
+#include "SPLChannelWorker.h"
+
+#if WITH_MS_UTILS
+#include "MSUtilsKernels.h"
+#endif
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+
+DECLARE_CYCLE_STAT(TEXT("SPL Analysis Worker"), STAT_MetaSoundsSPL_AnalysisWorker, STATGROUP_MetaSoundsSPL);
+
+static int32 SPLAnalysisOffload = 0;
+static FAutoConsoleVariableRef CVarSPLAnalysisOffload(
+	TEXT("au.MetaSoundsSPL.Analysis.Offload"),
+	SPLAnalysisOffload,
+	TEXT("Run the analysis of SPL meters and Spectral Features nodes created from now on off the render thread. 0: off (default), 1: on."),
+	ECVF_Default);
+
+static int32 SPLAnalysisQueueBlocks = 32;
+static FAutoConsoleVariableRef CVarSPLAnalysisQueueBlocks(
+	TEXT("au.MetaSoundsSPL.Analysis.QueueBlocks"),
+	SPLAnalysisQueueBlocks,
+	TEXT("Audio blocks each offloaded node can queue. When full, a meter measures on the render thread at reduced quality until the worker catches up, and Spectral Features skips the block."),
+	ECVF_Default);
+
+static float SPLAnalysisIntervalMs = 2.f;
+static FAutoConsoleVariableRef CVarSPLAnalysisIntervalMs(
+	TEXT("au.MetaSoundsSPL.Analysis.IntervalMs"),
+	SPLAnalysisIntervalMs,
+	TEXT("Milliseconds between analysis worker passes. Bounds how far offloaded meter outputs lag the audio."),
+	ECVF_Default);
+
+static int32 SPLAnalysisFallbackWeightingOrder = 2;
+static FAutoConsoleVariableRef CVarSPLAnalysisFallbackWeightingOrder(
+	TEXT("au.MetaSoundsSPL.Analysis.FallbackWeightingOrder"),
+	SPLAnalysisFallbackWeightingOrder,
+	TEXT("Highest A-weighting order an offloaded meter uses while measuring on the render thread after its queue overflowed."),
+	ECVF_Default);
+
+namespace Metasound
+{
+	void FSPLMeterAnalyzer::Init(float InSampleRate, int32 InFramesPerBlock, float UpdateIntervalMs, int32 WeightingOrder)
+	{
+		SampleRate = InSampleRate;
+
+		WeightingFilter.Init(InSampleRate, WeightingOrder);
+		WeightedBuffer.Reset();
+		if (WeightingFilter.GetOrder() > 0)
+		{
+			WeightedBuffer.AddZeroed(InFramesPerBlock);
+		}
+
+		// Updates land on block boundaries, so the interval is at least one block
+		FramesPerUpdate = FMath::Max(FMath::RoundToInt(UpdateIntervalMs * 0.001f * InSampleRate), InFramesPerBlock);
+
+		Reset();
+	}
+
+	bool FSPLMeterAnalyzer::ProcessBlock(const float* Samples, int32 NumFrames, float PercentileWindowSeconds, FSPLMeterResults& Results)
+	{
+		if (WeightingFilter.GetOrder() > 0)
+		{
+			WeightingFilter.ProcessAudio(Samples, WeightedBuffer.GetData(), NumFrames);
+			Samples = WeightedBuffer.GetData();
+		}
+
+#if WITH_MS_UTILS
+		SumOfSquares += MSUtilsKernels::SumOfSquares(MakeArrayView(Samples, NumFrames));
+#else
+		float BlockSumOfSquares = 0.f;
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			BlockSumOfSquares += Samples[i] * Samples[i];
+		}
+		SumOfSquares += BlockSumOfSquares;
+#endif
+		FramesAccumulated += NumFrames;
+
+		if (FramesAccumulated < FramesPerUpdate)
+		{
+			return false;
+		}
+
+		Results.LevelDb = TakeLevel();
+		AddLevel(Results.LevelDb, LastUpdateFrames, PercentileWindowSeconds, Results);
+		return true;
+	}
+
+	bool FSPLMeterAnalyzer::Flush(FSPLMeterResults& Results)
+	{
+		const bool bHasLevel = FramesAccumulated > 0;
+		if (bHasLevel)
+		{
+			Results.LevelDb = TakeLevel();
+			LevelHistogram.Add(Results.LevelDb);
+		}
+
+		if (LevelHistogram.Num() > 0)
+		{
+			PublishPercentiles(Results);
+		}
+
+		return bHasLevel;
+	}
+
+	void FSPLMeterAnalyzer::Reset()
+	{
+		WeightingFilter.Reset();
+		LevelHistogram.Reset();
+		FramesAccumulated = 0;
+		LastUpdateFrames = 0;
+		SumOfSquares = 0.f;
+		FramesInWindow = 0;
+	}
+
+	void FSPLMeterAnalyzer::AddLevel(float LevelDb, int32 NumFrames, float PercentileWindowSeconds, FSPLMeterResults& Results)
+	{
+		LevelHistogram.Add(LevelDb);
+		FramesInWindow += NumFrames;
+
+		const int32 WindowFrames = FMath::Max(FMath::RoundToInt(PercentileWindowSeconds * SampleRate), 1);
+		if (FramesInWindow >= WindowFrames)
+		{
+			PublishPercentiles(Results);
+		}
+	}
+
+	float FSPLMeterAnalyzer::TakeLevel()
+	{
+		const float MeanSquare = SumOfSquares / FramesAccumulated;
+
+		LastUpdateFrames = FramesAccumulated;
+		SumOfSquares = 0.f;
+		FramesAccumulated = 0;
+
+		return 10.f * FMath::LogX(10.f, FMath::Max(MeanSquare, 1e-12f));
+	}
+
+	void FSPLMeterAnalyzer::PublishPercentiles(FSPLMeterResults& Results)
+	{
+		static const float Fractions[] = { 0.1f, 0.5f, 0.9f };
+		float Levels[UE_ARRAY_COUNT(Fractions)];
+		LevelHistogram.GetExceededLevels(Fractions, Levels);
+
+		Results.L10Db = Levels[0];
+		Results.L50Db = Levels[1];
+		Results.L90Db = Levels[2];
+
+		LevelHistogram.Reset();
+		FramesInWindow = 0;
+	}
+
+	FSPLAnalysisChannel::FSPLAnalysisChannel(float InSampleRate, int32 InFramesPerBlock, uint32 InNumBlocks, const FSPLMeterSettings& InMeterSettings, const FSPLMeterLogChannelPtr& InLogChannel)
+		: Blocks(InFramesPerBlock, InNumBlocks),
+		FallbackLevels(InNumBlocks),
+		LogChannel(InLogChannel),
+		SampleRate(InSampleRate)
+	{
+		Analyzer.Init(InSampleRate, InFramesPerBlock, InMeterSettings.UpdateIntervalMs, InMeterSettings.WeightingOrder);
+	}
+
+	void FSPLAnalysisChannel::ProcessQueued()
+	{
+		const uint32 NumBlocks = Blocks.Consume([this](const float* Samples, int32 NumFrames, const FBlockInfo& Block)
+			{
+				if (Analyzer.ProcessBlock(Samples, NumFrames, Block.PercentileWindowSeconds, Results) && LogChannel)
+				{
+					LogChannel->Push({ (float)((Block.StartFrame + NumFrames) / SampleRate), Results.LevelDb, Results.L10Db, Results.L50Db, Results.L90Db });
+				}
+			});
+
+		// Levels the meter measured itself while the ring was full. They follow the queued blocks in time.
+		bool bFallback = false;
+		FFallbackLevel Fallback;
+		while (FallbackLevels.Dequeue(Fallback))
+		{
+			Analyzer.AddLevel(Fallback.LevelDb, Fallback.NumFrames, Fallback.PercentileWindowSeconds, Results);
+			bFallback = true;
+		}
+
+		if (NumBlocks == 0 && !bFallback)
+		{
+			return;
+		}
+
+		LevelDb.store(Results.LevelDb, std::memory_order_relaxed);
+		L10Db.store(Results.L10Db, std::memory_order_relaxed);
+		L50Db.store(Results.L50Db, std::memory_order_relaxed);
+		L90Db.store(Results.L90Db, std::memory_order_relaxed);
+	}
+
+	// Runs the analysis for every offloaded node
+	class FSPLAnalysisWorker : public TSPLChannelWorker<ISPLAnalysisChannel>
+	{
+	public:
+		FSPLAnalysisWorker()
+		{
+			StartThread(TEXT("SPLAnalysisWorker"));
+		}
+
+		virtual ~FSPLAnalysisWorker()
+		{
+			StopThread();
+		}
+
+	protected:
+		virtual float GetIntervalMs() const override
+		{
+			return FMath::Max(SPLAnalysisIntervalMs, 0.5f);
+		}
+
+		virtual void DrainChannel(ISPLAnalysisChannel& Channel) override
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MetaSoundsSPL_AnalysisWorker);
+			Channel.ProcessQueued();
+		}
+	};
+
+	namespace SPLAnalysisPipelinePrivate
+	{
+		static FCriticalSection WorkerLock;
+		static TUniquePtr<FSPLAnalysisWorker> Worker;
+	}
+
+	bool FSPLAnalysisPipeline::IsEnabled()
+	{
+		return SPLAnalysisOffload != 0;
+	}
+
+	uint32 FSPLAnalysisPipeline::GetQueueBlocks()
+	{
+		return FMath::Max(SPLAnalysisQueueBlocks, 2);
+	}
+
+	FSPLAnalysisChannelPtr FSPLAnalysisPipeline::OpenChannel(float SampleRate, int32 FramesPerBlock, const FSPLMeterSettings& MeterSettings, const FSPLMeterLogChannelPtr& LogChannel)
+	{
+		if (!IsEnabled())
+		{
+			return nullptr;
+		}
+
+		FSPLAnalysisChannelPtr Channel = MakeShared<FSPLAnalysisChannel, ESPMode::ThreadSafe>(SampleRate, FramesPerBlock, GetQueueBlocks(), MeterSettings, LogChannel);
+		AddChannel(Channel);
+		return Channel;
+	}
+
+	void FSPLAnalysisPipeline::AddChannel(const FSPLAnalysisChannelBasePtr& Channel)
+	{
+		using namespace SPLAnalysisPipelinePrivate;
+
+		// Only taken when an operator is created, never from Execute
+		MSUTILS_NOTE_LOCK(TEXT("SPLAnalysis WorkerLock"));
+		FScopeLock Lock(&WorkerLock);
+		if (!Worker)
+		{
+			Worker = MakeUnique<FSPLAnalysisWorker>();
+		}
+		Worker->AddChannel(Channel);
+	}
+
+	int32 FSPLAnalysisPipeline::GetFallbackWeightingOrder(int32 WeightingOrder)
+	{
+		return FMath::Clamp(SPLAnalysisFallbackWeightingOrder, 0, WeightingOrder);
+	}
+
+	void FSPLAnalysisPipeline::Shutdown()
+	{
+		using namespace SPLAnalysisPipelinePrivate;
+
+		MSUTILS_NOTE_LOCK(TEXT("SPLAnalysis WorkerLock"));
+		FScopeLock Lock(&WorkerLock);
+		Worker.Reset();
+	}
+}
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+
+#include <atomic>
+
+	//------------------------------------------------------------------------------------
+	// TSPLChannelWorker
+	//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// A dedicated background thread that drains render thread channels, shared by the meter log writer and the analysis
+	// worker. New channels arrive through a lock-free queue, and every channel is drained on this thread each interval.
+	// A channel is closed once its owner has released it and it has been drained one last time.
+	//
+	// This is a long-lived FRunnable that polls, not task graph tasks, because launching a task per block would
+	// allocate on the render thread. Derived workers call StartThread at the end of their constructor and StopThread
+	// at the start of their destructor, so the thread never calls into a partly built or destroyed worker.
+	template<typename ChannelType>
+	class TSPLChannelWorker : public FRunnable
+	{
+	public:
+		using FChannelPtr = TSharedPtr<ChannelType, ESPMode::ThreadSafe>;
+
+		virtual ~TSPLChannelWorker()
+		{
+			check(!Thread);
+		}
+
+		void AddChannel(const FChannelPtr& Channel)
+		{
+			NewChannels.Enqueue(Channel);
+		}
+
+		//~ Begin FRunnable Interface
+		virtual uint32 Run() override
+		{
+			while (!bStopping.load())
+			{
+				Drain();
+				FPlatformProcess::Sleep(GetIntervalMs() * 0.001f);
+			}
+			Drain();
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopping.store(true);
+		}
+		//~ End FRunnable Interface
+
+	protected:
+		void StartThread(const TCHAR* ThreadName)
+		{
+			Thread = FRunnableThread::Create(this, ThreadName, 0, TPri_BelowNormal);
+		}
+
+		// Drains anything still queued and waits for the thread to exit
+		void StopThread()
+		{
+			if (Thread)
+			{
+				Thread->Kill(true);
+				delete Thread;
+				Thread = nullptr;
+			}
+		}
+
+		// Milliseconds between passes, read before each sleep
+		virtual float GetIntervalMs() const = 0;
+
+		virtual void OnChannelAdded(ChannelType& Channel) {}
+
+		// Consumes everything queued on the channel
+		virtual void DrainChannel(ChannelType& Channel) = 0;
+
+		// Called after every pass over the channels
+		virtual void OnDrained() {}
+
+	private:
+		void Drain()
+		{
+			FChannelPtr NewChannel;
+			while (NewChannels.Dequeue(NewChannel))
+			{
+				OnChannelAdded(*NewChannel);
+				Channels.Add(MoveTemp(NewChannel));
+			}
+
+			for (int32 i = Channels.Num() - 1; i >= 0; --i)
+			{
+				// Checked before draining so anything pushed just before the owner released the channel is not missed
+				const bool bClosed = Channels[i].IsUnique();
+
+				DrainChannel(*Channels[i]);
+
+				if (bClosed)
+				{
+					Channels.RemoveAtSwap(i);
+				}
+			}
+
+			OnDrained();
+		}
+
+		FRunnableThread* Thread = nullptr;
+		std::atomic<bool> bStopping { false };
+
+		TQueue<FChannelPtr, EQueueMode::Mpsc> NewChannels;
+		TArray<FChannelPtr> Channels;
+	};
+}
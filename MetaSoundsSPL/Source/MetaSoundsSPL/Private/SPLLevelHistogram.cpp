@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SPLLevelHistogram.h"
+
+namespace Metasound
+{
+	FSPLLevelHistogram::FSPLLevelHistogram()
+	{
+		Bins.AddZeroed(NumBins);
+	}
+
+	void FSPLLevelHistogram::Add(float LevelDb)
+	{
+		const int32 Bin = FMath::Clamp(FMath::FloorToInt((LevelDb - MinDb) / BinWidthDb), 0, NumBins - 1);
+		++Bins[Bin];
+		++Count;
+	}
+
+	void FSPLLevelHistogram::Reset()
+	{
+		FMemory::Memzero(Bins.GetData(), Bins.Num() * sizeof(uint32));
+		Count = 0;
+	}
+
+	void FSPLLevelHistogram::GetExceededLevels(TArrayView<const float> Fractions, TArrayView<float> OutLevelsDb) const
+	{
+		check(Fractions.Num() == OutLevelsDb.Num());
+
+		if (Count == 0)
+		{
+			for (float& Level : OutLevelsDb)
+			{
+				Level = MinDb;
+			}
+			return;
+		}
+
+		// Walk down from the loudest bin. A level is exceeded by fraction F once F * Count entries lie above it.
+		int32 Above = 0;
+		int32 NumFound = 0;
+		TArray<bool, TInlineAllocator<8>> Found;
+		Found.Init(false, Fractions.Num());
+
+		for (int32 Bin = NumBins - 1; Bin >= 0 && NumFound < Fractions.Num(); --Bin)
+		{
+			Above += Bins[Bin];
+			for (int32 i = 0; i < Fractions.Num(); ++i)
+			{
+				if (!Found[i] && Above >= Fractions[i] * Count)
+				{
+					OutLevelsDb[i] = MinDb + Bin * BinWidthDb;
+					Found[i] = true;
+					++NumFound;
+				}
+			}
+		}
+
+		for (int32 i = 0; i < Fractions.Num(); ++i)
+		{
+			if (!Found[i])
+			{
+				OutLevelsDb[i] = MinDb;
+			}
+		}
+	}
+}
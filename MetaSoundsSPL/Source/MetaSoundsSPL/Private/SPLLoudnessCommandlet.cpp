@@ -0,0 +1,444 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SPLLoudnessCommandlet.h"
+#include "SPLAnalysisPipeline.h"
+#include "SPLLevelHistogram.h"
+#include "SPLWeightingFilter.h"
+
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Async/ParallelFor.h"
+#include "Dom/JsonObject.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Sound/SoundWave.h"
+#include "UObject/UObjectGlobals.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SPLLoudnessCommandlet)
+
+DEFINE_LOG_CATEGORY_STATIC(LogSPLLoudness, Log, All);
+
+namespace SPLLoudnessCommandlet
+{
+	using namespace Metasound;
+
+	// Bumped when the analysis changes so older manifests are ignored
+	static constexpr int32 ManifestVersion = 2;
+
+	// Update interval of the short-term levels fed to the percentile histogram, matching the meter's low tier
+	static constexpr float UpdateIntervalMs = 100.f;
+
+	static constexpr int32 FramesPerBlock = 1024;
+
+	struct FResult
+	{
+		FString ContentHash;
+		float DurationSeconds = 0.f;
+		float PeakDb = FSPLLevelHistogram::MinDb;
+		float RmsDb = FSPLLevelHistogram::MinDb;
+		float WeightedRmsDb = FSPLLevelHistogram::MinDb;
+		float L10Db = FSPLLevelHistogram::MinDb;
+		float L50Db = FSPLLevelHistogram::MinDb;
+		float L90Db = FSPLLevelHistogram::MinDb;
+		bool bValid = false;
+	};
+
+	struct FJob
+	{
+		FAssetData Asset;
+		FString PackageFilename;
+		FResult Result;
+
+		// Filled on the game thread before analysis and freed after
+		TArray<uint8> RawPCM;
+		uint32 SampleRate = 0;
+		uint16 NumChannels = 0;
+	};
+
+	static float PowerToDb(float Power)
+	{
+		return FMath::Max(10.f * FMath::LogX(10.f, FMath::Max(Power, 1e-12f)), FSPLLevelHistogram::MinDb);
+	}
+
+	static float DbToPower(float LevelDb)
+	{
+		return FMath::Pow(10.f, 0.1f * LevelDb);
+	}
+
+	// Runs each channel through the SPL meter's analyzer, weighted and unweighted, so levels match what an SPL Meter
+	// would report for the asset. Channel energies are summed, and L10/L50/L90 are over the summed levels of the whole
+	// asset.
+	static void Analyze(FJob& Job, int32 WeightingOrder)
+	{
+		const int32 NumChannels = Job.NumChannels;
+		if (NumChannels == 0 || Job.SampleRate == 0)
+		{
+			return;
+		}
+
+		const int16* PCM = reinterpret_cast<const int16*>(Job.RawPCM.GetData());
+		const int32 NumFrames = Job.RawPCM.Num() / (sizeof(int16) * NumChannels);
+		if (NumFrames == 0)
+		{
+			return;
+		}
+
+		const float SampleRate = Job.SampleRate;
+		const float DurationSeconds = NumFrames / SampleRate;
+
+		// The channel analyzers' own percentiles are unused, so their window doesn't matter
+		static constexpr float ChannelPercentileWindowSeconds = 1.f;
+		TArray<FSPLMeterAnalyzer> WeightedAnalyzers;
+		TArray<FSPLMeterAnalyzer> UnweightedAnalyzers;
+		WeightedAnalyzers.SetNum(NumChannels);
+		UnweightedAnalyzers.SetNum(NumChannels);
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			WeightedAnalyzers[Channel].Init(SampleRate, FramesPerBlock, UpdateIntervalMs, WeightingOrder);
+			UnweightedAnalyzers[Channel].Init(SampleRate, FramesPerBlock, UpdateIntervalMs, 0);
+		}
+
+		// Takes the summed levels, with one percentile window covering the asset
+		FSPLMeterAnalyzer SummedAnalyzer;
+		SummedAnalyzer.Init(SampleRate, FramesPerBlock, UpdateIntervalMs, 0);
+		FSPLMeterResults SummedResults;
+
+		TArray<float> Buffer;
+		Buffer.SetNumUninitialized(FramesPerBlock);
+
+		float Peak = 0.f;
+		double Energy = 0.0;
+		double WeightedEnergy = 0.0;
+
+		// Channel powers of the current update. Every channel's analyzers update on the same block.
+		float Power = 0.f;
+		float WeightedPower = 0.f;
+		int32 UpdateFrames = 0;
+
+		auto EndUpdate = [&]()
+			{
+				if (UpdateFrames > 0)
+				{
+					Energy += (double)Power * UpdateFrames;
+					WeightedEnergy += (double)WeightedPower * UpdateFrames;
+					SummedAnalyzer.AddLevel(PowerToDb(WeightedPower / NumChannels), UpdateFrames, DurationSeconds, SummedResults);
+				}
+
+				Power = 0.f;
+				WeightedPower = 0.f;
+				UpdateFrames = 0;
+			};
+
+		int32 Frame = 0;
+		while (Frame < NumFrames)
+		{
+			const int32 BlockFrames = FMath::Min(FramesPerBlock, NumFrames - Frame);
+
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				const int16* Interleaved = PCM + (Frame * NumChannels) + Channel;
+				for (int32 i = 0; i < BlockFrames; ++i)
+				{
+					const float Sample = Interleaved[i * NumChannels] / 32768.f;
+					Buffer[i] = Sample;
+					Peak = FMath::Max(Peak, FMath::Abs(Sample));
+				}
+
+				FSPLMeterResults Results;
+				if (WeightedAnalyzers[Channel].ProcessBlock(Buffer.GetData(), BlockFrames, ChannelPercentileWindowSeconds, Results))
+				{
+					WeightedPower += DbToPower(Results.LevelDb);
+					UpdateFrames = WeightedAnalyzers[Channel].GetLastUpdateFrames();
+				}
+				if (UnweightedAnalyzers[Channel].ProcessBlock(Buffer.GetData(), BlockFrames, ChannelPercentileWindowSeconds, Results))
+				{
+					Power += DbToPower(Results.LevelDb);
+				}
+			}
+
+			EndUpdate();
+			Frame += BlockFrames;
+		}
+
+		// The last, partial update interval
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			FSPLMeterResults Results;
+			if (WeightedAnalyzers[Channel].Flush(Results))
+			{
+				WeightedPower += DbToPower(Results.LevelDb);
+				UpdateFrames = WeightedAnalyzers[Channel].GetLastUpdateFrames();
+			}
+			if (UnweightedAnalyzers[Channel].Flush(Results))
+			{
+				Power += DbToPower(Results.LevelDb);
+			}
+		}
+		EndUpdate();
+		SummedAnalyzer.Flush(SummedResults);
+
+		const double NumSamples = (double)NumFrames * NumChannels;
+
+		FResult& Result = Job.Result;
+		Result.DurationSeconds = DurationSeconds;
+		Result.PeakDb = FMath::Max(20.f * FMath::LogX(10.f, FMath::Max(Peak, 1e-6f)), FSPLLevelHistogram::MinDb);
+		Result.RmsDb = PowerToDb(Energy / NumSamples);
+		Result.WeightedRmsDb = PowerToDb(WeightedEnergy / NumSamples);
+		Result.L10Db = SummedResults.L10Db;
+		Result.L50Db = SummedResults.L50Db;
+		Result.L90Db = SummedResults.L90Db;
+		Result.bValid = true;
+	}
+
+	static TSharedRef<FJsonObject> ResultToJson(const FResult& Result)
+	{
+		TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+		Object->SetStringField(TEXT("Hash"), Result.ContentHash);
+		Object->SetNumberField(TEXT("Duration"), Result.DurationSeconds);
+		Object->SetNumberField(TEXT("PeakDb"), Result.PeakDb);
+		Object->SetNumberField(TEXT("RmsDb"), Result.RmsDb);
+		Object->SetNumberField(TEXT("WeightedRmsDb"), Result.WeightedRmsDb);
+		Object->SetNumberField(TEXT("L10Db"), Result.L10Db);
+		Object->SetNumberField(TEXT("L50Db"), Result.L50Db);
+		Object->SetNumberField(TEXT("L90Db"), Result.L90Db);
+		return Object;
+	}
+
+	static bool ResultFromJson(const FJsonObject& Object, FResult& OutResult)
+	{
+		double Duration, Peak, Rms, WeightedRms, L10, L50, L90;
+		if (!Object.TryGetStringField(TEXT("Hash"), OutResult.ContentHash)
+			|| !Object.TryGetNumberField(TEXT("Duration"), Duration)
+			|| !Object.TryGetNumberField(TEXT("PeakDb"), Peak)
+			|| !Object.TryGetNumberField(TEXT("RmsDb"), Rms)
+			|| !Object.TryGetNumberField(TEXT("WeightedRmsDb"), WeightedRms)
+			|| !Object.TryGetNumberField(TEXT("L10Db"), L10)
+			|| !Object.TryGetNumberField(TEXT("L50Db"), L50)
+			|| !Object.TryGetNumberField(TEXT("L90Db"), L90))
+		{
+			return false;
+		}
+
+		OutResult.DurationSeconds = Duration;
+		OutResult.PeakDb = Peak;
+		OutResult.RmsDb = Rms;
+		OutResult.WeightedRmsDb = WeightedRms;
+		OutResult.L10Db = L10;
+		OutResult.L50Db = L50;
+		OutResult.L90Db = L90;
+		OutResult.bValid = true;
+		return true;
+	}
+
+	// Cached results from a previous manifest, or empty when it is missing or was written with other settings
+	static TMap<FString, FResult> LoadManifest(const FString& Filename, int32 WeightingOrder)
+	{
+		TMap<FString, FResult> Cache;
+
+		FString Text;
+		if (!FFileHelper::LoadFileToString(Text, *Filename))
+		{
+			return Cache;
+		}
+
+		TSharedPtr<FJsonObject> Root;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Text), Root) || !Root.IsValid())
+		{
+			UE_LOG(LogSPLLoudness, Warning, TEXT("Could not parse manifest '%s', all assets will be analysed."), *Filename);
+			return Cache;
+		}
+
+		int32 Version = 0;
+		int32 Order = -1;
+		const TSharedPtr<FJsonObject>* Assets = nullptr;
+		if (!Root->TryGetNumberField(TEXT("Version"), Version) || Version != ManifestVersion
+			|| !Root->TryGetNumberField(TEXT("WeightingOrder"), Order) || Order != WeightingOrder
+			|| !Root->TryGetObjectField(TEXT("Assets"), Assets))
+		{
+			UE_LOG(LogSPLLoudness, Display, TEXT("Manifest '%s' was written with different settings, all assets will be analysed."), *Filename);
+			return Cache;
+		}
+
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& Entry : (*Assets)->Values)
+		{
+			const TSharedPtr<FJsonObject>* Object = nullptr;
+			FResult Result;
+			if (Entry.Value.IsValid() && Entry.Value->TryGetObject(Object) && ResultFromJson(**Object, Result))
+			{
+				Cache.Add(Entry.Key, MoveTemp(Result));
+			}
+		}
+
+		return Cache;
+	}
+
+	static bool SaveManifest(const FString& Filename, int32 WeightingOrder, const TArray<FJob>& Jobs)
+	{
+		TSharedRef<FJsonObject> Assets = MakeShared<FJsonObject>();
+		for (const FJob& Job : Jobs)
+		{
+			if (Job.Result.bValid)
+			{
+				Assets->SetObjectField(Job.Asset.GetObjectPathString(), ResultToJson(Job.Result));
+			}
+		}
+
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetNumberField(TEXT("Version"), ManifestVersion);
+		Root->SetNumberField(TEXT("WeightingOrder"), WeightingOrder);
+		Root->SetObjectField(TEXT("Assets"), Assets);
+
+		FString Text;
+		if (!FJsonSerializer::Serialize(Root, TJsonWriterFactory<>::Create(&Text)))
+		{
+			return false;
+		}
+		return FFileHelper::SaveStringToFile(Text, *Filename);
+	}
+}
+
+USPLLoudnessCommandlet::USPLLoudnessCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USPLLoudnessCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	using namespace SPLLoudnessCommandlet;
+
+	FString ManifestFilename = FPaths::ProjectSavedDir() / TEXT("Audio") / TEXT("LoudnessManifest.json");
+	FParse::Value(*Params, TEXT("Manifest="), ManifestFilename);
+
+	FString PathsParam = TEXT("/Game");
+	FParse::Value(*Params, TEXT("Paths="), PathsParam, false);
+
+	int32 BatchSize = 256;
+	FParse::Value(*Params, TEXT("Batch="), BatchSize);
+	BatchSize = FMath::Max(BatchSize, 1);
+
+	int32 WeightingOrder = FSPLWeightingFilter::MaxOrder;
+	FParse::Value(*Params, TEXT("WeightingOrder="), WeightingOrder);
+	WeightingOrder = FMath::Clamp(WeightingOrder, 0, FSPLWeightingFilter::MaxOrder);
+
+	const bool bForce = FParse::Param(*Params, TEXT("Force"));
+
+	// Find every SoundWave under the requested paths
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.ClassPaths.Add(USoundWave::StaticClass()->GetClassPathName());
+	Filter.bRecursiveClasses = true;
+	Filter.bRecursivePaths = true;
+
+	TArray<FString> Paths;
+	PathsParam.ParseIntoArray(Paths, TEXT(","));
+	for (const FString& Path : Paths)
+	{
+		Filter.PackagePaths.Add(FName(*Path));
+	}
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+
+	TArray<FJob> Jobs;
+	Jobs.SetNum(Assets.Num());
+	for (int32 i = 0; i < Assets.Num(); ++i)
+	{
+		Jobs[i].Asset = MoveTemp(Assets[i]);
+		FPackageName::DoesPackageExist(Jobs[i].Asset.PackageName.ToString(), &Jobs[i].PackageFilename);
+	}
+
+	UE_LOG(LogSPLLoudness, Display, TEXT("Found %d SoundWaves."), Jobs.Num());
+
+	// Hash package files in parallel. The hash covers the imported audio and the import settings.
+	ParallelFor(Jobs.Num(), [&Jobs](int32 Index)
+		{
+			FJob& Job = Jobs[Index];
+			if (!Job.PackageFilename.IsEmpty())
+			{
+				Job.Result.ContentHash = LexToString(FMD5Hash::HashFile(*Job.PackageFilename));
+			}
+		});
+
+	// Reuse cached results for unchanged packages
+	TArray<int32> StaleJobs;
+	{
+		const TMap<FString, FResult> Cache = bForce ? TMap<FString, FResult>() : LoadManifest(ManifestFilename, WeightingOrder);
+		for (int32 i = 0; i < Jobs.Num(); ++i)
+		{
+			FJob& Job = Jobs[i];
+			const FResult* Cached = Cache.Find(Job.Asset.GetObjectPathString());
+			if (Cached && !Job.Result.ContentHash.IsEmpty() && Cached->ContentHash == Job.Result.ContentHash)
+			{
+				Job.Result = *Cached;
+			}
+			else
+			{
+				StaleJobs.Add(i);
+			}
+		}
+	}
+
+	UE_LOG(LogSPLLoudness, Display, TEXT("%d SoundWaves unchanged, %d to analyse."), Jobs.Num() - StaleJobs.Num(), StaleJobs.Num());
+
+	// Loading has to happen on the game thread, so assets are loaded a batch at a time and the analysis of each batch
+	// runs in parallel. Batching also bounds how much decoded PCM is held at once.
+	int32 NumFailed = 0;
+	for (int32 BatchStart = 0; BatchStart < StaleJobs.Num(); BatchStart += BatchSize)
+	{
+		const TArrayView<const int32> Batch = TArrayView<const int32>(StaleJobs).Slice(BatchStart, FMath::Min(BatchSize, StaleJobs.Num() - BatchStart));
+
+		for (int32 JobIndex : Batch)
+		{
+			FJob& Job = Jobs[JobIndex];
+			USoundWave* SoundWave = Cast<USoundWave>(Job.Asset.GetAsset());
+			if (!SoundWave || !SoundWave->GetImportedSoundWaveData(Job.RawPCM, Job.SampleRate, Job.NumChannels))
+			{
+				Job.RawPCM.Empty();
+				Job.NumChannels = 0;
+			}
+		}
+
+		ParallelFor(Batch.Num(), [&Jobs, &Batch, WeightingOrder](int32 Index)
+			{
+				FJob& Job = Jobs[Batch[Index]];
+				Analyze(Job, WeightingOrder);
+				Job.RawPCM.Empty();
+			});
+
+		for (int32 JobIndex : Batch)
+		{
+			if (!Jobs[JobIndex].Result.bValid)
+			{
+				UE_LOG(LogSPLLoudness, Warning, TEXT("Could not read audio from '%s', skipped."), *Jobs[JobIndex].Asset.GetObjectPathString());
+				++NumFailed;
+			}
+		}
+
+		CollectGarbage(RF_NoFlags);
+
+		UE_LOG(LogSPLLoudness, Display, TEXT("Analysed %d / %d."), BatchStart + Batch.Num(), StaleJobs.Num());
+	}
+
+	if (!SaveManifest(ManifestFilename, WeightingOrder, Jobs))
+	{
+		UE_LOG(LogSPLLoudness, Error, TEXT("Failed to write manifest '%s'."), *ManifestFilename);
+		return 1;
+	}
+
+	UE_LOG(LogSPLLoudness, Display, TEXT("Wrote %d entries to '%s'. %d SoundWaves could not be read."), Jobs.Num() - NumFailed, *ManifestFilename, NumFailed);
+	return 0;
+#else
+	UE_LOG(LogSPLLoudness, Error, TEXT("SPLLoudness needs an editor build."));
+	return 1;
+#endif
+}
@@ -0,0 +1,286 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SPLMeterLog.h"
+#include "MetaSoundsSPL.h"
+#include "SPLChannelWorker.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSPLMeterLog, Log, All);
+
+static int32 SPLMeterLogEnabled = 0;
+static FAutoConsoleVariableRef CVarSPLMeterLogEnabled(
+	TEXT("au.MetaSoundsSPL.MeterLog.Enabled"),
+	SPLMeterLogEnabled,
+	TEXT("Log SPL meters created from now on to Saved/Logs/SPLMeter_<time>.spllog. 0: off (default), 1: on."),
+	ECVF_Default);
+
+static int32 SPLMeterLogQueueSize = 1024;
+static FAutoConsoleVariableRef CVarSPLMeterLogQueueSize(
+	TEXT("au.MetaSoundsSPL.MeterLog.QueueSize"),
+	SPLMeterLogQueueSize,
+	TEXT("Readings each meter can queue before the writer drains them. Further readings are dropped and counted."),
+	ECVF_Default);
+
+static float SPLMeterLogWriteIntervalMs = 250.f;
+static FAutoConsoleVariableRef CVarSPLMeterLogWriteIntervalMs(
+	TEXT("au.MetaSoundsSPL.MeterLog.WriteIntervalMs"),
+	SPLMeterLogWriteIntervalMs,
+	TEXT("Milliseconds between batched writes to the meter log."),
+	ECVF_Default);
+
+static FAutoConsoleCommand CmdSPLMeterLogToCSV(
+	TEXT("au.MetaSoundsSPL.MeterLog.ToCSV"),
+	TEXT("Converts an SPL meter log to CSV. Args: <LogFile> [CSVFile]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.Num() < 1)
+			{
+				UE_LOG(LogSPLMeterLog, Display, TEXT("Usage: au.MetaSoundsSPL.MeterLog.ToCSV <LogFile> [CSVFile]"));
+				return;
+			}
+			const FString CSVFilename = Args.Num() > 1 ? Args[1] : FPaths::ChangeExtension(Args[0], TEXT("csv"));
+			Metasound::FSPLMeterLog::ConvertToCSV(Args[0], CSVFilename);
+		}));
+
+namespace Metasound
+{
+	namespace SPLMeterLogFormat
+	{
+		static constexpr uint64 Magic = 0x31474F4C4C505341ull; // "ASPLLOG1"
+		static constexpr uint32 Version = 1;
+
+		enum class ERecord : uint8
+		{
+			// MeterId, MeterName
+			Meter,
+			// MeterId, Count, Count x FSPLMeterReading
+			Readings,
+			// MeterId, total dropped so far
+			Dropped
+		};
+	}
+
+	FSPLMeterLogChannel::FSPLMeterLogChannel(uint32 InMeterId, const FString& InMeterName, uint32 InCapacity)
+		: Readings(InCapacity),
+		MeterId(InMeterId),
+		MeterName(InMeterName)
+	{
+	}
+
+	// Owns the log file and writes every channel's readings to it in batches
+	class FSPLMeterLogWriter : public TSPLChannelWorker<FSPLMeterLogChannel>
+	{
+	public:
+		FSPLMeterLogWriter(const FString& InFilename)
+			: Filename(InFilename)
+		{
+			StartThread(TEXT("SPLMeterLogWriter"));
+		}
+
+		virtual ~FSPLMeterLogWriter()
+		{
+			StopThread();
+		}
+
+		//~ Begin FRunnable Interface
+		virtual bool Init() override
+		{
+			File.Reset(IFileManager::Get().CreateFileWriter(*Filename, FILEWRITE_AllowRead));
+			if (!File)
+			{
+				UE_LOG(LogSPLMeterLog, Error, TEXT("Could not open '%s', SPL meter readings will not be logged."), *Filename);
+				return false;
+			}
+
+			uint64 Magic = SPLMeterLogFormat::Magic;
+			uint32 Version = SPLMeterLogFormat::Version;
+			*File << Magic << Version;
+			UE_LOG(LogSPLMeterLog, Display, TEXT("Logging SPL meter readings to '%s'."), *Filename);
+			return true;
+		}
+
+		virtual void Exit() override
+		{
+			File.Reset();
+		}
+		//~ End FRunnable Interface
+
+	protected:
+		virtual float GetIntervalMs() const override
+		{
+			return FMath::Max(SPLMeterLogWriteIntervalMs, 1.f);
+		}
+
+		virtual void OnChannelAdded(FSPLMeterLogChannel& Channel) override
+		{
+			SPLMeterLogFormat::ERecord Type = SPLMeterLogFormat::ERecord::Meter;
+			*File << Type << Channel.MeterId << Channel.MeterName;
+		}
+
+		virtual void DrainChannel(FSPLMeterLogChannel& Channel) override
+		{
+			using namespace SPLMeterLogFormat;
+
+			Scratch.Reset();
+			FSPLMeterReading Reading;
+			while (Channel.Readings.Dequeue(Reading))
+			{
+				Scratch.Add(Reading);
+			}
+
+			if (Scratch.Num() > 0)
+			{
+				ERecord Type = ERecord::Readings;
+				uint32 Count = Scratch.Num();
+				*File << Type << Channel.MeterId << Count;
+				File->Serialize(Scratch.GetData(), Scratch.Num() * sizeof(FSPLMeterReading));
+			}
+
+			uint32 NumDropped = Channel.NumDropped.load(std::memory_order_relaxed);
+			if (NumDropped != Channel.NumDroppedWritten)
+			{
+				ERecord Type = ERecord::Dropped;
+				*File << Type << Channel.MeterId << NumDropped;
+				Channel.NumDroppedWritten = NumDropped;
+			}
+		}
+
+		virtual void OnDrained() override
+		{
+			File->Flush();
+		}
+
+	private:
+		FString Filename;
+		TUniquePtr<FArchive> File;
+		TArray<FSPLMeterReading> Scratch;
+	};
+
+	namespace SPLMeterLogPrivate
+	{
+		static FCriticalSection WriterLock;
+		static TUniquePtr<FSPLMeterLogWriter> Writer;
+		static std::atomic<uint32> NextMeterId { 0 };
+	}
+
+	FSPLMeterLogChannelPtr FSPLMeterLog::OpenChannel(const FString& MeterName)
+	{
+		using namespace SPLMeterLogPrivate;
+
+		if (SPLMeterLogEnabled == 0)
+		{
+			return nullptr;
+		}
+
+		FSPLMeterLogChannelPtr Channel = MakeShared<FSPLMeterLogChannel, ESPMode::ThreadSafe>(NextMeterId.fetch_add(1), MeterName, FMath::Max(SPLMeterLogQueueSize, 2));
+
+		// Only taken when an operator is created, never from Execute
+		MSUTILS_NOTE_LOCK(TEXT("SPLMeterLog WriterLock"));
+		FScopeLock Lock(&WriterLock);
+		if (!Writer)
+		{
+			const FString Filename = FPaths::ProjectLogDir() / FString::Printf(TEXT("SPLMeter_%s.spllog"), *FDateTime::Now().ToString());
+			Writer = MakeUnique<FSPLMeterLogWriter>(Filename);
+		}
+		Writer->AddChannel(Channel);
+		return Channel;
+	}
+
+	void FSPLMeterLog::Shutdown()
+	{
+		using namespace SPLMeterLogPrivate;
+
+		MSUTILS_NOTE_LOCK(TEXT("SPLMeterLog WriterLock"));
+		FScopeLock Lock(&WriterLock);
+		Writer.Reset();
+	}
+
+	bool FSPLMeterLog::ConvertToCSV(const FString& LogFilename, const FString& CSVFilename)
+	{
+		using namespace SPLMeterLogFormat;
+
+		TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*LogFilename, FILEREAD_AllowWrite));
+		if (!Reader)
+		{
+			UE_LOG(LogSPLMeterLog, Error, TEXT("Could not open '%s'."), *LogFilename);
+			return false;
+		}
+
+		uint64 FileMagic = 0;
+		uint32 FileVersion = 0;
+		*Reader << FileMagic << FileVersion;
+		if (FileMagic != Magic || FileVersion != Version)
+		{
+			UE_LOG(LogSPLMeterLog, Error, TEXT("'%s' is not an SPL meter log."), *LogFilename);
+			return false;
+		}
+
+		TMap<uint32, FString> MeterNames;
+		TMap<uint32, uint32> MeterDropped;
+		TArray<FSPLMeterReading> Readings;
+
+		FString CSV = TEXT("MeterId,Meter,TimeSeconds,LevelDb,L10Db,L50Db,L90Db\n");
+		while (!Reader->AtEnd() && !Reader->IsError())
+		{
+			ERecord Type;
+			uint32 MeterId = 0;
+			*Reader << Type << MeterId;
+
+			if (Type == ERecord::Meter)
+			{
+				*Reader << MeterNames.FindOrAdd(MeterId);
+			}
+			else if (Type == ERecord::Readings)
+			{
+				uint32 Count = 0;
+				*Reader << Count;
+
+				// A crash can leave the last batch cut short
+				if (Count * sizeof(FSPLMeterReading) > (uint64)(Reader->TotalSize() - Reader->Tell()))
+				{
+					break;
+				}
+
+				Readings.SetNumUninitialized(Count);
+				Reader->Serialize(Readings.GetData(), Count * sizeof(FSPLMeterReading));
+
+				const FString& MeterName = MeterNames.FindRef(MeterId);
+				for (const FSPLMeterReading& Reading : Readings)
+				{
+					CSV += FString::Printf(TEXT("%u,%s,%.4f,%.2f,%.2f,%.2f,%.2f\n"), MeterId, *MeterName,
+						Reading.TimeSeconds, Reading.LevelDb, Reading.L10Db, Reading.L50Db, Reading.L90Db);
+				}
+			}
+			else if (Type == ERecord::Dropped)
+			{
+				*Reader << MeterDropped.FindOrAdd(MeterId);
+			}
+			else
+			{
+				UE_LOG(LogSPLMeterLog, Warning, TEXT("Unknown record in '%s', stopping conversion early."), *LogFilename);
+				break;
+			}
+		}
+
+		for (const TPair<uint32, uint32>& Dropped : MeterDropped)
+		{
+			UE_LOG(LogSPLMeterLog, Warning, TEXT("Meter %u (%s) dropped %u readings."), Dropped.Key, *MeterNames.FindRef(Dropped.Key), Dropped.Value);
+		}
+
+		if (!FFileHelper::SaveStringToFile(CSV, *CSVFilename))
+		{
+			UE_LOG(LogSPLMeterLog, Error, TEXT("Could not write '%s'."), *CSVFilename);
+			return false;
+		}
+
+		UE_LOG(LogSPLMeterLog, Display, TEXT("Wrote '%s'."), *CSVFilename);
+		return true;
+	}
+}
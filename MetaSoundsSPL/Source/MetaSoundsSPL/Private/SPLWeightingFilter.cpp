@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SPLWeightingFilter.h"
+
+namespace Metasound
+{
+	void FSPLWeightingFilter::Init(float InSampleRate, int32 InOrder)
+	{
+		struct FPole
+		{
+			float Frequency;
+			bool bHighPass;
+		};
+
+		// In the order sections are added as the filter order goes up
+		static const FPole Poles[MaxOrder] =
+		{
+			{ 107.7f, true },
+			{ 737.9f, true },
+			{ 20.6f, true },
+			{ 20.6f, true },
+			{ 12194.f, false },
+			{ 12194.f, false }
+		};
+
+		NumSections = FMath::Clamp(InOrder, 0, MaxOrder);
+
+		// Bilinear transform with prewarping. The digital response at f equals the analog one at the warped ratio
+		// tan(PI * f / SampleRate) / tan(PI * Pole / SampleRate), which also gives the 1 kHz normalisation.
+		const float WarpedReference = FMath::Tan(PI * 1000.f / InSampleRate);
+		float ReferenceMagnitude = 1.f;
+
+		for (int32 i = 0; i < NumSections; ++i)
+		{
+			const float Frequency = FMath::Min(Poles[i].Frequency, 0.45f * InSampleRate);
+			const float K = FMath::Tan(PI * Frequency / InSampleRate);
+			const float Ratio = WarpedReference / K;
+
+			FSection& Section = Sections[i];
+			Section = FSection();
+			Section.A1 = (K - 1.f) / (K + 1.f);
+
+			if (Poles[i].bHighPass)
+			{
+				Section.B0 = 1.f / (1.f + K);
+				Section.B1 = -Section.B0;
+				ReferenceMagnitude *= Ratio / FMath::Sqrt(1.f + Ratio * Ratio);
+			}
+			else
+			{
+				Section.B0 = K / (1.f + K);
+				Section.B1 = Section.B0;
+				ReferenceMagnitude *= 1.f / FMath::Sqrt(1.f + Ratio * Ratio);
+			}
+		}
+
+		Gain = 1.f / ReferenceMagnitude;
+	}
+
+	void FSPLWeightingFilter::ProcessAudio(const float* InSamples, float* OutSamples, int32 NumSamples)
+	{
+		if (NumSections == 0)
+		{
+			if (InSamples != OutSamples)
+			{
+				FMemory::Memcpy(OutSamples, InSamples, NumSamples * sizeof(float));
+			}
+			return;
+		}
+
+		// First section applies the normalisation gain, the rest run in place
+		for (int32 SectionIndex = 0; SectionIndex < NumSections; ++SectionIndex)
+		{
+			FSection& Section = Sections[SectionIndex];
+			const float* Source = SectionIndex == 0 ? InSamples : OutSamples;
+			const float InputGain = SectionIndex == 0 ? Gain : 1.f;
+
+			float X1 = Section.X1;
+			float Y1 = Section.Y1;
+			for (int32 i = 0; i < NumSamples; ++i)
+			{
+				const float X = Source[i] * InputGain;
+				const float Y = Section.B0 * X + Section.B1 * X1 - Section.A1 * Y1;
+				X1 = X;
+				Y1 = Y;
+				OutSamples[i] = Y;
+			}
+			Section.X1 = X1;
+			Section.Y1 = Y1;
+		}
+	}
+
+	void FSPLWeightingFilter::Reset()
+	{
+		for (FSection& Section : Sections)
+		{
+			Section.X1 = 0.f;
+			Section.Y1 = 0.f;
+		}
+	}
+}
@@ -12,6 +12,19 @@
 #include "MetasoundStandardNodesNames.h" 
 #include "MetasoundFacade.h"
 #include "MetasoundParamHelper.h" 
+#include "SPLAnalysisPipeline.h"
+#include "SPLMeterLog.h"
+
+// Capture comes from MS_Utils. Without it the pointer is declared so the operator keeps one signature, and is always null.
+#if WITH_MS_UTILS
+#include "OperatorCapture.h"
+#else
+namespace Metasound
+{
+	class FOperatorCapture;
+	using FOperatorCapturePtr = TSharedPtr<FOperatorCapture, ESPMode::ThreadSafe>;
+}
+#endif
 
 	//------------------------------------------------------------------------------------
 	// FSPLOperator
@@ -22,7 +35,9 @@ namespace Metasound
 	class FSPLOperator : public TExecutableOperator<FSPLOperator>
 	{
 	public:
-		FSPLOperator(const FOperatorSettings& InSettings, const FAudioBufferReadRef& InAudio);
+		FSPLOperator(const FOperatorSettings& InSettings, const FAudioBufferReadRef& InAudio, const FFloatReadRef& InPercentileWindow, const FSPLMeterSettings& InMeterSettings, const FSPLMeterLogChannelPtr& InLogChannel, const FSPLAnalysisChannelPtr& InAnalysisChannel, const FOperatorCapturePtr& InCapture);
+
+		virtual ~FSPLOperator();
 
 		//UFUNCTION()
 		//static functions exist across the class and not instances. They cannot access member instance variables or non-static members
@@ -48,10 +63,37 @@ namespace Metasound
 		//UFUNCTION()
 		void Execute();
 
+		const FAudioBuffer& GetAudioOutput() const
+		{
+			return *AudioOutput;
+		}
+
 	private:
 
 		FAudioBufferReadRef AudioInput;
+		FFloatReadRef PercentileWindow;
 		FAudioBufferWriteRef AudioOutput;
+		FFloatWriteRef LevelOutput;
+		FFloatWriteRef L10Output;
+		FFloatWriteRef L50Output;
+		FFloatWriteRef L90Output;
+
+		// Measures on the render thread. When the analysis is offloaded it only runs, at a lower weighting order, while
+		// the channel's ring is full.
+		FSPLMeterAnalyzer Analyzer;
+		FSPLMeterResults Results;
+		float SampleRate = 0.f;
+
+		// Set when au.MetaSoundsSPL.Analysis.Offload was on at creation. Blocks are pushed to it instead of measured here.
+		FSPLAnalysisChannelPtr AnalysisChannel;
+		bool bAnalysisFallback = false;
+
+		// Set when au.MetaSoundsSPL.MeterLog.Enabled was on at creation. Each level update is pushed to it, by this
+		// operator or by the analysis worker when offloaded.
+		FSPLMeterLogChannelPtr LogChannel;
+		int64 FramesProcessed = 0;
+
+		FOperatorCapturePtr Capture;
 
 	};
 
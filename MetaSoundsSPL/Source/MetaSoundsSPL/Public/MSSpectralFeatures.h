@@ -0,0 +1,190 @@
+// Copyright Dale Grinsell 2024. All Rights Reserved. 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MetasoundExecutableOperator.h"
+#include "Internationalization/Text.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundTime.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundStandardNodesNames.h" 
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h" 
+#include "SPLAnalysisPipeline.h"
+
+namespace Audio
+{
+	class IFFTAlgorithm;
+}
+
+	//------------------------------------------------------------------------------------
+	// FSpectralFeaturesOperator
+	//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	struct FSpectralFeatures
+	{
+		float CentroidHz = 0.f;
+		float Flux = 0.f;
+		float RolloffHz = 0.f;
+		float Flatness = 0.f;
+	};
+
+	// The node's measurement: a history of the last FFTSize samples, windowed and transformed every hop. The constructor
+	// allocates; ProcessBlock and Reset don't.
+	class METASOUNDSSPL_API FSpectralFeaturesAnalyzer
+	{
+	public:
+		// FFTSize is rounded to a power of two between 256 and 8192, and HopSize clamped to it
+		FSpectralFeaturesAnalyzer(float SampleRate, int32 InFFTSize, int32 InHopSize);
+		~FSpectralFeaturesAnalyzer();
+
+		// Returns true when Features received a new frame's values
+		bool ProcessBlock(const float* Samples, int32 NumFrames, float RolloffPercent, FSpectralFeatures& Features);
+
+		// Clears the history and the previous frame's magnitudes, as if no audio had been seen
+		void Reset();
+
+	private:
+		// Windows the last FFTSize input samples, transforms them and updates Features
+		void AnalyzeFrame(float RolloffPercent, FSpectralFeatures& Features);
+
+		TUniquePtr<Audio::IFFTAlgorithm> FFT;
+		TArray<float> Window;
+		TArray<float> History;
+		TArray<float> FrameBuffer;
+		TArray<float> ComplexBuffer;
+		TArray<float> PowerSpectrum;
+		TArray<float> Magnitudes;
+		TArray<float> PrevMagnitudes;
+
+		int32 FFTSize = 0;
+		int32 HopSize = 0;
+		int32 HistoryWritePos = 0;
+		int32 FramesUntilHop = 0;
+		float BinWidthHz = 0.f;
+	};
+
+	// One node's blocks on their way to the analysis worker, plus the latest features the worker has published for it
+	class METASOUNDSSPL_API FSpectralFeaturesChannel : public ISPLAnalysisChannel
+	{
+	public:
+		FSpectralFeaturesChannel(float SampleRate, int32 FramesPerBlock, uint32 NumBlocks, int32 FFTSize, int32 HopSize);
+
+		// Render thread only. Returns false, without blocking or allocating, when the ring is full.
+		bool Push(const float* Samples, int32 NumFrames, float RolloffPercent)
+		{
+			if (!Blocks.Push(Samples, NumFrames, { RolloffPercent, bResetPending }))
+			{
+				return false;
+			}
+			bResetPending = false;
+			return true;
+		}
+
+		// Render thread only. The worker resets its analyzer before the next block pushed. Published features read as
+		// zero from here, though blocks queued before the reset can still publish until the worker reaches it.
+		void Reset();
+
+		// Latest published features. Fields are published individually, so a read can mix two consecutive frames.
+		FSpectralFeatures GetFeatures() const
+		{
+			return { CentroidHz.load(std::memory_order_relaxed), Flux.load(std::memory_order_relaxed), RolloffHz.load(std::memory_order_relaxed), Flatness.load(std::memory_order_relaxed) };
+		}
+
+	protected:
+		virtual void ProcessQueued() override;
+
+	private:
+		struct FBlockInfo
+		{
+			float RolloffPercent = 0.f;
+			bool bReset = false;
+		};
+
+		TSPLBlockRing<FBlockInfo> Blocks;
+
+		// Render thread state
+		bool bResetPending = false;
+
+		std::atomic<float> CentroidHz { 0.f };
+		std::atomic<float> Flux { 0.f };
+		std::atomic<float> RolloffHz { 0.f };
+		std::atomic<float> Flatness { 0.f };
+
+		// Worker thread state
+		FSpectralFeaturesAnalyzer Analyzer;
+		FSpectralFeatures Features;
+	};
+
+	using FSpectralFeaturesChannelPtr = TSharedPtr<FSpectralFeaturesChannel, ESPMode::ThreadSafe>;
+
+	class FSpectralFeaturesOperator : public TExecutableOperator<FSpectralFeaturesOperator>
+	{
+	public:
+		FSpectralFeaturesOperator(const FOperatorSettings& InSettings,
+			const FAudioBufferReadRef& InAudio,
+			const FInt32ReadRef& InFFTSize,
+			const FInt32ReadRef& InHopSize,
+			const FFloatReadRef& InRolloffPercent,
+			const FSpectralFeaturesChannelPtr& InAnalysisChannel);
+
+		virtual ~FSpectralFeaturesOperator();
+
+		//UFUNCTION()
+		//static functions exist across the class and not instances. They cannot access member instance variables or non-static members
+		//they can only access other static members (variables or methods) of the class.
+		static const FVertexInterface& DeclareVertexInterface();
+
+		//UFUNCTION()
+		static const FNodeClassMetadata& GetNodeInfo();
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override;
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override;
+
+		//UFUNCTION
+		// Used to instantiate a new runtime instance of your node
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors);
+
+		//UFUNCTION()
+		void Execute();
+
+		void Reset(const IOperator::FResetParams& InParams);
+
+	private:
+
+		FAudioBufferReadRef AudioInput;
+		FInt32ReadRef FFTSizeInput;
+		FInt32ReadRef HopSizeInput;
+		FFloatReadRef RolloffPercent;
+		FFloatWriteRef CentroidOutput;
+		FFloatWriteRef FluxOutput;
+		FFloatWriteRef RolloffOutput;
+		FFloatWriteRef FlatnessOutput;
+
+		// Set when au.MetaSoundsSPL.Analysis.Offload was on at creation. Blocks are pushed to it instead of analysed
+		// here, and Analyzer is not created.
+		FSpectralFeaturesChannelPtr AnalysisChannel;
+		TUniquePtr<FSpectralFeaturesAnalyzer> Analyzer;
+		FSpectralFeatures Features;
+	};
+
+	//------------------------------------------------------------------------------------
+	// FSpectralFeaturesNode
+	//------------------------------------------------------------------------------------
+
+	// Node Class - Inheriting from FNodeFacade is recommended for nodes that have a static FVertexInterface
+	class FSpectralFeaturesNode : public FNodeFacade
+	{
+	public:
+		//MetaSound frontend constructor
+		FSpectralFeaturesNode(const FNodeInitData& InitData) : FNodeFacade(InitData.InstanceName, InitData.InstanceID,
+			TFacadeOperatorClass<FSpectralFeaturesOperator>())
+		{
+		}
+	};
+
+}
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MetasoundExecutableOperator.h"
+#include "Internationalization/Text.h"
+#include "MetasoundPrimitives.h"
+#include "MetasoundTime.h"
+#include "MetasoundNodeRegistrationMacro.h"
+#include "MetasoundStandardNodesNames.h"
+#include "MetasoundFacade.h"
+#include "MetasoundParamHelper.h"
+
+	//------------------------------------------------------------------------------------
+	// FStereoImageOperator
+	//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	class FStereoImageOperator : public TExecutableOperator<FStereoImageOperator>
+	{
+	public:
+		FStereoImageOperator(const FOperatorSettings& InSettings,
+			const FAudioBufferReadRef& InLeft,
+			const FAudioBufferReadRef& InRight,
+			const FFloatReadRef& InIntegrationTime);
+
+		virtual ~FStereoImageOperator();
+
+		//UFUNCTION()
+		//static functions exist across the class and not instances. They cannot access member instance variables or non-static members
+		//they can only access other static members (variables or methods) of the class.
+		static const FVertexInterface& DeclareVertexInterface();
+
+		//UFUNCTION()
+		static const FNodeClassMetadata& GetNodeInfo();
+
+		virtual void BindInputs(FInputVertexInterfaceData& InOutVertexData) override;
+		virtual void BindOutputs(FOutputVertexInterfaceData& InOutVertexData) override;
+
+		//UFUNCTION
+		// Used to instantiate a new runtime instance of your node
+		static TUniquePtr<IOperator> CreateOperator(const FCreateOperatorParams& InParams, FBuildErrorArray& OutErrors);
+
+		//UFUNCTION()
+		void Execute();
+
+	private:
+
+		// L*L, R*R and L*R summed over one block
+		struct FBlockSums
+		{
+			float LL = 0.f;
+			float RR = 0.f;
+			float LR = 0.f;
+		};
+
+		// Works out the outputs from the running window sums
+		void UpdateOutputs();
+
+		FAudioBufferReadRef LeftInput;
+		FAudioBufferReadRef RightInput;
+		FFloatReadRef IntegrationTime;
+		FFloatWriteRef CorrelationOutput;
+		FFloatWriteRef BalanceOutput;
+		FFloatWriteRef MidSideRatioOutput;
+
+		// Sliding window of per-block sums, allocated once in the constructor. The running sums move by one block
+		// each Execute and are rebuilt from the ring whenever it wraps, so rounding can't build up.
+		TArray<FBlockSums> Window;
+		int32 WindowWritePos = 0;
+		int32 NumWindowBlocks = 0;
+		double SumLL = 0.0;
+		double SumRR = 0.0;
+		double SumLR = 0.0;
+		int32 NumFilledBlocks = 0;
+		int32 NumFramesPerBlock = 0;
+	};
+
+	//------------------------------------------------------------------------------------
+	// FStereoImageNode
+	//------------------------------------------------------------------------------------
+
+	// Node Class - Inheriting from FNodeFacade is recommended for nodes that have a static FVertexInterface
+	class FStereoImageNode : public FNodeFacade
+	{
+	public:
+		//MetaSound frontend constructor
+		FStereoImageNode(const FNodeInitData& InitData) : FNodeFacade(InitData.InstanceName, InitData.InstanceID,
+			TFacadeOperatorClass<FStereoImageOperator>())
+		{
+		}
+	};
+
+}
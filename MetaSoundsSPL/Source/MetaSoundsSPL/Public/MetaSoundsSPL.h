@@ -5,6 +5,18 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "Stats/Stats.h"
+
+// Set by MetaSoundsSPL.Build.cs when the MS_Utils plugin is available
+#if WITH_MS_UTILS
+#include "RenderThreadGuard.h"
+#else
+#define MSUTILS_EXECUTE_SCOPE(NodeName)
+#define MSUTILS_NOTE_LOCK(LockName)
+#endif
+
+// Per-node render cost and live operator counts, shown with "stat MetaSoundsSPL".
+DECLARE_STATS_GROUP(TEXT("MetaSoundsSPL"), STATGROUP_MetaSoundsSPL, STATCAT_Advanced);
 
 
 class FMetaSoundsSPLModule : public IModuleInterface
@@ -0,0 +1,272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SPLLevelHistogram.h"
+#include "SPLMeterLog.h"
+#include "SPLWeightingFilter.h"
+
+#include "Containers/CircularQueue.h"
+
+#include <atomic>
+
+	//------------------------------------------------------------------------------------
+	// FSPLAnalysisPipeline
+	//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// Meter options read from the au.MetaSoundsSPL CVars when an operator is created
+	struct FSPLMeterSettings
+	{
+		// How often the Level output updates. Levels are averaged over this window. 0 updates every block.
+		float UpdateIntervalMs = 0.f;
+
+		// Order of the A-weighting approximation, see FSPLWeightingFilter. 0 is unweighted.
+		int32 WeightingOrder = FSPLWeightingFilter::MaxOrder;
+
+		// Reads the current CVar values
+		METASOUNDSSPL_API static FSPLMeterSettings Get();
+	};
+
+	struct FSPLMeterResults
+	{
+		float LevelDb = FSPLLevelHistogram::MinDb;
+		float L10Db = FSPLLevelHistogram::MinDb;
+		float L50Db = FSPLLevelHistogram::MinDb;
+		float L90Db = FSPLLevelHistogram::MinDb;
+	};
+
+	// The SPL meter's measurement: weighting, level averaged over the update interval and L10/L50/L90 over tumbling
+	// percentile windows. Init allocates; ProcessBlock and Reset don't.
+	class METASOUNDSSPL_API FSPLMeterAnalyzer
+	{
+	public:
+		void Init(float InSampleRate, int32 InFramesPerBlock, float UpdateIntervalMs, int32 WeightingOrder);
+
+		// Returns true when Results received a new level, measured over GetLastUpdateFrames frames
+		bool ProcessBlock(const float* Samples, int32 NumFrames, float PercentileWindowSeconds, FSPLMeterResults& Results);
+
+		// Adds a level measured over NumFrames to the percentile histogram and publishes L10/L50/L90 when the window
+		// completes. ProcessBlock calls this for its own levels.
+		void AddLevel(float LevelDb, int32 NumFrames, float PercentileWindowSeconds, FSPLMeterResults& Results);
+
+		int32 GetLastUpdateFrames() const
+		{
+			return LastUpdateFrames;
+		}
+
+		// Ends the stream: publishes the level of any frames since the last update, then L10/L50/L90 of the levels in
+		// the unfinished percentile window. Returns true when Results received a new level, as ProcessBlock does.
+		bool Flush(FSPLMeterResults& Results);
+
+		void Reset();
+
+	private:
+		// Level of the frames accumulated since the last update, which starts the next
+		float TakeLevel();
+
+		// Reads L10/L50/L90 from the histogram and starts the next window
+		void PublishPercentiles(FSPLMeterResults& Results);
+
+		FSPLWeightingFilter WeightingFilter;
+		TArray<float> WeightedBuffer;
+		int32 FramesPerUpdate = 0;
+		int32 FramesAccumulated = 0;
+		int32 LastUpdateFrames = 0;
+		float SumOfSquares = 0.f;
+
+		// Percentiles use tumbling windows: levels are binned until the window completes, then the histogram is
+		// read once and cleared. Memory stays constant however long the window is.
+		FSPLLevelHistogram LevelHistogram;
+		float SampleRate = 0.f;
+		int32 FramesInWindow = 0;
+	};
+
+	// Preallocated single-producer, single-consumer ring of audio blocks between a render thread and the analysis
+	// worker. Each block carries an InfoType of values read with it on the render thread.
+	template<typename InfoType>
+	class TSPLBlockRing
+	{
+	public:
+		TSPLBlockRing(int32 InFramesPerBlock, uint32 InNumBlocks)
+			: FramesPerBlock(InFramesPerBlock),
+			NumBlocks(InNumBlocks)
+		{
+			Samples.AddZeroed(InFramesPerBlock * InNumBlocks);
+			Blocks.AddDefaulted(InNumBlocks);
+		}
+
+		// Render thread only. Copies the block into the ring. Returns false, without blocking or allocating, when the
+		// ring is full.
+		bool Push(const float* InSamples, int32 NumFrames, const InfoType& Info)
+		{
+			const uint32 Write = WriteIndex.load(std::memory_order_relaxed);
+			if (Write - ReadIndex.load(std::memory_order_acquire) >= NumBlocks)
+			{
+				return false;
+			}
+
+			const uint32 Slot = Write % NumBlocks;
+			NumFrames = FMath::Min(NumFrames, FramesPerBlock);
+			FMemory::Memcpy(Samples.GetData() + Slot * FramesPerBlock, InSamples, NumFrames * sizeof(float));
+			Blocks[Slot] = { NumFrames, Info };
+
+			WriteIndex.store(Write + 1, std::memory_order_release);
+			return true;
+		}
+
+		// True once the worker has consumed every pushed block
+		bool IsEmpty() const
+		{
+			return ReadIndex.load(std::memory_order_acquire) == WriteIndex.load(std::memory_order_acquire);
+		}
+
+		// Worker thread only. Calls Func(Samples, NumFrames, Info) for each queued block, oldest first. Returns the
+		// number of blocks consumed.
+		template<typename FuncType>
+		uint32 Consume(FuncType&& Func)
+		{
+			const uint32 Write = WriteIndex.load(std::memory_order_acquire);
+			uint32 Read = ReadIndex.load(std::memory_order_relaxed);
+			const uint32 NumConsumed = Write - Read;
+
+			for (; Read != Write; ++Read)
+			{
+				const uint32 Slot = Read % NumBlocks;
+				Func(Samples.GetData() + Slot * FramesPerBlock, Blocks[Slot].NumFrames, Blocks[Slot].Info);
+
+				// Hand the slot back as soon as it's read so the render thread sees space early
+				ReadIndex.store(Read + 1, std::memory_order_release);
+			}
+			return NumConsumed;
+		}
+
+	private:
+		struct FBlock
+		{
+			int32 NumFrames = 0;
+			InfoType Info;
+		};
+
+		TArray<float> Samples;
+		TArray<FBlock> Blocks;
+		int32 FramesPerBlock = 0;
+		uint32 NumBlocks = 0;
+		std::atomic<uint32> WriteIndex { 0 };
+		std::atomic<uint32> ReadIndex { 0 };
+	};
+
+	// A channel the analysis worker drains
+	class METASOUNDSSPL_API ISPLAnalysisChannel
+	{
+	public:
+		virtual ~ISPLAnalysisChannel() = default;
+
+	protected:
+		friend class FSPLAnalysisWorker;
+
+		// Worker thread. Analyses everything queued and publishes the results.
+		virtual void ProcessQueued() = 0;
+	};
+
+	using FSPLAnalysisChannelBasePtr = TSharedPtr<ISPLAnalysisChannel, ESPMode::ThreadSafe>;
+
+	// One SPL meter's blocks on their way to the analysis worker, plus the latest results the worker has published
+	// for it. While the ring is full the meter measures on the render thread and sends its levels back through
+	// PushFallbackLevel, so the worker's percentile windows still cover every block.
+	class METASOUNDSSPL_API FSPLAnalysisChannel : public ISPLAnalysisChannel
+	{
+	public:
+		FSPLAnalysisChannel(float InSampleRate, int32 InFramesPerBlock, uint32 InNumBlocks, const FSPLMeterSettings& InMeterSettings, const FSPLMeterLogChannelPtr& InLogChannel);
+
+		// Render thread only. Returns false, without blocking or allocating, when the ring is full.
+		bool Push(const float* InSamples, int32 NumFrames, float PercentileWindowSeconds, int64 StartFrame)
+		{
+			return Blocks.Push(InSamples, NumFrames, { PercentileWindowSeconds, StartFrame });
+		}
+
+		// Render thread only. Hands a level measured on the render thread, over NumFrames, to the worker's
+		// percentile window. Returns false when that queue is full too.
+		bool PushFallbackLevel(float LevelDb, int32 NumFrames, float PercentileWindowSeconds)
+		{
+			return FallbackLevels.Enqueue({ LevelDb, NumFrames, PercentileWindowSeconds });
+		}
+
+		// True once the worker has analysed every pushed block
+		bool IsEmpty() const
+		{
+			return Blocks.IsEmpty();
+		}
+
+		// Latest published results. Fields are published individually, so a read can mix two consecutive updates.
+		FSPLMeterResults GetResults() const
+		{
+			return { LevelDb.load(std::memory_order_relaxed), L10Db.load(std::memory_order_relaxed), L50Db.load(std::memory_order_relaxed), L90Db.load(std::memory_order_relaxed) };
+		}
+
+	protected:
+		virtual void ProcessQueued() override;
+
+	private:
+		struct FBlockInfo
+		{
+			float PercentileWindowSeconds = 0.f;
+			int64 StartFrame = 0;
+		};
+
+		struct FFallbackLevel
+		{
+			float LevelDb = 0.f;
+			int32 NumFrames = 0;
+			float PercentileWindowSeconds = 0.f;
+		};
+
+		TSPLBlockRing<FBlockInfo> Blocks;
+		TCircularQueue<FFallbackLevel> FallbackLevels;
+
+		std::atomic<float> LevelDb { FSPLLevelHistogram::MinDb };
+		std::atomic<float> L10Db { FSPLLevelHistogram::MinDb };
+		std::atomic<float> L50Db { FSPLLevelHistogram::MinDb };
+		std::atomic<float> L90Db { FSPLLevelHistogram::MinDb };
+
+		// Worker thread state
+		FSPLMeterAnalyzer Analyzer;
+		FSPLMeterResults Results;
+		FSPLMeterLogChannelPtr LogChannel;
+		float SampleRate = 0.f;
+	};
+
+	using FSPLAnalysisChannelPtr = TSharedPtr<FSPLAnalysisChannel, ESPMode::ThreadSafe>;
+
+	// Optional off-render-thread analysis for SPL meters and Spectral Features nodes, enabled with
+	// au.MetaSoundsSPL.Analysis.Offload. The render thread only copies each block into the node's ring; a background
+	// worker runs the analysis and publishes the results, at most one drain interval behind.
+	//
+	// The worker has its own dedicated thread, "SPLAnalysisWorker", separate from the meter log writer's. Both are a
+	// TSPLChannelWorker.
+	class METASOUNDSSPL_API FSPLAnalysisPipeline
+	{
+	public:
+		// True when nodes created now should offload their analysis
+		static bool IsEnabled();
+
+		// Blocks each offloaded node's ring holds
+		static uint32 GetQueueBlocks();
+
+		// Opens a channel for a new meter, starting the worker on first use. Null when offloading is disabled.
+		// The worker, not the meter, pushes readings to LogChannel.
+		static FSPLAnalysisChannelPtr OpenChannel(float SampleRate, int32 FramesPerBlock, const FSPLMeterSettings& MeterSettings, const FSPLMeterLogChannelPtr& LogChannel);
+
+		// Hands another node's channel to the worker, starting it on first use
+		static void AddChannel(const FSPLAnalysisChannelBasePtr& Channel);
+
+		// Weighting order a meter uses while measuring on the render thread because its ring overflowed
+		static int32 GetFallbackWeightingOrder(int32 WeightingOrder);
+
+		// Analyses anything still queued and stops the worker thread
+		static void Shutdown();
+	};
+}
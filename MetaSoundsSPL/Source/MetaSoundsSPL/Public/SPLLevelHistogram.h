@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+	//------------------------------------------------------------------------------------
+	// FSPLLevelHistogram
+	//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// Fixed-size histogram of levels in 0.1 dB bins from MinDb to MaxDb. Adding a level is O(1) and memory is constant,
+	// so percentiles over long windows don't need the raw level history.
+	class METASOUNDSSPL_API FSPLLevelHistogram
+	{
+	public:
+		static constexpr float MinDb = -120.f;
+		static constexpr float MaxDb = 20.f;
+		static constexpr float BinWidthDb = 0.1f;
+		static constexpr int32 NumBins = 1400;
+
+		FSPLLevelHistogram();
+
+		void Add(float LevelDb);
+
+		void Reset();
+
+		int32 Num() const
+		{
+			return Count;
+		}
+
+		// Level exceeded by the given fraction of entries, e.g. 0.1 for L10 and 0.9 for L90.
+		// All fractions are resolved in a single scan of the bins.
+		void GetExceededLevels(TArrayView<const float> Fractions, TArrayView<float> OutLevelsDb) const;
+
+	private:
+		TArray<uint32> Bins;
+		int32 Count = 0;
+	};
+}
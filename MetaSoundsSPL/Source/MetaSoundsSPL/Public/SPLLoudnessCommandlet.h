@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Commandlets/Commandlet.h"
+
+#include "SPLLoudnessCommandlet.generated.h"
+
+	//------------------------------------------------------------------------------------
+	// USPLLoudnessCommandlet
+	//------------------------------------------------------------------------------------
+
+// Batch loudness audit of every SoundWave in the project using the SPL meter kernels. Writes peak, RMS, A-weighted RMS
+// and L10/L50/L90 per asset to a JSON manifest. Entries are keyed by a hash of the package file, so assets that have
+// not changed since the last run are not loaded or analysed again. Editor builds only, since it reads imported PCM.
+//
+// UnrealEditor-Cmd.exe <Project> -run=SPLLoudness [-Manifest=<File>] [-Paths=/Game,/MyPlugin] [-Batch=256]
+//     [-WeightingOrder=6] [-Force]
+UCLASS()
+class METASOUNDSSPL_API USPLLoudnessCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USPLLoudnessCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
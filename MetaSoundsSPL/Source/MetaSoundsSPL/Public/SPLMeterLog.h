@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Containers/CircularQueue.h"
+
+#include <atomic>
+
+	//------------------------------------------------------------------------------------
+	// FSPLMeterLog
+	//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// One meter update as written to the log
+	struct FSPLMeterReading
+	{
+		// Seconds of audio the meter had processed when the reading was taken
+		float TimeSeconds = 0.f;
+		float LevelDb = 0.f;
+		float L10Db = 0.f;
+		float L50Db = 0.f;
+		float L90Db = 0.f;
+	};
+
+	// Preallocated single-producer, single-consumer ring between one meter's render thread and the log writer thread
+	class METASOUNDSSPL_API FSPLMeterLogChannel
+	{
+	public:
+		FSPLMeterLogChannel(uint32 InMeterId, const FString& InMeterName, uint32 InCapacity);
+
+		// Render thread only. Never blocks or allocates: when the ring is full the reading is dropped and counted.
+		void Push(const FSPLMeterReading& Reading)
+		{
+			if (!Readings.Enqueue(Reading))
+			{
+				NumDropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		friend class FSPLMeterLogWriter;
+
+		TCircularQueue<FSPLMeterReading> Readings;
+		std::atomic<uint32> NumDropped { 0 };
+
+		// Writer thread state
+		uint32 NumDroppedWritten = 0;
+		uint32 MeterId = 0;
+		FString MeterName;
+	};
+
+	using FSPLMeterLogChannelPtr = TSharedPtr<FSPLMeterLogChannel, ESPMode::ThreadSafe>;
+
+	// Optional disk log of SPL meter readings, enabled with au.MetaSoundsSPL.MeterLog.Enabled. Readings are batched
+	// into an append-only binary file in the project's log directory by a background thread, so no file I/O happens
+	// on the render thread. Convert a log with au.MetaSoundsSPL.MeterLog.ToCSV.
+	class METASOUNDSSPL_API FSPLMeterLog
+	{
+	public:
+		// Opens a channel for a new meter, starting the writer on first use. Null when logging is disabled.
+		static FSPLMeterLogChannelPtr OpenChannel(const FString& MeterName);
+
+		// Writes out anything still queued and stops the writer thread
+		static void Shutdown();
+
+		static bool ConvertToCSV(const FString& LogFilename, const FString& CSVFilename);
+	};
+}
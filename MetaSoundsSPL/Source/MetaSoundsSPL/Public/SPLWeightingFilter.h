@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+	//------------------------------------------------------------------------------------
+	// FSPLWeightingFilter
+	//------------------------------------------------------------------------------------
+
+namespace Metasound
+{
+	// A-weighting built from first-order bilinear sections at the IEC 61672 pole frequencies, normalised to 0 dB at 1 kHz.
+	// Lower orders drop the outer poles first: 2 keeps the 107.7 Hz and 737.9 Hz high-passes that shape the mid band,
+	// 4 adds the 20.6 Hz pair and 6 adds the 12.2 kHz low-pass pair for the full curve. Order 0 is unweighted.
+	class METASOUNDSSPL_API FSPLWeightingFilter
+	{
+	public:
+		static constexpr int32 MaxOrder = 6;
+
+		void Init(float InSampleRate, int32 InOrder);
+
+		// InSamples and OutSamples may be the same buffer
+		void ProcessAudio(const float* InSamples, float* OutSamples, int32 NumSamples);
+
+		void Reset();
+
+		int32 GetOrder() const
+		{
+			return NumSections;
+		}
+
+	private:
+		struct FSection
+		{
+			float B0 = 1.f;
+			float B1 = 0.f;
+			float A1 = 0.f;
+			float X1 = 0.f;
+			float Y1 = 0.f;
+		};
+
+		FSection Sections[MaxOrder];
+		int32 NumSections = 0;
+		float Gain = 1.f;
+	};
+}